@@ -49,7 +49,8 @@ def feature_extraction(data_file, dataset="../images/shapes/"):
             
             img = cv2.imread(fpath, cv2.IMREAD_GRAYSCALE)
             img = cv2.bitwise_not(img)
-            hu = cv2.HuMoments(cv2.moments(img))
+            # unit weight per foreground pixel, as CCMoments computes them
+            hu = cv2.HuMoments(cv2.moments(img, binaryImage=True))
             
             for i in range(0, 7):
                 hu[i] = -1 * np.sign(hu[i]) * np.log10(np.abs(hu[i]))
@@ -99,6 +100,30 @@ def classification(data_file, rounds=100, remove_disperse=[]):
     print("Classification done!")
     return ans
 
+def export_model(data_file, model_file, remove_disperse=[]):
+    """ train on the whole set and write label,bias,w1..wn per class for
+        CCFeatureClassifier, the standard scaler is folded into the weights """
+    df = pd.read_csv(data_file)
+    df = df.drop(["sample"], axis=1)
+
+    if remove_disperse:
+        df = df.drop(remove_disperse, axis=1)
+
+    X = df.drop(["class"], axis=1)
+    y = df["class"]
+
+    scaler = StandardScaler()
+    classifier = LogisticRegression()
+    classifier.fit(scaler.fit_transform(X), y)
+
+    with open(model_file, "w") as f:
+        f.write("# label,bias,{}\n".format(",".join(X.columns)))
+        for label, coef, bias in zip(classifier.classes_, classifier.coef_, classifier.intercept_):
+            w = coef / scaler.scale_
+            b = bias - np.sum(w * scaler.mean_)
+            f.write("{},{}\n".format(label, ",".join(repr(float(v)) for v in [b] + list(w))))
+    print("Model written to", model_file)
+
 def summary(ans, title="Summary"):
     size = 70
     separator = "-"
@@ -126,3 +151,4 @@ if __name__ == "__main__":
     feature_extraction(data_file)
     ans = classification(data_file)
     summary(ans)
+    export_model(data_file, "hu_moments_model.csv")
@@ -0,0 +1,170 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  BoundedQueue : lock-free multi-producer multi-consumer ring (Vyukov).
+ *  Every cell carries a sequence number telling producers and consumers
+ *  whose turn it is, a position is claimed with one compare-and-swap.
+ *  Push and Pop back off while the ring is full or empty; Close() lets
+ *  consumers drain what is left and then return false.
+ *
+ */
+
+#ifndef _CCBOUNDEDQUEUE_HPP_
+#define _CCBOUNDEDQUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+template<class T>
+class CCBoundedQueue {
+
+    public:
+
+    // capacity is rounded up to a power of two
+    explicit CCBoundedQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; i++)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    CCBoundedQueue(const CCBoundedQueue &) = delete;
+
+    CCBoundedQueue& operator=(const CCBoundedQueue &) = delete;
+
+    size_t getCapacity(void) const noexcept {
+        return mask_ + 1;
+    }
+
+    // value is moved from only on success
+    bool TryPush(T &value) {
+        size_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T &value) {
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.data);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // waits for a free cell, false once the queue is closed
+    bool Push(T value) {
+        for (int spin = 0; !closed_.load(std::memory_order_acquire); spin++) {
+            if (TryPush(value))
+                return true;
+            Backoff(spin);
+        }
+        return false;
+    }
+
+    // waits for an item, false once the queue is closed and drained
+    bool Pop(T &value) {
+        for (int spin = 0; ; spin++) {
+            if (TryPop(value))
+                return true;
+            // items pushed before the close are still handed out
+            if (closed_.load(std::memory_order_acquire))
+                return TryPop(value);
+            Backoff(spin);
+        }
+    }
+
+    void Close(void) {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    bool isClosed(void) const {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+    private:
+
+    static void Backoff(int spin) {
+        if (spin < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+
+    size_t mask_;
+
+    // producers and consumers update different cache lines
+    char pad0_[64];
+
+    std::atomic<size_t> enqueue_ {0};
+
+    char pad1_[64];
+
+    std::atomic<size_t> dequeue_ {0};
+
+    char pad2_[64];
+
+    std::atomic<bool> closed_ {false};
+};
+#endif
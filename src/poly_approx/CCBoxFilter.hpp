@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Box Filter : mean over a dimX x dimY window, runs on the convolution
+ *  engine's running-sum backend
+ *
+ */
+
+#ifndef _CCBOXFILTER_HPP_
+#define _CCBOXFILTER_HPP_
+
+#include "CCConvolutionFilter.hpp"
+#include "CCConvolutionEngine.hpp"
+
+class CCBoxFilter : public CCImageConvolutionFilter {
+
+    public:
+
+    CCBoxFilter() : CCBoxFilter(3, 3) {}
+
+    CCBoxFilter(int dX, int dY, CCBorderMode border = CCBorderMode::REPLICATE) :
+        CCImageConvolutionFilter(dX, dY) {
+        engine_.setBorderMode(border);
+        if ((dX > 0) && (dY > 0))
+            engine_.setKernel(std::vector<float>(dX * dY, 1.0f / (dX * dY)), dX, dY);
+    }
+
+    virtual ~CCBoxFilter() {}
+
+    const CCConvolutionEngine &getEngine(void) const {
+        return engine_;
+    }
+
+    virtual void Run(const CCImageView &img) {
+        engine_.Run(img);
+    }
+
+    private:
+
+    CCConvolutionEngine engine_;
+};
+#endif
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Canny Filter Class : Sobel gradient, non-maximum suppression along the
+ *  quantized gradient direction and hysteresis thresholding. Produces a
+ *  binary (0/255) image of one pixel wide edges.
+ *
+ */
+
+#ifndef _CCCANNYFILTER_HPP_
+#define _CCCANNYFILTER_HPP_
+
+#include <vector>
+#include <cstdint>
+
+#include "CCDerivativeFilter.hpp"
+#include "CCSoebelFilter.hpp"
+#include "CCImageReader.hpp"
+
+class CCCannyFilter : public CCImageDerivativeFilter {
+
+    public:
+
+    CCCannyFilter() : CCImageDerivativeFilter(3, 3, 1.0), low_(40), high_(100) {
+    }
+
+    CCCannyFilter(int low, int high, CCSobelNorm norm = CCSobelNorm::L2) :
+        CCImageDerivativeFilter(3, 3, 1.0), low_(low), high_(high), sobel_(3, 3, 1.0, norm) {
+    }
+
+    virtual ~CCCannyFilter() {
+    }
+
+    virtual void Run(const CCImageView &img) {
+        int width  = img.getWidth();
+        int height = img.getHeight();
+        std::vector<uint16_t> mag(width * height);
+        std::vector<uint8_t> dir(width * height);
+        std::vector<uint8_t> state(width * height, NONE);
+        std::vector<int> stack;
+
+        sobel_.Gradient(img, mag.data(), dir.data());
+
+        // non-maximum suppression, the frame has no gradient
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 1; x < width - 1; x++) {
+                int index = y * width + x;
+                int m = mag[index];
+                int off;
+
+                if (m < low_)
+                    continue;
+
+                switch (dir[index]) {
+                case SOBEL_DIR_0:
+                    off = 1;
+                    break;
+                case SOBEL_DIR_45:
+                    off = width + 1;
+                    break;
+                case SOBEL_DIR_90:
+                    off = width;
+                    break;
+                default:
+                    off = width - 1;
+                    break;
+                }
+
+                // strict on one side so plateaus keep a single pixel
+                if ((m <= mag[index - off]) || (m < mag[index + off]))
+                    continue;
+
+                if (m >= high_) {
+                    state[index] = EDGE;
+                    stack.push_back(index);
+                } else
+                    state[index] = WEAK;
+            }
+        }
+
+        // hysteresis: grow strong edges through 8-connected weak pixels
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int next = index + dy * width + dx;
+                    if (state[next] == WEAK) {
+                        state[next] = EDGE;
+                        stack.push_back(next);
+                    }
+                }
+            }
+        }
+
+        for (int y = 0; y < height; y++) {
+            uint8_t *row = img.getRow(y);
+            for (int x = 0; x < width; x++)
+                row[x] = (state[y * width + x] == EDGE) ? 255 : 0;
+        }
+    }
+
+    private:
+
+    enum EdgeState : uint8_t {
+        NONE,
+
+        WEAK,
+
+        EDGE,
+    };
+
+    int low_;  // hysteresis thresholds on the gradient magnitude
+
+    int high_;
+
+    CCSoebelFilter sobel_;
+};
+#endif
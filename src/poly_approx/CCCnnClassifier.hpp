@@ -0,0 +1,162 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  CnnClassifier : labels the connected components of a binary image with
+ *  a CCNeuralNetwork. Every component is cropped to a square around its
+ *  bounding box, sampled to the 1 x size x size network input and all
+ *  crops of an image run as one batch.
+ *
+ */
+
+#ifndef _CCCNNCLASSIFIER_HPP_
+#define _CCCNNCLASSIFIER_HPP_
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "CCImageView.hpp"
+#include "CCConnectedComponents.hpp"
+#include "CCNeuralNetwork.hpp"
+
+class CCCnnClassifier {
+
+    public:
+
+    // classes are the network outputs in order, labels maps them to the
+    // values reported by getLabels()
+    CCCnnClassifier(std::shared_ptr<CCNeuralNetwork> pNetwork, const std::vector<int> &classLabels) :
+        pNetwork_(pNetwork), classLabels_(classLabels) {}
+
+    virtual ~CCCnnClassifier() {}
+
+    // returns the number of components labeled
+    int Run(const CCImageView &img) {
+        CCConnectedComponents components;
+        components.Run(img);
+        return Run(components);
+    }
+
+    // components labelled earlier, e.g. by the pipeline's labelling stage
+    int Run(const CCConnectedComponents &components) {
+        int numClasses, n;
+
+        labels_.clear();
+        confidence_.clear();
+        if (!pNetwork_ || !pNetwork_->isCompiled()) {
+            CC_ERR("network is not compiled");
+            return 0;
+        }
+
+        const CCTensorShape &in = pNetwork_->getInputShape();
+        numClasses = pNetwork_->getOutputShape().size();
+        if ((in.channels != 1) || (in.height != in.width) ||
+            (numClasses != int(classLabels_.size()))) {
+            CC_ERR("network does not take square crops of the given classes");
+            return 0;
+        }
+
+        n = components.getComponents().size();
+        crops_.resize(n * in.size());
+        scores_.resize(n * numClasses);
+        for (int i = 0; i < n; i++)
+            Crop(components.getLabels(), components.getWidth(), components.getComponents()[i],
+                 in.width, &crops_[i * in.size()]);
+
+        if (n && !pNetwork_->Run(crops_.data(), n, scores_.data()))
+            return 0;
+
+        for (int i = 0; i < n; i++) {
+            const float *s = &scores_[i * numClasses];
+            const float *best = std::max_element(s, s + numClasses);
+            labels_.push_back(classLabels_[best - s]);
+            confidence_.push_back(*best);
+        }
+        return n;
+    }
+
+    // the labels of other after these, e.g. over several regions of an image
+    void Append(const CCCnnClassifier &other) {
+        labels_.insert(labels_.end(), other.labels_.begin(), other.labels_.end());
+        confidence_.insert(confidence_.end(), other.confidence_.begin(), other.confidence_.end());
+    }
+
+    void Clear(void) {
+        labels_.clear();
+        confidence_.clear();
+    }
+
+    std::shared_ptr<CCNeuralNetwork> getNetwork(void) const noexcept {
+        return pNetwork_;
+    }
+
+    // network output i stands for classLabels[i]
+    const std::vector<int> &getClassLabels(void) const noexcept {
+        return classLabels_;
+    }
+
+    // label of every component in the order of CCConnectedComponents
+    const std::vector<int> &getLabels(void) const noexcept {
+        return labels_;
+    }
+
+    // network output of the chosen class
+    const std::vector<float> &getConfidence(void) const noexcept {
+        return confidence_;
+    }
+
+    // 1 on the pixels of the component, 0 elsewhere, nearest sampling of
+    // the square that centers the bounding box
+    static void Crop(const std::vector<int> &labels, int width, const CCComponent &c,
+                     int size, float *out) {
+        const int height = labels.size() / width;
+        const int side = std::max(c.getWidth(), c.getHeight());
+        const int x0 = c.minX - (side - c.getWidth()) / 2, y0 = c.minY - (side - c.getHeight()) / 2;
+
+        for (int y = 0; y < size; y++) {
+            int sy = y0 + (2 * y + 1) * side / (2 * size);
+            for (int x = 0; x < size; x++) {
+                int sx = x0 + (2 * x + 1) * side / (2 * size);
+                bool inside = (sx >= 0) && (sx < width) && (sy >= 0) && (sy < height);
+                out[y * size + x] = (inside && (labels[sy * width + sx] == c.label)) ? 1.0f : 0.0f;
+            }
+        }
+    }
+
+    private:
+
+    std::shared_ptr<CCNeuralNetwork> pNetwork_;
+
+    std::vector<int> classLabels_;
+
+    std::vector<int> labels_;
+
+    std::vector<float> confidence_;
+
+    std::vector<float> crops_;
+
+    std::vector<float> scores_;
+};
+#endif
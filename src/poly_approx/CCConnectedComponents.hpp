@@ -0,0 +1,193 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Connected Components : two-pass, union-find labeling of the foreground
+ *  (non-zero) pixels of a binary image with 8-connectivity. Bounding box
+ *  and area of every component are gathered in the second pass.
+ *
+ */
+
+#ifndef _CCCONNECTEDCOMPONENTS_HPP_
+#define _CCCONNECTEDCOMPONENTS_HPP_
+
+#include <vector>
+#include <algorithm>
+
+#include "CCImageView.hpp"
+
+struct CCComponent {
+
+    int label;
+
+    int area;
+
+    int minX, minY; // inclusive bounding box
+
+    int maxX, maxY;
+
+    int getWidth(void) const noexcept {
+        return maxX - minX + 1;
+    }
+
+    int getHeight(void) const noexcept {
+        return maxY - minY + 1;
+    }
+};
+
+class CCConnectedComponents {
+
+    public:
+
+    CCConnectedComponents() {}
+
+    virtual ~CCConnectedComponents() {}
+
+    // returns the number of components, labels are 1..n (0 is background)
+    int Run(const CCImageView &img) {
+        width_  = img.getWidth();
+        height_ = img.getHeight();
+        labels_.assign(width_ * height_, 0);
+        parent_.assign(1, 0);
+        components_.clear();
+
+        // first pass: provisional labels and equivalences
+        for (int y = 0; y < height_; y++) {
+            const unsigned char *row = img.getRow(y);
+            int *lrow = &labels_[y * width_];
+            int *prow = y ? &labels_[(y - 1) * width_] : nullptr;
+            for (int x = 0; x < width_; x++) {
+                if (!row[x])
+                    continue;
+
+                int label = 0;
+                if (x && lrow[x - 1])
+                    label = Merge(label, lrow[x - 1]);
+                if (prow) {
+                    if (x && prow[x - 1])
+                        label = Merge(label, prow[x - 1]);
+                    if (prow[x])
+                        label = Merge(label, prow[x]);
+                    if ((x + 1 < width_) && prow[x + 1])
+                        label = Merge(label, prow[x + 1]);
+                }
+                if (!label) {
+                    label = parent_.size();
+                    parent_.push_back(label);
+                }
+                lrow[x] = label;
+            }
+        }
+
+        // flatten equivalences to consecutive labels
+        std::vector<int> remap(parent_.size(), 0);
+        int numLabels = 0;
+        for (size_t i = 1; i < parent_.size(); i++) {
+            int root = Find(i);
+            if (!remap[root])
+                remap[root] = ++numLabels;
+            remap[i] = remap[root];
+        }
+
+        components_.resize(numLabels);
+        for (int i = 0; i < numLabels; i++)
+            components_[i] = CCComponent{i + 1, 0, width_, height_, -1, -1};
+
+        // second pass: final labels and stats
+        for (int y = 0; y < height_; y++) {
+            int *lrow = &labels_[y * width_];
+            for (int x = 0; x < width_; x++) {
+                if (!lrow[x])
+                    continue;
+                lrow[x] = remap[lrow[x]];
+                CCComponent &c = components_[lrow[x] - 1];
+                c.area++;
+                c.minX = std::min(c.minX, x);
+                c.minY = std::min(c.minY, y);
+                c.maxX = std::max(c.maxX, x);
+                c.maxY = std::max(c.maxY, y);
+            }
+        }
+        return numLabels;
+    }
+
+    // keeps the capacity for the next run
+    void Clear(void) noexcept {
+        width_ = height_ = 0;
+        labels_.clear();
+        components_.clear();
+    }
+
+    int getWidth(void) const noexcept {
+        return width_;
+    }
+
+    int getHeight(void) const noexcept {
+        return height_;
+    }
+
+    const std::vector<int> &getLabels(void) const noexcept {
+        return labels_;
+    }
+
+    // component with label l is at index l - 1
+    const std::vector<CCComponent> &getComponents(void) const noexcept {
+        return components_;
+    }
+
+    private:
+
+    int Find(int label) {
+        while (parent_[label] != label) {
+            parent_[label] = parent_[parent_[label]];
+            label = parent_[label];
+        }
+        return label;
+    }
+
+    // union of two provisional labels, returns the surviving root
+    int Merge(int label, int other) {
+        other = Find(other);
+        if (!label)
+            return other;
+        label = Find(label);
+        if (label < other)
+            parent_[other] = label;
+        else if (other < label)
+            parent_[label] = other;
+        return std::min(label, other);
+    }
+
+    int width_ {0};
+
+    int height_ {0};
+
+    std::vector<int> labels_;
+
+    std::vector<int> parent_;
+
+    std::vector<CCComponent> components_;
+};
+
+#endif
@@ -129,6 +129,13 @@ struct Contour {
         boundaryPixels.clear();
     }
 
+    // shift from view-local to parent image coordinates
+    void Translate(T dx, T dy) {
+        _start = Pixel<T>(_start.getX() + dx, _start.getY() + dy);
+        for (auto &p : boundaryPixels)
+            p = Pixel<T>(p.getX() + dx, p.getY() + dy);
+    }
+
     void makeConvexHull(void) {
         for (auto &p : boundaryPixels) 
             CC_INFO("BP", getUUId(), p.getX(), p.getY());
@@ -59,7 +59,7 @@ static bool IsPixelVisited(const Pixel<T> &pixel, const std::list<Contour<T>> &c
 
 template<class T>
 static bool
-IsBorderPixel(byte *Img, const Pixel<T> &start_pixel, int ImgHeight, int ImgWidth) {
+IsBorderPixel(byte *Img, const Pixel<T> &start_pixel, int ImgHeight, int ImgWidth, int ImgStride) {
         Contour<T> contour;
         PixelDirection traceDir;
         Pixel<T> neighbour_pixel, np(start_pixel);
@@ -69,7 +69,7 @@ IsBorderPixel(byte *Img, const Pixel<T> &start_pixel, int ImgHeight, int ImgWidt
         if (!IsPixelValid<T>(np, ImgWidth, ImgHeight))
             return false;
 
-        index = np.getY() * ImgWidth + np.getX();
+        index = np.getY() * ImgStride + np.getX();
         if (!Img[index])
             return false;
 
@@ -77,8 +77,8 @@ IsBorderPixel(byte *Img, const Pixel<T> &start_pixel, int ImgHeight, int ImgWidt
         entry_dir = traceDir.getDirection();
         do {
                 neighbour_pixel = traceDir.getNeighbour(start_pixel);
-                if (neighbour_pixel.valid()) {
-                        index = neighbour_pixel.getY() * ImgWidth + neighbour_pixel.getX();
+                if (IsPixelValid<T>(neighbour_pixel, ImgWidth, ImgHeight)) {
+                        index = neighbour_pixel.getY() * ImgStride + neighbour_pixel.getX();
                         if (Img[index])
                                 count++;
                         //PIXEL_TRACE("bp pixel<start, current, next>",
@@ -97,14 +97,14 @@ template<class T>
 static Contour<T>
 BorderFollowingStrategy(byte *Img, 
                            const Pixel<T> &start_pixel,
-                           int ImgHeight, int ImgWidth, byte *ImgDst,
+                           int ImgHeight, int ImgWidth, int ImgStride, byte *ImgDst,
                            std::list<Contour<T>> contours_list) {
     int nc = 0, index;
     Contour<T> contour;
     PixelDirection traceDir;
     Pixel<T> curr_pixel(start_pixel), next_pixel, first_pixel;
 
-    if (!IsBorderPixel<T>(Img, curr_pixel, ImgHeight, ImgWidth))
+    if (!IsBorderPixel<T>(Img, curr_pixel, ImgHeight, ImgWidth, ImgStride))
         return contour;
 
     traceDir.clockwise();
@@ -115,13 +115,13 @@ BorderFollowingStrategy(byte *Img,
     // follow border pixels
     //while (nc < 8 && !IsPixelVisited<T>(next_pixel, contours_list)) {
     while (nc < 8) {
-        if (!next_pixel.valid())
+        if (!IsPixelValid<T>(next_pixel, ImgWidth, ImgHeight))
             goto nextbp;
-        index = next_pixel.getY() * ImgWidth + next_pixel.getX();
+        index = next_pixel.getY() * ImgStride + next_pixel.getX();
         if ((byte) Img[index]) {
             if (contour.FindPixel(next_pixel))
                 break;
-            if (!IsBorderPixel<T>(Img, next_pixel, ImgHeight, ImgWidth))
+            if (!IsBorderPixel<T>(Img, next_pixel, ImgHeight, ImgWidth, ImgStride))
                 goto nextbp;
             // reset counter for new neigbourhood scan
             nc = 0;
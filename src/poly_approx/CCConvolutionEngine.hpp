@@ -0,0 +1,505 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Convolution Engine : 2D correlation of an 8-bit view with an arbitrary
+ *  odd sized kernel. The kernel is inspected once when it is set:
+ *
+ *  RUNNING_SUM : every tap is equal (box), integer running sums along rows
+ *                and columns, cost per pixel does not depend on the size
+ *  SEPARABLE   : rank-1 kernel, split into a row and a column kernel
+ *  DIRECT      : anything else, full width x height taps per pixel
+ *
+ *  Rows stream through a ring of height + 1 horizontally filtered rows, so
+ *  the output is written back in place and the working set stays a few
+ *  rows wide. Channels stay interleaved, the inner loops are SSE2 with a
+ *  scalar tail.
+ *
+ */
+
+#ifndef _CCCONVOLUTIONENGINE_HPP_
+#define _CCCONVOLUTIONENGINE_HPP_
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CCImageView.hpp"
+
+// samples read outside the view
+enum class CCBorderMode {
+
+    ZERO,
+
+    REPLICATE,
+
+    REFLECT,
+};
+
+enum class CCConvolutionBackend {
+
+    AUTO,
+
+    DIRECT,
+
+    SEPARABLE,
+
+    RUNNING_SUM,
+};
+
+// index of the sample standing in for i in [0, n), -1 reads as zero.
+// REFLECT mirrors about the edge sample: -1 -> 1, n -> n - 2
+static inline int BorderIndex(int i, int n, CCBorderMode mode) {
+    if ((i >= 0) && (i < n))
+        return i;
+
+    switch (mode) {
+    case CCBorderMode::REPLICATE:
+        return std::min(std::max(i, 0), n - 1);
+    case CCBorderMode::REFLECT:
+        if (n == 1)
+            return 0;
+        while ((i < 0) || (i >= n))
+            i = (i < 0) ? -i : 2 * (n - 1) - i;
+        return i;
+    default:
+        return -1;
+    }
+}
+
+// row y of the view with half pixels of border on either side
+template <typename T>
+static void LoadBorderedRow(const CCImageView &img, int y, int half, CCBorderMode mode, T *out) {
+    int width = img.getWidth();
+    int nc    = img.getNumChannels();
+    const uint8_t *row = img.getRow(y);
+
+    for (int x = -half; x < width + half; x++) {
+        int k = BorderIndex(x, width, mode);
+        T *o = out + (x + half) * nc;
+        for (int c = 0; c < nc; c++)
+            o[c] = (k < 0) ? T(0) : T(row[k * nc + c]);
+    }
+}
+
+// acc[i] += sum_j k[j] * in[i + j * step] for i in [0, n)
+static void ConvolveRowAdd(const float *in, int n, int step, const float *k, int taps,
+                           float *acc) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 s = _mm_loadu_ps(acc + i);
+        for (int j = 0; j < taps; j++)
+            s = _mm_add_ps(s, _mm_mul_ps(_mm_set1_ps(k[j]), _mm_loadu_ps(in + i + j * step)));
+        _mm_storeu_ps(acc + i, s);
+    }
+#endif
+    for (; i < n; i++) {
+        float s = acc[i];
+        for (int j = 0; j < taps; j++)
+            s += k[j] * in[i + j * step];
+        acc[i] = s;
+    }
+}
+
+// acc[i] += k * in[i]
+static void AccumulateRow(const float *in, float k, int n, float *acc) {
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 kk = _mm_set1_ps(k);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i),
+                                          _mm_mul_ps(kk, _mm_loadu_ps(in + i))));
+#endif
+    for (; i < n; i++)
+        acc[i] += k * in[i];
+}
+
+// out[i] = sat8(scale * in[i] + bias), bias 0.5 rounds half up, 0 truncates
+static void StoreRow(const float *in, float scale, float bias, int n, uint8_t *out) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128 s = _mm_set1_ps(scale), zero = _mm_setzero_ps();
+    const __m128 top = _mm_set1_ps(255.0f), b = _mm_set1_ps(bias);
+    for (; i + 8 <= n; i += 8) {
+        __m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(s, _mm_loadu_ps(in + i)), zero), top);
+        __m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(s, _mm_loadu_ps(in + i + 4)), zero), top);
+        // non negative, so the conversion truncates towards zero
+        __m128i w = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(lo, b)),
+                                    _mm_cvttps_epi32(_mm_add_ps(hi, b)));
+        _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(w, w));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = static_cast<uint8_t>(std::min(std::max(scale * in[i], 0.0f), 255.0f) + bias);
+}
+
+// sum[i] += add[i] - sub[i], either row may be missing (zero border)
+static void RunningSumRow(const int32_t *add, const int32_t *sub, int n, int32_t *sum) {
+    int i = 0;
+#if defined(__SSE2__)
+    for (; add && sub && (i + 4 <= n); i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(sum + i));
+        s = _mm_add_epi32(s, _mm_loadu_si128((const __m128i *)(add + i)));
+        s = _mm_sub_epi32(s, _mm_loadu_si128((const __m128i *)(sub + i)));
+        _mm_storeu_si128((__m128i *)(sum + i), s);
+    }
+#endif
+    for (; i < n; i++)
+        sum[i] += (add ? add[i] : 0) - (sub ? sub[i] : 0);
+}
+
+//
+// Streams the view through a ring of taps + 1 processed rows. load(y, dst)
+// turns image row y into one ring entry, emit(y, rows) writes output row y
+// where rows[0] is virtual row y - taps / 2 - 1 and rows[taps] is row
+// y + taps / 2 (nullptr for rows of a ZERO border). Image rows are only
+// read before they are overwritten, rows below the bottom edge are copied
+// from the ring entry of the row they mirror.
+//
+template <typename T, typename Load, typename Emit>
+static void ProcessRowRing(const CCImageView &img, int taps, size_t rowLen,
+                           CCBorderMode mode, Load load, Emit emit) {
+    int height   = img.getHeight();
+    int half     = taps / 2;
+    int ringSize = taps + 1;
+    std::vector<T> ring(ringSize * rowLen);
+    std::vector<bool> zero(ringSize, true);
+    std::vector<const T *> rows(ringSize);
+
+    auto slot = [ringSize](int v) { return ((v % ringSize) + ringSize) % ringSize; };
+
+    auto fetch = [&](int v) {
+        int s = slot(v);
+        int m = BorderIndex(v, height, mode);
+        zero[s] = (m < 0);
+        if (m < 0)
+            return;
+        if (v < height) {
+            load(m, &ring[s * rowLen]);
+        } else {
+            // at most 2 * half rows back, still in the ring
+            int src = slot(m);
+            zero[s] = zero[src];
+            if (src != s)
+                memcpy(&ring[s * rowLen], &ring[src * rowLen], rowLen * sizeof(T));
+        }
+    };
+
+    if ((height <= 0) || (img.getWidth() <= 0))
+        return;
+
+    for (int v = -half - 1; v < half; v++)
+        fetch(v);
+
+    for (int y = 0; y < height; y++) {
+        fetch(y + half);
+        for (int j = 0; j < ringSize; j++) {
+            int s = slot(y - half - 1 + j);
+            rows[j] = zero[s] ? nullptr : &ring[s * rowLen];
+        }
+        emit(y, rows.data());
+    }
+}
+
+class CCConvolutionEngine {
+
+    public:
+
+    CCConvolutionEngine() {}
+
+    CCConvolutionEngine(const std::vector<float> &kernel, int width, int height,
+                        CCBorderMode border = CCBorderMode::REPLICATE) : border_(border) {
+        setKernel(kernel, width, height);
+    }
+
+    virtual ~CCConvolutionEngine() {}
+
+    // row major width x height taps, both odd, centered on the output pixel
+    bool setKernel(const std::vector<float> &kernel, int width, int height) {
+        if ((width <= 0) || (height <= 0) || !(width & 1) || !(height & 1) ||
+            (kernel.size() != size_t(width) * height))
+            return false;
+
+        kernel_ = kernel;
+        kWidth_ = width;
+        kHeight_ = height;
+        Analyze();
+        return true;
+    }
+
+    // a separable kernel given by its factors, kernel[y][x] = column[y] *
+    // row[x]; the separable backend then uses them as they are, so results
+    // match a row pass followed by a column pass with the same taps
+    bool setKernel(const std::vector<float> &row, const std::vector<float> &column) {
+        std::vector<float> kernel(row.size() * column.size());
+
+        for (size_t y = 0; y < column.size(); y++)
+            for (size_t x = 0; x < row.size(); x++)
+                kernel[y * row.size() + x] = column[y] * row[x];
+        if (!setKernel(kernel, row.size(), column.size()))
+            return false;
+        rowK_ = row;
+        colK_ = column;
+        separable_ = true;
+        return true;
+    }
+
+    // AUTO picks the cheapest backend the kernel allows, a forced backend
+    // the kernel does not allow is rejected
+    bool setBackend(CCConvolutionBackend backend) {
+        if (((backend == CCConvolutionBackend::SEPARABLE) && !separable_) ||
+            ((backend == CCConvolutionBackend::RUNNING_SUM) && !box_))
+            return false;
+        forced_ = backend;
+        return true;
+    }
+
+    CCConvolutionBackend getBackend(void) const {
+        if (forced_ != CCConvolutionBackend::AUTO)
+            return forced_;
+        if (box_)
+            return CCConvolutionBackend::RUNNING_SUM;
+        if (separable_)
+            return CCConvolutionBackend::SEPARABLE;
+        return CCConvolutionBackend::DIRECT;
+    }
+
+    void setBorderMode(CCBorderMode border) {
+        border_ = border;
+    }
+
+    CCBorderMode getBorderMode(void) const {
+        return border_;
+    }
+
+    // results are rounded to the nearest value by default, truncation
+    // reproduces float filters that cast their sums
+    void setTruncation(bool truncate) {
+        truncate_ = truncate;
+    }
+
+    bool getTruncation(void) const {
+        return truncate_;
+    }
+
+    bool isSeparable(void) const {
+        return separable_;
+    }
+
+    bool isBox(void) const {
+        return box_;
+    }
+
+    // factors of a separable kernel, kernel[y][x] = column[y] * row[x]
+    const std::vector<float> &getRowKernel(void) const {
+        return rowK_;
+    }
+
+    const std::vector<float> &getColumnKernel(void) const {
+        return colK_;
+    }
+
+    int getKernelWidth(void) const {
+        return kWidth_;
+    }
+
+    int getKernelHeight(void) const {
+        return kHeight_;
+    }
+
+    // in place on the view
+    void Run(const CCImageView &img) const {
+        if (img.empty() || kernel_.empty())
+            return;
+
+        switch (getBackend()) {
+        case CCConvolutionBackend::RUNNING_SUM:
+            RunRunningSum(img);
+            break;
+        case CCConvolutionBackend::SEPARABLE:
+            RunSeparable(img);
+            break;
+        default:
+            RunDirect(img);
+            break;
+        }
+    }
+
+    private:
+
+    // equal taps, or a rank-1 factorization through the largest tap
+    void Analyze(void) {
+        int pr = 0, pc = 0;
+        float peak = 0;
+
+        box_ = std::all_of(kernel_.begin(), kernel_.end(),
+                           [this](float k) { return k == kernel_[0]; });
+
+        for (int y = 0; y < kHeight_; y++) {
+            for (int x = 0; x < kWidth_; x++) {
+                if (std::fabs(at(x, y)) > peak) {
+                    peak = std::fabs(at(x, y));
+                    pr = y;
+                    pc = x;
+                }
+            }
+        }
+
+        colK_.assign(kHeight_, 0.0f);
+        rowK_.assign(kWidth_, 0.0f);
+        separable_ = true;
+        if (peak == 0)
+            return;
+
+        for (int y = 0; y < kHeight_; y++)
+            colK_[y] = at(pc, y);
+        for (int x = 0; x < kWidth_; x++)
+            rowK_[x] = at(x, pr) / at(pc, pr);
+
+        for (int y = 0; y < kHeight_ && separable_; y++)
+            for (int x = 0; x < kWidth_ && separable_; x++)
+                separable_ = std::fabs(at(x, y) - colK_[y] * rowK_[x]) <= 1e-5f * peak;
+    }
+
+    float bias(void) const {
+        return truncate_ ? 0.0f : 0.5f;
+    }
+
+    float at(int x, int y) const {
+        return kernel_[y * kWidth_ + x];
+    }
+
+    void RunSeparable(const CCImageView &img) const {
+        int nc = img.getNumChannels();
+        int n  = img.getWidth() * nc;
+        int halfX = kWidth_ / 2;
+        std::vector<float> padded((img.getWidth() + 2 * halfX) * nc);
+        std::vector<float> acc(n);
+
+        auto load = [&](int y, float *dst) {
+            LoadBorderedRow(img, y, halfX, border_, padded.data());
+            std::fill(dst, dst + n, 0.0f);
+            ConvolveRowAdd(padded.data(), n, nc, rowK_.data(), kWidth_, dst);
+        };
+
+        auto emit = [&](int y, const float *const *rows) {
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int j = 0; j < kHeight_; j++) {
+                if (rows[j + 1])
+                    AccumulateRow(rows[j + 1], colK_[j], n, acc.data());
+            }
+            StoreRow(acc.data(), 1.0f, bias(), n, img.getRow(y));
+        };
+
+        ProcessRowRing<float>(img, kHeight_, n, border_, load, emit);
+    }
+
+    void RunDirect(const CCImageView &img) const {
+        int nc = img.getNumChannels();
+        int n  = img.getWidth() * nc;
+        int halfX = kWidth_ / 2;
+        size_t rowLen = (img.getWidth() + 2 * halfX) * nc;
+        std::vector<float> acc(n);
+
+        auto load = [&](int y, float *dst) {
+            LoadBorderedRow(img, y, halfX, border_, dst);
+        };
+
+        auto emit = [&](int y, const float *const *rows) {
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int j = 0; j < kHeight_; j++) {
+                if (rows[j + 1])
+                    ConvolveRowAdd(rows[j + 1], n, nc, &kernel_[j * kWidth_], kWidth_, acc.data());
+            }
+            StoreRow(acc.data(), 1.0f, bias(), n, img.getRow(y));
+        };
+
+        ProcessRowRing<float>(img, kHeight_, rowLen, border_, load, emit);
+    }
+
+    // box sums stay exact in 32-bit integers, scaled by the tap on store
+    void RunRunningSum(const CCImageView &img) const {
+        int nc = img.getNumChannels();
+        int n  = img.getWidth() * nc;
+        int halfX = kWidth_ / 2;
+        std::vector<int32_t> padded((img.getWidth() + 2 * halfX) * nc);
+        std::vector<int32_t> colSum(n, 0);
+        std::vector<float> acc(n);
+
+        auto load = [&](int y, int32_t *dst) {
+            const int32_t *p = padded.data();
+            LoadBorderedRow(img, y, halfX, border_, padded.data());
+            for (int i = 0; i < nc; i++) {
+                int32_t s = 0;
+                for (int j = 0; j < kWidth_; j++)
+                    s += p[i + j * nc];
+                dst[i] = s;
+            }
+            for (int i = nc; i < n; i++)
+                dst[i] = dst[i - nc] - p[i - nc] + p[i - nc + kWidth_ * nc];
+        };
+
+        auto emit = [&](int y, const int32_t *const *rows) {
+            if (y == 0) {
+                for (int j = 1; j <= kHeight_; j++)
+                    RunningSumRow(rows[j], nullptr, n, colSum.data());
+            } else {
+                RunningSumRow(rows[kHeight_], rows[0], n, colSum.data());
+            }
+            for (int i = 0; i < n; i++)
+                acc[i] = float(colSum[i]);
+            StoreRow(acc.data(), kernel_[0], bias(), n, img.getRow(y));
+        };
+
+        ProcessRowRing<int32_t>(img, kHeight_, n, border_, load, emit);
+    }
+
+    std::vector<float> kernel_;
+
+    std::vector<float> rowK_;
+
+    std::vector<float> colK_;
+
+    int kWidth_ {0};
+
+    int kHeight_ {0};
+
+    bool separable_ {false};
+
+    bool box_ {false};
+
+    CCBorderMode border_ {CCBorderMode::REPLICATE};
+
+    bool truncate_ {false};
+
+    CCConvolutionBackend forced_ {CCConvolutionBackend::AUTO};
+};
+#endif
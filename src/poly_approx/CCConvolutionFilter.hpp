@@ -60,7 +60,8 @@ class CCImageConvolutionFilter {
 
     virtual ~CCImageConvolutionFilter() {}
 
-    virtual void Run(CCImageReader &img) {}
+    // filters work in place on a (possibly strided) view
+    virtual void Run(const CCImageView &img) {}
 
     protected:
 
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "CCCpuFeatures.hpp"
+
+#define CC_ISA_NOT_FORCED (-1)
+
+static CCCpuIsa DetectIsa(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // libgcc checks XGETBV as well, AVX state must be enabled by the OS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return CCCpuIsa::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return CCCpuIsa::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return CCCpuIsa::SSE41;
+#endif
+    return CCCpuIsa::BASELINE;
+}
+
+static int ForcedFromEnvironment(void) {
+    CCCpuIsa isa;
+    const char *env = getenv("CC_FORCE_ISA");
+
+    if (!env)
+        return CC_ISA_NOT_FORCED;
+    if (!CCCpuFeatures::parseIsaName(env, isa)) {
+        // may run before the logger is up
+        std::cerr << "unknown CC_FORCE_ISA " << env << std::endl;
+        return CC_ISA_NOT_FORCED;
+    }
+    return static_cast<int>(isa);
+}
+
+static std::atomic<int> &ForcedIsa(void) {
+    static std::atomic<int> forced(ForcedFromEnvironment());
+    return forced;
+}
+
+CCCpuIsa CCCpuFeatures::getDetectedIsa(void) {
+    static const CCCpuIsa detected = DetectIsa();
+    return detected;
+}
+
+CCCpuIsa CCCpuFeatures::getIsa(void) {
+    int forced = ForcedIsa().load(std::memory_order_relaxed);
+    int detected = static_cast<int>(getDetectedIsa());
+
+    if ((forced == CC_ISA_NOT_FORCED) || (forced > detected))
+        return static_cast<CCCpuIsa>(detected);
+    return static_cast<CCCpuIsa>(forced);
+}
+
+CCCpuIsa CCCpuFeatures::setForcedIsa(CCCpuIsa isa) {
+    ForcedIsa().store(static_cast<int>(isa));
+    return getIsa();
+}
+
+void CCCpuFeatures::clearForcedIsa(void) {
+    ForcedIsa().store(CC_ISA_NOT_FORCED);
+}
+
+const char *CCCpuFeatures::getIsaName(CCCpuIsa isa) {
+    switch (isa) {
+    case CCCpuIsa::BASELINE: return "baseline";
+    case CCCpuIsa::SSE41:    return "sse4.1";
+    case CCCpuIsa::AVX2:     return "avx2";
+    case CCCpuIsa::AVX512:   return "avx512";
+    default:                 return "unknown";
+    }
+}
+
+bool CCCpuFeatures::parseIsaName(const char *name, CCCpuIsa &isa) {
+    for (int i = 0; i < static_cast<int>(CCCpuIsa::NUM_ISA); i++) {
+        if (strcmp(name, getIsaName(static_cast<CCCpuIsa>(i))) == 0) {
+            isa = static_cast<CCCpuIsa>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  CPU Features : instruction set detected at startup, selects the pixel
+ *  kernel table (see CCPixelKernels.hpp). The detected level can be
+ *  lowered for testing with setForcedIsa() or the CC_FORCE_ISA environment
+ *  variable (baseline, sse4.1, avx2, avx512).
+ *
+ */
+
+#ifndef _CCCPUFEATURES_HPP_
+#define _CCCPUFEATURES_HPP_
+
+// ordered, every level implies the ones below it
+enum class CCCpuIsa {
+
+    BASELINE, // whatever the compiler targets, SSE2 on x86-64
+
+    SSE41,
+
+    AVX2,
+
+    AVX512, // F + BW
+
+    NUM_ISA,
+};
+
+class CCCpuFeatures {
+
+    public:
+
+    // best level supported by the CPU and the OS
+    static CCCpuIsa getDetectedIsa(void);
+
+    // level the kernels run at, the detected one unless forced lower
+    static CCCpuIsa getIsa(void);
+
+    // levels above the detected one are clamped, returns the level in use
+    static CCCpuIsa setForcedIsa(CCCpuIsa isa);
+
+    static void clearForcedIsa(void);
+
+    static const char *getIsaName(CCCpuIsa isa);
+
+    // parses the CC_FORCE_ISA names, false if unknown
+    static bool parseIsaName(const char *name, CCCpuIsa &isa);
+};
+#endif
@@ -23,20 +23,117 @@
  * SOFTWARE.
  *
  *
- *  DataSet : An immutable container of data. The container can be fed from
- *  data prepared offline (e.g. image files, *.dat files) or data provided
- *  at run-time (say data from camera frame).
+ *  DataFrame : One frame delivered at run-time (say from a camera). The
+ *  pixel storage is allocated once for the largest frame expected and
+ *  reused for every frame written into it, see CCFrameSource.
  *
  */
 
 #ifndef _CCDATAFRAME_HPP_
 #define _CCDATAFRAME_HPP_
 
-class CCDataFrame {
+#include <cstdint>
 
+#include "CCDataObject.hpp"
+#include "CCImageView.hpp"
+#include "CCImageBuffer.hpp"
 
-};
+class CCDataFrame : public CCDataObject {
 
-#endif
+    public:
+
+    CCDataFrame() {}
+
+    CCDataFrame(const CCDataFrame &) = delete;
+
+    CCDataFrame& operator=(const CCDataFrame &) = delete;
+
+    CCDataFrame(CCDataFrame &&) = default;
+
+    CCDataFrame& operator=(CCDataFrame &&) = default;
+
+    // storage for frames of up to width x height x numChannels
+    bool Allocate(int width, int height, int numChannels) {
+        size_t size = static_cast<size_t>(width) * height * numChannels;
+
+        buffer_ = CCImageBuffer(size);
+        if (!buffer_) {
+            capacity_ = 0;
+            return false;
+        }
+        capacity_ = size;
+        setFormat(width, height, numChannels);
+        return true;
+    }
+
+    // frames smaller than the storage use its first bytes
+    bool setFormat(int width, int height, int numChannels) {
+        if (width <= 0 || height <= 0 || numChannels <= 0 ||
+            static_cast<size_t>(width) * height * numChannels > capacity_)
+            return false;
+        width_ = width;
+        height_ = height;
+        numChannels_ = numChannels;
+        return true;
+    }
+
+    int getWidth(void) const noexcept {
+        return width_;
+    }
+
+    int getHeight(void) const noexcept {
+        return height_;
+    }
+
+    int getNumChannels(void) const noexcept {
+        return numChannels_;
+    }
+
+    size_t getCapacity(void) const noexcept {
+        return capacity_;
+    }
+
+    unsigned char *getData(void) const noexcept {
+        return buffer_.get();
+    }
 
+    CCImageView getView(void) const {
+        return CCImageView(buffer_.get(), width_, height_, width_ * numChannels_, numChannels_);
+    }
 
+    // position of the frame in the stream of its producer
+    uint64_t getSequence(void) const noexcept {
+        return sequence_;
+    }
+
+    void setSequence(uint64_t sequence) noexcept {
+        sequence_ = sequence;
+    }
+
+    // steady clock time the frame was published, in microseconds
+    int64_t getTimestamp(void) const noexcept {
+        return timestamp_;
+    }
+
+    void setTimestamp(int64_t timestamp) noexcept {
+        timestamp_ = timestamp;
+    }
+
+    private:
+
+    CCImageBuffer buffer_;
+
+    size_t capacity_ {0};
+
+    int width_ {0};
+
+    int height_ {0};
+
+    int numChannels_ {0};
+
+    uint64_t sequence_ {0};
+
+    int64_t timestamp_ {0};
+};
+
+#endif
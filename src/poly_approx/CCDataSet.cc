@@ -33,11 +33,17 @@
 #include <dirent.h>
 
 #include <list>
+#include <string>
+#include <vector>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
 #include <cassert>
 
 #include "CCDataSet.hpp"
 #include "CCImageReader.hpp"
+#include "CCLogger.hpp"
+#include "CCTaskScheduler.hpp"
 
 CCDataSet::CCDataSet(const void *source, CCDataSourceType type) :
     CCDataObject(), source_(source), type_(type) {}
@@ -65,30 +71,56 @@ bool CCDataSet::LoadDirectory(void) {
     DIR *dir;
     bool done = false;
     struct dirent *entry;
-    std::list<struct dirent *> direntList;
+    std::vector<std::string> names;
 
+    failedItems_.clear();
     dir = opendir(static_cast<const char *>(source_));
     if (dir == nullptr)
         goto error;
 
-    while ((entry = readdir(dir)) != nullptr)
-        direntList.push_back(entry);
+    // dirent storage is reused by readdir, keep copies of the names
+    while ((entry = readdir(dir)) != nullptr) {
+        if ((strcmp(entry->d_name, ".") != 0) && (strcmp(entry->d_name, "..") != 0))
+            names.push_back(std::string(entry->d_name));
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
 
     switch (type_) {
     case CCDataSourceType::IMG: {
-        for (auto &i : direntList) {
-            if ((strcmp(i->d_name, ".") != 0) && (strcmp(i->d_name, "..") != 0)) {
+        std::vector<CCImageReader *> images(names.size(), nullptr);
+
+        auto decode = [&](int first, int last) {
+            for (int i = first; i < last; i++) {
                 std::string path(static_cast<const char*>(source_));
-                path.append(i->d_name);
+                path.append(names[i]);
                 CCImageReader *imp = new CCImageReader(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
-                done = imp->Load();
-                if (!done) {
-                    std::cerr << path << std::endl;
-                    assert(0);
-                }
-                // prevent object slicing
-                dataItems_.push_back(dynamic_cast<CCDataObject *>(imp));
+                if (imp->Load())
+                    images[i] = imp;
+                else
+                    delete imp;
             }
+        };
+
+        // one image per task, idle threads steal the rest
+        if (numThreads_ == 1)
+            decode(0, names.size());
+        else
+            CCTaskScheduler::getInstance().ParallelFor(0, names.size(), 1, decode);
+
+        // publish in name order
+        for (size_t i = 0; i < images.size(); i++) {
+            if (images[i] == nullptr) {
+                std::string path(static_cast<const char*>(source_));
+                path.append(names[i]);
+                CC_ERR("failed to load", path);
+                failedItems_.push_back(path);
+                continue;
+            }
+            // prevent object slicing
+            dataItems_.push_back(dynamic_cast<CCDataObject *>(images[i]));
+            done = true;
         }
         break;
     }
@@ -96,7 +128,6 @@ bool CCDataSet::LoadDirectory(void) {
         break;
     }
 
-    closedir(dir);
 error:
     return done;
 }
@@ -117,3 +148,11 @@ int CCDataSet::getNumRecords() {
 CCDataSourceType CCDataSet::getSourceType(void) {
     return type_;
 }
+
+void CCDataSet::setNumThreads(int numThreads) {
+    numThreads_ = numThreads;
+}
+
+const std::vector<std::string> &CCDataSet::getFailedItems(void) {
+    return failedItems_;
+}
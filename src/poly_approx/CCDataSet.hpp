@@ -32,7 +32,9 @@
 #define _CCDATASET_HPP_
 
 #include <list>
+#include <string>
 #include <memory>
+#include <vector>
 
 #include "CCDataObject.hpp"
 #include "CCDataSource.hpp"
@@ -47,6 +49,8 @@ class CCDataSet : public CCDataObject {
 
     bool LoadFile(void);
 
+    // decodes the directory entries as tasks of the shared scheduler and
+    // publishes them in name order, succeeds if at least one was loaded
     bool LoadDirectory(void);
 
     bool Destroy(void);
@@ -55,8 +59,20 @@ class CCDataSet : public CCDataObject {
 
     CCDataSourceType getSourceType(void);
 
+    // 1 decodes on the calling thread, any other value uses the shared
+    // task scheduler (see CC_NUM_THREADS)
+    void setNumThreads(int numThreads);
+
+    // paths which could not be loaded by the last LoadDirectory
+    const std::vector<std::string> &getFailedItems(void);
+
     private:
 
+    // 1 or the scheduler
+    int numThreads_ {0};
+
+    std::vector<std::string> failedItems_;
+
     // source
     const void * source_;
 
@@ -35,6 +35,8 @@
 enum class CCImageEDFilter {
 
     SOEBEL,
+
+    CANNY,
 };
 
 // Base Class
@@ -61,7 +63,7 @@ class CCImageDerivativeFilter {
 
     virtual ~CCImageDerivativeFilter() {}
 
-    virtual void Run(CCImageReader &img) {}
+    virtual void Run(const CCImageView &img) {}
 
     protected:
 
@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Distance Transform : exact Euclidean distance from every foreground
+ *  (non-zero) pixel to the nearest background pixel, in time linear in
+ *  the number of pixels (Felzenszwalb-Huttenlocher). The squared distance
+ *  is the lower envelope of parabolas rooted at the background samples,
+ *  computed down the columns and then along the rows.
+ *
+ */
+
+#ifndef _CCDISTANCETRANSFORM_HPP_
+#define _CCDISTANCETRANSFORM_HPP_
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "CCImageView.hpp"
+
+// squared distance of a foreground sample with no background in reach
+#define CC_EDT_INF 1e20f
+
+// d[q] = min_p (q - p)^2 + f[p], v and z hold n and n + 1 elements
+static void DistanceTransform1D(const float *f, int n, float *d, int *v, float *z) {
+    int k = 0;
+
+    v[0] = 0;
+    z[0] = -CC_EDT_INF;
+    z[1] = CC_EDT_INF;
+    for (int q = 1; q < n; q++) {
+        // intersection with the rightmost parabola, z[0] stops the search
+        float s = ((f[q] + float(q) * q) - (f[v[k]] + float(v[k]) * v[k])) / (2.0f * (q - v[k]));
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + float(q) * q) - (f[v[k]] + float(v[k]) * v[k])) / (2.0f * (q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = CC_EDT_INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q)
+            k++;
+        float dq = float(q - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+class CCDistanceTransform {
+
+    public:
+
+    CCDistanceTransform() {}
+
+    virtual ~CCDistanceTransform() {}
+
+    // distances are measured inside the view, pixels outside do not count
+    // as background
+    void Run(const CCImageView &img) {
+        width_  = img.getWidth();
+        height_ = img.getHeight();
+        dist_.assign(width_ * height_, 0.0f);
+
+        int n = std::max(width_, height_);
+        std::vector<float> f(n), d(n), z(n + 1);
+        std::vector<int> v(n);
+
+        // columns, strided through the output plane
+        for (int y = 0; y < height_; y++) {
+            const unsigned char *row = img.getRow(y);
+            for (int x = 0; x < width_; x++)
+                dist_[y * width_ + x] = row[x] ? CC_EDT_INF : 0.0f;
+        }
+        for (int x = 0; x < width_; x++) {
+            for (int y = 0; y < height_; y++)
+                f[y] = dist_[y * width_ + x];
+            DistanceTransform1D(f.data(), height_, d.data(), v.data(), z.data());
+            for (int y = 0; y < height_; y++)
+                dist_[y * width_ + x] = d[y];
+        }
+
+        for (int y = 0; y < height_; y++) {
+            float *row = &dist_[y * width_];
+            DistanceTransform1D(row, width_, d.data(), v.data(), z.data());
+            for (int x = 0; x < width_; x++)
+                row[x] = (d[x] >= CC_EDT_INF) ? CC_EDT_INF : sqrtf(d[x]);
+        }
+    }
+
+    int getWidth(void) const noexcept {
+        return width_;
+    }
+
+    int getHeight(void) const noexcept {
+        return height_;
+    }
+
+    // Euclidean distance per pixel, 0 on the background, CC_EDT_INF when
+    // the view has no background at all
+    const std::vector<float> &getDistance(void) const noexcept {
+        return dist_;
+    }
+
+    private:
+
+    int width_ {0};
+
+    int height_ {0};
+
+    std::vector<float> dist_;
+};
+#endif
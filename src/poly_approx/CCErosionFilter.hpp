@@ -23,14 +23,23 @@
  * SOFTWARE.
  *
  *
- *  Erosion Filter
+ *  Erosion Filter : a pixel stays set (255) when every pixel of the m x n
+ *  window around it is at or above the threshold. The rectangular element
+ *  is separable, so a row minimum over n is followed by a column minimum
+ *  over m on the thresholded mask. Pixels whose window leaves the image
+ *  are cleared.
  *
  */
 
 #ifndef _CCEROSIONFILTER_HPP_
 #define _CCEROSIONFILTER_HPP_
 
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
 #include "CCMorphologicalFilter.hpp"
+#include "CCPixelKernels.hpp"
 
 class CCErosionFilter : public CCMorphologicalFilter {
 
@@ -45,50 +54,79 @@ class CCErosionFilter : public CCMorphologicalFilter {
     virtual ~CCErosionFilter() {
     }
 
-    virtual void Run(CCImageReader &img) {
+    virtual void Run(const CCImageView &img) {
+        RunErosion<0, 0>(img);
+    }
+
+    // M rows by N columns, or m_ x n_ when they are 0. The mask and both
+    // minimum passes use the kernels for the CPU's instruction set.
+    template <int M, int N>
+    void RunErosion(const CCImageView &img) {
+        static_assert((M <= CC_MAX_FIXED_TAPS) && (N <= CC_MAX_FIXED_TAPS),
+                      "no kernel table entry");
+        const CCPixelKernels &kernels = GetPixelKernels();
         int width  = img.getWidth();
         int height = img.getHeight();
-        int numChannel = img.getNumChannels();
-        uint8_t *imgData = img.getDataBlob();
-        uint8_t *imgDst = new uint8_t[width * height * numChannel];
+        // even sizes cover x - n / 2 .. x + n / 2, as the original loop did
+        int m = M ? M : (m_ / 2) * 2 + 1;
+        int n = N ? N : (n_ / 2) * 2 + 1;
+        int half = m / 2;
+        int valid = width - 2 * (n / 2);
+        std::vector<uint8_t> mask(width);
+        std::vector<uint8_t> rowMin(width * height, 0);
+        std::vector<const uint8_t *> rows(std::max(std::max(m, n), 1));
+
+        if (img.empty() || (m <= 0) || (n <= 0))
+            return;
+
+        // thresholds above 255 leave nothing set
+        for (int y = 0; (y < height) && (valid > 0) && (thresh_ <= 255); y++) {
+            kernels.threshold(img.getRow(y), width, std::max(thresh_, 0), mask.data());
+            for (int j = 0; j < n; j++)
+                rows[j] = mask.data() + j;
+            kernels.minRows[N](rows.data(), n, valid, &rowMin[y * width + n / 2]);
+        }
 
-        memset(imgDst, 0, sizeof(uint8_t) * width * height * numChannel);
-        
         for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                bool fmatch = true;
-
-                // boundary cases
-                if ((y - m_/2 < 0) || (y + m_/2 >= height) ||
-                    (x - n_/2 < 0) || (x + n_/2 >= width))  {
-                    continue;
-                }
-
-                if (imgData[y * width + x] < thresh_)
-                    continue;
-                std::cout << "data0 " << x << " " << y << " d: "
-                          << (int)imgData[y * width +x] << std::endl;
-
-                // iterate structural element
-                for (int i = y - m_/2; i <= y + m_/2; i++) {
-                    for (int j = x - n_/2; j <= x + n_/2; j++) {
-                        if (imgData[i * width + j] < thresh_) { // no full match
-                            fmatch = false;
-                            goto out;
-                        }
-                    }
-                }
-
-             out:
-                if (fmatch) {
-                    std::cout << "data :" << x << " " << y << std::endl;
-                    imgDst[y * width + x] = 255;
-                }
+            if ((y - half < 0) || (y + half >= height)) {
+                std::fill(img.getRow(y), img.getRow(y) + width, 0);
+                continue;
             }
+            for (int j = 0; j < m; j++)
+                rows[j] = &rowMin[(y - half + j) * width];
+            kernels.minRows[M](rows.data(), m, width, img.getRow(y));
         }
+    }
+};
+
+// N x N element unrolled at compile time
+template <int N>
+class CCErosionFilterN : public CCErosionFilter {
 
-        memcpy(imgData, imgDst, width * height * numChannel);
-        delete imgDst;
+    public:
+
+    CCErosionFilterN(int t) : CCErosionFilter(N, N, t) {
+    }
+
+    virtual ~CCErosionFilterN() {
+    }
+
+    virtual void Run(const CCImageView &img) {
+        RunErosion<N, N>(img);
     }
 };
+
+// square 3, 5, 7 and 9 elements get a specialized filter
+static CCErosionFilter* CreateErosionFilter(int m, int n, int t) {
+    if (m == n) {
+        switch (m) {
+        case 3: return new CCErosionFilterN<3>(t);
+        case 5: return new CCErosionFilterN<5>(t);
+        case 7: return new CCErosionFilterN<7>(t);
+        case 9: return new CCErosionFilterN<9>(t);
+        default: break;
+        }
+    }
+    return new CCErosionFilter(m, n, t);
+}
 #endif
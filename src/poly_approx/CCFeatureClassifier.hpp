@@ -0,0 +1,259 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  FeatureClassifier : one-vs-rest logistic regression over feature rows,
+ *  e.g. the log-scaled Hu moments of CCMoments. Models come from the
+ *  training scripts in ml/classification, either as CSV with one
+ *  "label,bias,w1,...,wn" line per class or in the binary layout
+ *
+ *      "CCLR" int32 numClasses int32 numFeatures
+ *      numClasses x { int32 label, float bias, float w[numFeatures] }
+ *
+ *  Any feature scaling must be folded into the weights on export.
+ *
+ */
+
+#ifndef _CCFEATURECLASSIFIER_HPP_
+#define _CCFEATURECLASSIFIER_HPP_
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CCLogger.hpp"
+
+#define CC_FEATURE_MODEL_MAGIC "CCLR"
+
+class CCFeatureClassifier {
+
+    public:
+
+    CCFeatureClassifier() {}
+
+    virtual ~CCFeatureClassifier() {}
+
+    // weights are numClasses x numFeatures, row major
+    bool setModel(const std::vector<int> &labels, const std::vector<float> &biases,
+                  const std::vector<float> &weights, int numFeatures) {
+        if ((numFeatures <= 0) || labels.empty() || (biases.size() != labels.size()) ||
+            (weights.size() != labels.size() * numFeatures))
+            return false;
+
+        // rows padded with zeros to whole vectors
+        numFeatures_ = numFeatures;
+        stride_ = (numFeatures + 3) & ~3;
+        labels_ = labels;
+        biases_ = biases;
+        weights_.assign(labels.size() * stride_, 0.0f);
+        for (size_t c = 0; c < labels.size(); c++)
+            std::copy(&weights[c * numFeatures], &weights[(c + 1) * numFeatures], &weights_[c * stride_]);
+        return true;
+    }
+
+    // binary models are recognized by their magic, anything else is CSV
+    bool Load(const std::string &path) {
+        char magic[4] = {0};
+        std::ifstream in(path, std::ios::binary);
+        if (!in.read(magic, sizeof(magic)) || std::string(magic, 4) != CC_FEATURE_MODEL_MAGIC)
+            return LoadCSV(path);
+        return LoadBinary(path);
+    }
+
+    bool LoadCSV(const std::string &path) {
+        std::vector<int> labels;
+        std::vector<float> biases, weights;
+        std::ifstream in(path);
+        std::string line;
+        int numFeatures = -1;
+
+        if (!in)
+            goto error;
+
+        while (std::getline(in, line)) {
+            if (line.empty() || (line[0] == '#'))
+                continue;
+
+            std::vector<float> row;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, ',')) {
+                char *end;
+                row.push_back(strtof(field.c_str(), &end));
+                if (end == field.c_str())
+                    goto error;
+            }
+
+            // every class carries the same number of weights
+            if ((row.size() < 3) || ((numFeatures >= 0) && (int(row.size()) - 2 != numFeatures)))
+                goto error;
+            numFeatures = row.size() - 2;
+            labels.push_back(int(row[0]));
+            biases.push_back(row[1]);
+            weights.insert(weights.end(), row.begin() + 2, row.end());
+        }
+
+        if (!setModel(labels, biases, weights, numFeatures))
+            goto error;
+        return true;
+
+        error:
+        CC_ERR("failed to load model", path);
+        return false;
+    }
+
+    bool LoadBinary(const std::string &path) {
+        std::vector<int> labels;
+        std::vector<float> biases, weights;
+        std::ifstream in(path, std::ios::binary);
+        int32_t numClasses = 0, numFeatures = 0;
+        char magic[4];
+
+        if (!in.read(magic, sizeof(magic)) ||
+            !in.read(reinterpret_cast<char *>(&numClasses), sizeof(numClasses)) ||
+            !in.read(reinterpret_cast<char *>(&numFeatures), sizeof(numFeatures)) ||
+            (numClasses <= 0) || (numFeatures <= 0))
+            goto error;
+
+        weights.resize(numClasses * numFeatures);
+        for (int c = 0; c < numClasses; c++) {
+            int32_t label;
+            float bias;
+            if (!in.read(reinterpret_cast<char *>(&label), sizeof(label)) ||
+                !in.read(reinterpret_cast<char *>(&bias), sizeof(bias)) ||
+                !in.read(reinterpret_cast<char *>(&weights[c * numFeatures]), numFeatures * sizeof(float)))
+                goto error;
+            labels.push_back(label);
+            biases.push_back(bias);
+        }
+
+        if (!setModel(labels, biases, weights, numFeatures))
+            goto error;
+        return true;
+
+        error:
+        CC_ERR("failed to load model", path);
+        return false;
+    }
+
+    bool SaveBinary(const std::string &path) const {
+        std::ofstream out(path, std::ios::binary);
+        int32_t numClasses = labels_.size(), numFeatures = numFeatures_;
+
+        out.write(CC_FEATURE_MODEL_MAGIC, 4);
+        out.write(reinterpret_cast<const char *>(&numClasses), sizeof(numClasses));
+        out.write(reinterpret_cast<const char *>(&numFeatures), sizeof(numFeatures));
+        for (int c = 0; c < numClasses; c++) {
+            int32_t label = labels_[c];
+            out.write(reinterpret_cast<const char *>(&label), sizeof(label));
+            out.write(reinterpret_cast<const char *>(&biases_[c]), sizeof(float));
+            out.write(reinterpret_cast<const char *>(&weights_[c * stride_]), numFeatures_ * sizeof(float));
+        }
+        return bool(out);
+    }
+
+    int getNumClasses(void) const noexcept {
+        return labels_.size();
+    }
+
+    int getNumFeatures(void) const noexcept {
+        return numFeatures_;
+    }
+
+    const std::vector<int> &getLabels(void) const noexcept {
+        return labels_;
+    }
+
+    // class probabilities of a batch, out is rows x getNumClasses(); input
+    // rows are stride floats apart and hold at least getNumFeatures()
+    void Score(const float *features, int rows, int stride, float *out) const {
+        const int numClasses = labels_.size();
+        std::vector<float> x(stride_, 0.0f);
+
+        for (int r = 0; r < rows; r++) {
+            std::copy(features + r * stride, features + r * stride + numFeatures_, x.begin());
+            for (int c = 0; c < numClasses; c++) {
+                float z = biases_[c] + Dot(&x[0], &weights_[c * stride_], stride_);
+                out[r * numClasses + c] = 1.0f / (1.0f + expf(-z));
+            }
+        }
+    }
+
+    // most probable label of every row and, if asked for, its score
+    void Predict(const float *features, int rows, int stride, int *labels,
+                 float *confidence = nullptr) const {
+        const int numClasses = labels_.size();
+        std::vector<float> scores(rows * numClasses);
+
+        Score(features, rows, stride, &scores[0]);
+        for (int r = 0; r < rows; r++) {
+            const float *s = &scores[r * numClasses];
+            const float *best = std::max_element(s, s + numClasses);
+            labels[r] = labels_[best - s];
+            if (confidence)
+                confidence[r] = *best;
+        }
+    }
+
+    private:
+
+    // n is a multiple of 4
+    static float Dot(const float *a, const float *b, int n) {
+        float sum = 0.0f;
+#if defined(__SSE2__)
+        __m128 acc = _mm_setzero_ps();
+        for (int i = 0; i < n; i += 4)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+        for (int i = 0; i < n; i++)
+            sum += a[i] * b[i];
+#endif
+        return sum;
+    }
+
+    int numFeatures_ {0};
+
+    int stride_ {0};
+
+    std::vector<int> labels_;
+
+    std::vector<float> biases_;
+
+    // numClasses x stride_, zero padded
+    std::vector<float> weights_;
+};
+#endif
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include <list>
+#include <vector>
 #include <cassert>
 #include "CCPixel.hpp"
 #include "CCPixelUtils.hpp"
@@ -52,41 +53,50 @@ class CCFeatureExtractor {
 
     virtual ~CCFeatureExtractor() {}
 
-    void Run(CCImageReader &img) {
+    // contours are reported in the coordinates of the parent image; the
+    // tracer walks one byte per pixel, the view must be single channel
+    void Run(const CCImageView &img) {
         byte *src;
-        int height, width, numChannels;
+        int height, width, stride;
 
         src    = img.getDataBlob();
         height = img.getHeight();
         width  = img.getWidth();
-        numChannels = img.getNumChannels();
+        stride = img.getStride();
+        assert(img.getNumChannels() == 1);
 
-        byte *dst = new byte[height * width * numChannels];
-        memset(dst, 0, sizeof(byte) * width * height * numChannels);
+        std::vector<byte> contours(height * width, 0);
+        byte *dst = contours.data();
         for (int i = 0; i < height; i++) {
             for (int j = 0; j < width; j++) {
                 Pixel<int> pixel(j, i);
                 Contour<int> contour =
-                    BorderFollowingStrategy<int>(src, pixel, height, width, dst, contours_list);
+                    BorderFollowingStrategy<int>(src, pixel, height, width, stride, dst, contours_list);
                 if (contour.empty())
                     continue;
                 contour.makeConvexHull();
                 contour.ApproxPoly(dist_threshold_);
                 contour.drawContour(dst, width, height);
                 //contour.drawContourApprox(dst, width, height);
+                contour.Translate(img.getOriginX(), img.getOriginY());
                 if (!IsKnownContour(contour, contours_list))
                     contours_list.push_back(contour);
             }
         }
 
-        memcpy(src, dst, sizeof(byte) * width * height * numChannels);
-        delete dst;
+        for (int i = 0; i < height; i++)
+            memcpy(img.getRow(i), dst + i * width, sizeof(byte) * width);
     }
 
     std::list<Contour<int>> GetFeatures(void) {
         return contours_list;
     }
 
+    // contours accumulate over runs until cleared
+    void Clear(void) {
+        contours_list.clear();
+    }
+
     private:
 
     int dist_threshold_;
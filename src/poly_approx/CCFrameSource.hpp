@@ -0,0 +1,400 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  FrameSource : Frames delivered at run-time by a producer (camera,
+ *  file replay, synthetic generator) into a ring of frames allocated
+ *  once up front. The producer writes into a free slot, the consumer
+ *  borrows the oldest ready slot and processes it in place, nothing is
+ *  allocated or copied per frame beyond what the producer writes.
+ *
+ *  When the consumer falls behind, DROP_OLDEST recycles the oldest frame
+ *  not yet consumed, which keeps the latency under the length of the
+ *  ring. BLOCK stalls the producer until a slot is released instead.
+ *
+ */
+
+#ifndef _CCFRAMESOURCE_HPP_
+#define _CCFRAMESOURCE_HPP_
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <functional>
+#include <condition_variable>
+
+#include "CCLogger.hpp"
+#include "CCDataFrame.hpp"
+#include "CCImageReader.hpp"
+
+enum class CCFramePolicy {
+    DROP_OLDEST,    // overwrite the oldest frame not yet consumed
+    BLOCK,          // wait for the consumer to release a frame
+};
+
+// fills frames in place, called from the thread of the frame source
+class CCFrameProducer {
+
+    public:
+
+    virtual ~CCFrameProducer() {}
+
+    // write the next frame into the storage of frame (setFormat first if
+    // the format changes), false at the end of the stream, in which case
+    // frame must be left untouched
+    virtual bool Produce(CCDataFrame &frame) = 0;
+};
+
+// white square moving over a black background, one step per frame
+class CCSyntheticProducer : public CCFrameProducer {
+
+    public:
+
+    CCSyntheticProducer(int width, int height, int side, int numFrames) :
+        width_(width), height_(height), side_(side), numFrames_(numFrames) {}
+
+    // top left corner of the square in frame n
+    void getPosition(uint64_t n, int &x, int &y) const {
+        x = static_cast<int>((n * 3) % (width_ - side_ + 1));
+        y = static_cast<int>((n * 2) % (height_ - side_ + 1));
+    }
+
+    virtual bool Produce(CCDataFrame &frame) {
+        unsigned char *pData;
+        int x, y;
+
+        if (numFrames_ >= 0 && n_ >= static_cast<uint64_t>(numFrames_))
+            return false;
+        if (!frame.setFormat(width_, height_, 1))
+            return false;
+
+        pData = frame.getData();
+        memset(pData, 0, width_ * height_);
+        getPosition(n_, x, y);
+        for (int r = y; r < y + side_; r++)
+            memset(pData + r * width_ + x, 255, side_);
+        n_++;
+        return true;
+    }
+
+    private:
+
+    int width_;
+
+    int height_;
+
+    int side_;
+
+    int numFrames_;     // < 0 runs until the source is stopped
+
+    uint64_t n_ {0};
+};
+
+// replays gray image files, decoded once when the producer is created
+class CCReplayProducer : public CCFrameProducer {
+
+    public:
+
+    CCReplayProducer(const std::vector<std::string> &paths, int numLoops = 1) :
+        numLoops_(numLoops) {
+        for (const std::string &path : paths) {
+            CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+            bool ok = false;
+
+            if (rgb.Load()) {
+                CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+                if (ok)
+                    frames_.push_back(std::move(gray));
+            }
+            if (!ok)
+                CC_ERR("failed to load frame", path);
+        }
+    }
+
+    int getNumFrames(void) const {
+        return static_cast<int>(frames_.size());
+    }
+
+    virtual bool Produce(CCDataFrame &frame) {
+        if (frames_.empty() || (numLoops_ >= 0 && loop_ >= numLoops_))
+            return false;
+
+        CCImageReader &img = frames_[next_];
+        if (!frame.setFormat(img.getWidth(), img.getHeight(), img.getNumChannels())) {
+            CC_ERR("frame does not fit the ring", next_);
+            return false;
+        }
+        memcpy(frame.getData(), img.getDataBlob(), img.getSize() * img.getNumChannels());
+
+        if (++next_ == static_cast<int>(frames_.size())) {
+            next_ = 0;
+            loop_++;
+        }
+        return true;
+    }
+
+    private:
+
+    std::vector<CCImageReader> frames_;
+
+    int numLoops_;      // < 0 loops until the source is stopped
+
+    int loop_ {0};
+
+    int next_ {0};
+};
+
+class CCFrameSource {
+
+    public:
+
+    // numSlots frames of up to width x height x numChannels
+    CCFrameSource(std::shared_ptr<CCFrameProducer> producer, int width, int height,
+        int numChannels, int numSlots, CCFramePolicy policy = CCFramePolicy::DROP_OLDEST) :
+        producer_(producer), slots_(numSlots), policy_(policy) {
+        for (CCDataFrame &frame : slots_) {
+            if (!frame.Allocate(width, height, numChannels))
+                CC_ERR("failed to allocate frame", width, height, numChannels);
+            free_.push_back(&frame);
+        }
+    }
+
+    CCFrameSource(const CCFrameSource &) = delete;
+
+    CCFrameSource& operator=(const CCFrameSource &) = delete;
+
+    ~CCFrameSource() {
+        Stop();
+    }
+
+    // run the producer on a thread of its own, fps > 0 paces the frames;
+    // after Stop() the producer resumes where it was, sequences go on
+    void Start(double fps = 0) {
+        if (thread_.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = false;
+            finished_ = false;
+        }
+        thread_ = std::thread([this, fps]() {
+            Produce(fps);
+        });
+    }
+
+    // stop the producer, frames already published can still be consumed
+    void Stop(void) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    // borrow the oldest frame not yet consumed, nullptr at the end of the
+    // stream or when no frame is published within timeout (< 0 waits)
+    CCDataFrame *Acquire(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ready = [this]() { return !ready_.empty() || finished_; };
+        CCDataFrame *frame;
+
+        if (timeout.count() < 0)
+            cv_.wait(lock, ready);
+        else if (!cv_.wait_for(lock, timeout, ready))
+            return nullptr;
+        if (ready_.empty())
+            return nullptr;
+
+        frame = ready_.front();
+        ready_.pop_front();
+        numConsumed_++;
+        return frame;
+    }
+
+    // hand a frame obtained by Acquire back to the producer
+    void Release(CCDataFrame *frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(frame);
+        }
+        cv_.notify_all();
+    }
+
+    // run fn on every frame in place until the end of the stream
+    size_t Consume(const std::function<void (CCDataFrame &)> &fn) {
+        size_t n = 0;
+        CCDataFrame *frame;
+
+        while ((frame = Acquire()) != nullptr) {
+            fn(*frame);
+            Release(frame);
+            n++;
+        }
+        return n;
+    }
+
+    // the producer ran out of frames or was stopped
+    bool isFinished(void) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return finished_;
+    }
+
+    int getNumSlots(void) const {
+        return static_cast<int>(slots_.size());
+    }
+
+    CCFramePolicy getPolicy(void) const {
+        return policy_;
+    }
+
+    size_t getNumProduced(void) const {
+        return numProduced_;
+    }
+
+    size_t getNumDropped(void) const {
+        return numDropped_;
+    }
+
+    size_t getNumConsumed(void) const {
+        return numConsumed_;
+    }
+
+    private:
+
+    void Produce(double fps) {
+        typedef std::chrono::steady_clock clock;
+        auto period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(fps > 0 ? 1.0 / fps : 0.0));
+        clock::time_point next = clock::now();
+        CCDataFrame *frame;
+        bool dropped;
+
+        while ((frame = AcquireFree(dropped)) != nullptr) {
+            if (!producer_->Produce(*frame)) {
+                Restore(frame, dropped);
+                break;
+            }
+            frame->setSequence(sequence_++);
+            frame->setTimestamp(std::chrono::duration_cast<std::chrono::microseconds>(
+                clock::now().time_since_epoch()).count());
+            Publish(frame, dropped);
+
+            if (fps > 0) {
+                next += period;
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (cv_.wait_until(lock, next, [this]() { return stopped_; }))
+                    break;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // a slot to write the next frame into, nullptr once stopped; dropped
+    // tells whether it held a frame the consumer has not seen
+    CCDataFrame *AcquireFree(bool &dropped) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        CCDataFrame *frame;
+
+        for (;;) {
+            if (stopped_)
+                return nullptr;
+            dropped = free_.empty();
+            if (!dropped) {
+                frame = free_.front();
+                free_.pop_front();
+                return frame;
+            }
+            if (policy_ == CCFramePolicy::DROP_OLDEST && !ready_.empty()) {
+                frame = ready_.front();
+                ready_.pop_front();
+                return frame;
+            }
+            // BLOCK, or every slot is borrowed by the consumer
+            cv_.wait(lock);
+        }
+    }
+
+    void Publish(CCDataFrame *frame, bool dropped) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(frame);
+            numProduced_++;
+            numDropped_ += dropped;
+        }
+        cv_.notify_all();
+    }
+
+    // the stream ended, the slot goes back where AcquireFree found it
+    void Restore(CCDataFrame *frame, bool dropped) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dropped)
+            ready_.push_front(frame);
+        else
+            free_.push_front(frame);
+    }
+
+    std::shared_ptr<CCFrameProducer> producer_;
+
+    std::vector<CCDataFrame> slots_;
+
+    std::deque<CCDataFrame *> free_;
+
+    std::deque<CCDataFrame *> ready_;   // oldest first
+
+    CCFramePolicy policy_;
+
+    std::mutex mutex_;
+
+    std::condition_variable cv_;
+
+    std::thread thread_;
+
+    bool stopped_ {false};
+
+    bool finished_ {false};
+
+    // written by the producer thread only
+    uint64_t sequence_ {0};
+
+    std::atomic<size_t> numProduced_ {0};
+
+    std::atomic<size_t> numDropped_ {0};
+
+    std::atomic<size_t> numConsumed_ {0};
+};
+
+#endif
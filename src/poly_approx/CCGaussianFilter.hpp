@@ -25,17 +25,133 @@
  *
  *  Gaussian Filter
  *
+ *  KERNEL      : sampled dimX x dimY kernel on the convolution engine
+ *  FIXED_POINT : same kernel with 16-bit integer coefficients, Q8 for the
+ *                row pass and Q16 for the column pass (8 to 32 pixels per
+ *                step depending on the instruction set, CCPixelKernels).
+ *                Rounds and saturates to 8 bits.
+ *  RECURSIVE   : Young-van Vliet third order IIR approximation, forward and
+ *                backward along rows then columns. Cost per pixel does not
+ *                depend on sigma, columns are filtered four at a time.
+ *
  */
 
 #ifndef _CCGAUSSIANFILTER_HPP_
 #define _CCGAUSSIANFILTER_HPP_
 
 #include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "CCConvolutionFilter.hpp"
+#include "CCConvolutionEngine.hpp"
+#include "CCPixelKernels.hpp"
+
+enum class CCGaussianMode {
+
+    KERNEL,
+
+    FIXED_POINT,
+
+    RECURSIVE,
+};
+
+// Young-van Vliet recursion coefficients, normalized by b0
+struct CCRecursiveGaussianCoeffs {
+
+    float B;
+
+    float b1, b2, b3;
+
+    explicit CCRecursiveGaussianCoeffs(float sigma) {
+        float q;
+        if (sigma >= 2.5f)
+            q = 0.98711f * sigma - 0.96330f;
+        else
+            q = 3.97156f - 4.14554f * sqrtf(1.0f - 0.26891f * sigma);
+
+        float q2 = q * q, q3 = q2 * q;
+        float b0 = 1.57825f + 2.44413f * q + 1.4281f * q2 + 0.422205f * q3;
+        b1 = (2.44413f * q + 2.85619f * q2 + 1.26661f * q3) / b0;
+        b2 = -(1.4281f * q2 + 1.26661f * q3) / b0;
+        b3 = (0.422205f * q3) / b0;
+        B  = 1.0f - (b1 + b2 + b3);
+    }
+};
+
+// causal then anti-causal pass over n samples spaced by step, edges replicated
+static void RecursiveGaussian1D(float *v, int n, int step, const CCRecursiveGaussianCoeffs &k) {
+    float w1, w2, w3;
+
+    w1 = w2 = w3 = v[0];
+    for (int i = 0; i < n; i++) {
+        float w = k.B * v[i * step] + k.b1 * w1 + k.b2 * w2 + k.b3 * w3;
+        v[i * step] = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+
+    w1 = w2 = w3 = v[(n - 1) * step];
+    for (int i = n - 1; i >= 0; i--) {
+        float w = k.B * v[i * step] + k.b1 * w1 + k.b2 * w2 + k.b3 * w3;
+        v[i * step] = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+}
+
+// same recursion down the rows of a width x height plane, every column
+// advances in lock step so the inner loop runs across columns
+static void RecursiveGaussianColumns(float *v, int width, int height,
+                                     const CCRecursiveGaussianCoeffs &k) {
+    if (height <= 0)
+        return;
+
+    // rows y - 1, y - 2 and y - 3 of the running output
+    std::vector<float> hist(3 * width);
+    float *h1 = &hist[0], *h2 = &hist[width], *h3 = &hist[2 * width];
+
+    for (int pass = 0; pass < 2; pass++) {
+        int first = pass ? height - 1 : 0;
+        int dy    = pass ? -1 : 1;
+
+        for (int x = 0; x < width; x++)
+            h1[x] = h2[x] = h3[x] = v[first * width + x];
+
+        for (int i = 0, y = first; i < height; i++, y += dy) {
+            float *row = v + y * width;
+            int x = 0;
+#if defined(__SSE2__)
+            __m128 B  = _mm_set1_ps(k.B),  b1 = _mm_set1_ps(k.b1);
+            __m128 b2 = _mm_set1_ps(k.b2), b3 = _mm_set1_ps(k.b3);
+            for (; x + 4 <= width; x += 4) {
+                __m128 w = _mm_mul_ps(B, _mm_loadu_ps(row + x));
+                w = _mm_add_ps(w, _mm_mul_ps(b1, _mm_loadu_ps(h1 + x)));
+                w = _mm_add_ps(w, _mm_mul_ps(b2, _mm_loadu_ps(h2 + x)));
+                w = _mm_add_ps(w, _mm_mul_ps(b3, _mm_loadu_ps(h3 + x)));
+                _mm_storeu_ps(row + x, w);
+            }
+#endif
+            for (; x < width; x++)
+                row[x] = k.B * row[x] + k.b1 * h1[x] + k.b2 * h2[x] + k.b3 * h3[x];
+
+            // rotate history, h1 becomes the row just written
+            float *t = h3;
+            h3 = h2;
+            h2 = h1;
+            h1 = t;
+            memcpy(h1, row, width * sizeof(float));
+        }
+    }
+}
 
 static float* CreateGaussianKernel(const int kernelWidth=5, const float kernelSigma=1.0) {
     float *A = new float[kernelWidth];
-    for (int x = -(kernelWidth - 1)/2, i = 0; x <= (kernelWidth + 1)/2; x++, i++){
+    for (int x = -(kernelWidth - 1)/2, i = 0; i < kernelWidth; x++, i++){
         const float variance  = std::pow(kernelSigma, 2);
         const float distance  = expf(-(std::pow(x, 2)/(2 * variance)));
         const float kernel    = distance / sqrt((2 * M_PI * variance));
@@ -50,27 +166,42 @@ class CCGaussianFilter : public CCImageConvolutionFilter {
 
     CCGaussianFilter() : CCImageConvolutionFilter(5, 0), variance(1.0) {
         A = CreateGaussianKernel(dimX, variance);
+        InitKernels();
     }
 
     CCGaussianFilter(int dX, int dY, float var) : CCImageConvolutionFilter(dX, dY), variance(var) {
         A = CreateGaussianKernel(dimX, variance);
+        InitKernels();
+    }
+
+    // var is the kernel sigma, dX/dY only matter in KERNEL mode
+    CCGaussianFilter(int dX, int dY, float var, CCGaussianMode mode) :
+        CCImageConvolutionFilter(dX, dY), variance(var), mode_(mode) {
+        A = CreateGaussianKernel(dimX, variance);
+        InitKernels();
     }
 
     CCGaussianFilter(const CCGaussianFilter &cv) : CCImageConvolutionFilter(cv) {
         variance = cv.variance;
+        mode_ = cv.mode_;
         A = CreateGaussianKernel(dimX, variance);
+        InitKernels();
     }
 
     CCGaussianFilter& operator=(const CCGaussianFilter &cv) {
         CCImageConvolutionFilter::operator=(cv);
         variance = cv.variance;
+        mode_ = cv.mode_;
+        if (A)
+            delete[] A;
         A = CreateGaussianKernel(dimX, variance);
+        InitKernels();
         return *this;
     }
 
     virtual ~CCGaussianFilter() {
         if (A)
-            delete A;
+            delete[] A;
         A = nullptr;
     }
 
@@ -80,48 +211,148 @@ class CCGaussianFilter : public CCImageConvolutionFilter {
         printf("\n");
     }
 
-    virtual void Run(CCImageReader &img) {
+    virtual void Run(const CCImageView &img) {
+        // the recursion coefficients are only valid for sigma >= 0.5
+        if ((mode_ == CCGaussianMode::RECURSIVE) && (variance >= 0.5f))
+            RunRecursive(img);
+        else if ((mode_ == CCGaussianMode::FIXED_POINT) && (img.getNumChannels() == 1))
+            RunFixedPoint(img);
+        else
+            RunKernel(img);
+    }
+
+    void RunFixedPoint(const CCImageView &img) {
+        RunFixedPoint<0>(img);
+    }
+
+    // N taps in both directions, or dimX across and dimY down when N is 0.
+    // Row kernels come from the table for the CPU's instruction set.
+    template <int N>
+    void RunFixedPoint(const CCImageView &img) {
+        static_assert(N <= CC_MAX_FIXED_TAPS, "no kernel table entry");
+        const CCPixelKernels &kernels = GetPixelKernels();
         int width  = img.getWidth();
         int height = img.getHeight();
-        int numChannel = img.getNumChannels();
-        uint8_t *imgData = img.getDataBlob();
+        int taps   = N ? N : q8_.size();
+        int half   = taps / 2;
+        int vtaps  = N ? N : q16_.size();
+        int vhalf  = vtaps / 2;
+        std::vector<uint8_t> padded(width + taps, 0);
+        std::vector<uint16_t> plane(width * height);
+        std::vector<const uint16_t *> rows(std::max(vtaps, 1));
 
-        //printf ("width :%d height :%d numChannels :%d\n",
-        //    width, height, numChannel);
-
-        float *storeBuffer = new float[width * height * numChannel];
+        for (int r = 0; r < height; r++) {
+            memcpy(&padded[half], img.getRow(r), width);
+            kernels.gaussianRow[N](padded.data(), width, q8_.data(), taps, &plane[r * width]);
+        }
 
+        // rows beyond the border contribute nothing, as in RunKernel
         for (int r = 0; r < height; r++) {
-            for (int c = 0; c < width; c++) {
-                float accum = 0;
-                for (int j = 0, k = c - dimX/2; j < dimX; j++, k++) {
-                    if ((k < 0) || (k >= width))
-                        continue;
-                    accum += (A[j] * float(imgData[r * width + k]));
-                }
-                storeBuffer[r * width + c] = accum;
+            for (int j = 0; j < vtaps; j++) {
+                int k = r - vhalf + j;
+                rows[j] = ((k < 0) || (k >= height)) ? nullptr : &plane[k * width];
             }
+            kernels.gaussianColumn[N](rows.data(), q16_.data(), vtaps, width, img.getRow(r));
         }
+    }
 
-        for (int c = 0; c < width; c++) {
-            for (int r = 0; r < height; r++) {
-                float accum = 0;
-                for (int j = 0, k = r - dimY/2; j < dimY; j++, k++) {
-                    if ((k < 0) || (k >= height))
-                        continue;
-                    accum += (A[j] * storeBuffer[k * width + c]);
-                }
-                imgData[r * width + c] = std::min<uint8_t>(static_cast<uint8_t>(accum), 255);
-            }
+    void RunRecursive(const CCImageView &img) {
+        int width  = img.getWidth();
+        int height = img.getHeight();
+        CCRecursiveGaussianCoeffs k(variance);
+        std::vector<float> plane(width * height);
+
+        for (int r = 0; r < height; r++) {
+            uint8_t *imgRow = img.getRow(r);
+            float *row = &plane[r * width];
+            for (int c = 0; c < width; c++)
+                row[c] = imgRow[c];
+            RecursiveGaussian1D(row, width, 1, k);
         }
 
-        delete storeBuffer;
+        RecursiveGaussianColumns(plane.data(), width, height, k);
+
+        for (int r = 0; r < height; r++) {
+            uint8_t *imgRow = img.getRow(r);
+            const float *row = &plane[r * width];
+            for (int c = 0; c < width; c++)
+                imgRow[c] = static_cast<uint8_t>(std::min(std::max(row[c] + 0.5f, 0.0f), 255.0f));
+        }
+    }
+
+    // zero border, as the fixed-point path
+    void RunKernel(const CCImageView &img) {
+        engine_.Run(img);
     }
 
     private:
 
+    // engine taps and coefficients of the integer path, computed once
+    // per instance; rows take the dimX kernel, columns the dimY one
+    void InitKernels(void) {
+        q8_.resize(std::max(dimX, 0));
+        q16_.resize(std::max(dimY, 0));
+        for (int j = 0; j < dimX; j++)
+            q8_[j] = std::min<long>(lroundf(A[j] * 256.0f), 256);
+        if ((dimX <= 0) || (dimY <= 0))
+            return;
+
+        float *col = CreateGaussianKernel(dimY, variance);
+        for (int j = 0; j < dimY; j++)
+            q16_[j] = std::min<long>(lroundf(col[j] * 65536.0f), 65535);
+
+        // the sampled taps as they are and truncated sums, as the float
+        // loops the engine replaced
+        engine_.setBorderMode(CCBorderMode::ZERO);
+        engine_.setTruncation(true);
+        engine_.setKernel(std::vector<float>(A, A + dimX), std::vector<float>(col, col + dimY));
+        delete[] col;
+    }
+
     float *A {nullptr};
 
+    std::vector<uint16_t> q8_;
+
+    std::vector<uint16_t> q16_;
+
     float variance;
+
+    CCConvolutionEngine engine_;
+
+    protected:
+
+    CCGaussianMode mode_ {CCGaussianMode::KERNEL};
 };
+
+// N x N kernel with the fixed-point passes unrolled at compile time
+template <int N>
+class CCGaussianFilterN : public CCGaussianFilter {
+
+    public:
+
+    CCGaussianFilterN(float var, CCGaussianMode mode) : CCGaussianFilter(N, N, var, mode) {}
+
+    virtual ~CCGaussianFilterN() {}
+
+    virtual void Run(const CCImageView &img) {
+        if ((mode_ == CCGaussianMode::FIXED_POINT) && (img.getNumChannels() == 1))
+            RunFixedPoint<N>(img);
+        else
+            CCGaussianFilter::Run(img);
+    }
+};
+
+// square 3, 5, 7 and 9 tap kernels get a specialized filter
+static CCGaussianFilter* CreateGaussianFilter(int dimX, int dimY, float var, CCGaussianMode mode) {
+    if (dimX == dimY) {
+        switch (dimX) {
+        case 3: return new CCGaussianFilterN<3>(var, mode);
+        case 5: return new CCGaussianFilterN<5>(var, mode);
+        case 7: return new CCGaussianFilterN<7>(var, mode);
+        case 9: return new CCGaussianFilterN<9>(var, mode);
+        default: break;
+        }
+    }
+    return new CCGaussianFilter(dimX, dimY, var, mode);
+}
 #endif
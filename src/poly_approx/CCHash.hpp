@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Hash : XXH64 (xxHash, 64-bit) of a block of memory or of the bytes of a
+ *  file. Fast, not cryptographic; used to recognise inputs seen before.
+ *  Words are read in host order, the values match the reference
+ *  implementation on little-endian machines.
+ *
+ */
+
+#ifndef _CCHASH_HPP_
+#define _CCHASH_HPP_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+static const uint64_t CC_XXH_PRIME1 = 11400714785074694791ULL;
+static const uint64_t CC_XXH_PRIME2 = 14029467366897019727ULL;
+static const uint64_t CC_XXH_PRIME3 = 1609587929392839161ULL;
+static const uint64_t CC_XXH_PRIME4 = 9650029242287828579ULL;
+static const uint64_t CC_XXH_PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t CCRotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t CCRead64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t CCRead32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t CCXXHRound(uint64_t acc, uint64_t input) {
+    acc += input * CC_XXH_PRIME2;
+    return CCRotl64(acc, 31) * CC_XXH_PRIME1;
+}
+
+static inline uint64_t CCXXHMerge(uint64_t acc, uint64_t v) {
+    acc ^= CCXXHRound(0, v);
+    return acc * CC_XXH_PRIME1 + CC_XXH_PRIME4;
+}
+
+static inline uint64_t CCHash64(const void *data, size_t len, uint64_t seed = 0) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + CC_XXH_PRIME1 + CC_XXH_PRIME2, v2 = seed + CC_XXH_PRIME2;
+        uint64_t v3 = seed, v4 = seed - CC_XXH_PRIME1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = CCXXHRound(v1, CCRead64(p));
+            v2 = CCXXHRound(v2, CCRead64(p + 8));
+            v3 = CCXXHRound(v3, CCRead64(p + 16));
+            v4 = CCXXHRound(v4, CCRead64(p + 24));
+        }
+        h = CCRotl64(v1, 1) + CCRotl64(v2, 7) + CCRotl64(v3, 12) + CCRotl64(v4, 18);
+        h = CCXXHMerge(h, v1);
+        h = CCXXHMerge(h, v2);
+        h = CCXXHMerge(h, v3);
+        h = CCXXHMerge(h, v4);
+    } else {
+        h = seed + CC_XXH_PRIME5;
+    }
+    h += len;
+
+    for (; p + 8 <= end; p += 8)
+        h = CCRotl64(h ^ CCXXHRound(0, CCRead64(p)), 27) * CC_XXH_PRIME1 + CC_XXH_PRIME4;
+    if (p + 4 <= end) {
+        h = CCRotl64(h ^ (CCRead32(p) * CC_XXH_PRIME1), 23) * CC_XXH_PRIME2 + CC_XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = CCRotl64(h ^ (*p * CC_XXH_PRIME5), 11) * CC_XXH_PRIME1;
+
+    // avalanche
+    h ^= h >> 33;
+    h *= CC_XXH_PRIME2;
+    h ^= h >> 29;
+    h *= CC_XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t CCHash64(const std::string &s, uint64_t seed = 0) {
+    return CCHash64(s.data(), s.size(), seed);
+}
+
+// reads the whole file into bytes, false if it cannot be read
+static inline bool CCReadFile(const std::string &path, std::vector<unsigned char> &bytes) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+static inline bool CCHashFile(const std::string &path, uint64_t &hash) {
+    std::vector<unsigned char> bytes;
+    if (!CCReadFile(path, bytes))
+        return false;
+    hash = CCHash64(bytes.data(), bytes.size());
+    return true;
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  ImageBuffer Class : Owning pixel storage for images. The buffer is
+ *  movable but not copyable, deep copies must be requested explicitly.
+ *
+ */
+
+#ifndef _CCIMAGEBUFFER_HPP_
+#define _CCIMAGEBUFFER_HPP_
+
+#include <cstdlib>
+#include <cstring>
+
+// owns a malloc'ed blob (the allocator used by stb_image)
+class CCImageBuffer {
+
+    public:
+
+    CCImageBuffer() {}
+
+    explicit CCImageBuffer(size_t size) :
+        data_(static_cast<unsigned char *>(malloc(size))) {}
+
+    // adopt a blob allocated with malloc (e.g. stbi_load)
+    explicit CCImageBuffer(unsigned char *data) : data_(data) {}
+
+    CCImageBuffer(const CCImageBuffer &) = delete;
+
+    CCImageBuffer& operator=(const CCImageBuffer &) = delete;
+
+    CCImageBuffer(CCImageBuffer &&buf) noexcept : data_(buf.data_) {
+        buf.data_ = nullptr;
+    }
+
+    CCImageBuffer& operator=(CCImageBuffer &&buf) noexcept {
+        if (this != &buf) {
+            reset(buf.data_);
+            buf.data_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~CCImageBuffer() {
+        reset();
+    }
+
+    unsigned char *get(void) const noexcept {
+        return data_;
+    }
+
+    // give up ownership without freeing
+    unsigned char *release(void) noexcept {
+        unsigned char *data = data_;
+        data_ = nullptr;
+        return data;
+    }
+
+    void reset(unsigned char *data = nullptr) noexcept {
+        if (data_ && data_ != data)
+            free(data_);
+        data_ = data;
+    }
+
+    CCImageBuffer clone(size_t size) const {
+        CCImageBuffer buf;
+        if (data_ == nullptr)
+            return buf;
+        buf.reset(static_cast<unsigned char *>(malloc(size)));
+        if (buf.get())
+            memcpy(buf.get(), data_, size);
+        return buf;
+    }
+
+    explicit operator bool() const noexcept {
+        return data_ != nullptr;
+    }
+
+    private:
+
+    unsigned char *data_ {nullptr};
+};
+
+#endif
@@ -30,6 +30,7 @@
 #ifndef _CCIMAGECLASSIFIER_HPP_
 #define _CCIMAGECLASSIFIER_HPP_
 
+#include <climits>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -41,6 +42,80 @@
 #include "CCFeatureExtractor.hpp"
 #include "CCImageReader.hpp"
 
+// label of components that are not classified
+#define CC_LABEL_NONE (-1)
+
+// one traced contour, the input of a classification batch
+struct CCContourDescriptor {
+
+    int numVertices;
+
+    int minX, minY; // inclusive bounding box
+
+    int maxX, maxY;
+};
+
+// outcome of a batch: a label and a confidence per component, in batch
+// order, and the number of components per label
+struct CCClassification {
+
+    std::vector<int> labels;
+
+    std::vector<float> confidence;
+
+    std::vector<int> counts; // indexed by label
+
+    void Clear(void) {
+        labels.clear();
+        confidence.clear();
+        counts.clear();
+    }
+
+    void Add(int label, float conf) {
+        labels.push_back(label);
+        confidence.push_back(label == CC_LABEL_NONE ? 0.0f : conf);
+        if (label == CC_LABEL_NONE)
+            return;
+        if (label >= int(counts.size()))
+            counts.resize(label + 1, 0);
+        counts[label]++;
+    }
+
+    // removes a component from the counts, its label becomes CC_LABEL_NONE
+    void Drop(int i) {
+        if (labels[i] == CC_LABEL_NONE)
+            return;
+        counts[labels[i]]--;
+        labels[i] = CC_LABEL_NONE;
+        confidence[i] = 0.0f;
+    }
+
+    int getCount(int label) const {
+        return ((label >= 0) && (label < int(counts.size()))) ? counts[label] : 0;
+    }
+
+    int getNumClassified(void) const {
+        int n = 0;
+        for (int c : counts)
+            n += c;
+        return n;
+    }
+
+    // every expected label needs a component of its own
+    bool Matches(const std::vector<int> &expected) const {
+        if (!getNumClassified())
+            return false;
+
+        std::vector<int> left(counts);
+        for (int v : expected) {
+            if ((v < 0) || (v >= int(left.size())) || (left[v] == 0))
+                return false;
+            left[v]--;
+        }
+        return true;
+    }
+};
+
 // Image processor
 class CCImageClassifier {
 
@@ -50,9 +125,84 @@ class CCImageClassifier {
 
    ~CCImageClassifier() {}
 
-   static std::vector<int> CountVertices(std::list<Contour<int>> &approxContours) {
+   static void Describe(const std::list<Contour<int>> &contours,
+                        std::vector<CCContourDescriptor> &batch) {
+        batch.clear();
+        batch.reserve(contours.size());
+        for (auto &c : contours) {
+            CCContourDescriptor d {int(c.getSize()), INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+            for (auto &p : c.boundaryPixels) {
+                d.minX = std::min(d.minX, p.getX());
+                d.minY = std::min(d.minY, p.getY());
+                d.maxX = std::max(d.maxX, p.getX());
+                d.maxY = std::max(d.maxY, p.getY());
+            }
+            batch.push_back(d);
+        }
+   }
+
+   // the label is the number of polygon vertices; contours with fewer
+   // than three are not shapes. The tracer also reports the frame of the
+   // thresholded region as a 4-vertex polygon, the first one is dropped
+   // unless dropBoundarySquare is false
+   static void ClassifyVertices(const CCContourDescriptor *batch, int n,
+                                CCClassification &result, bool dropBoundarySquare = true) {
+        result.Clear();
+        result.labels.reserve(n);
+        result.confidence.reserve(n);
+        for (int i = 0; i < n; i++)
+            result.Add((batch[i].numVertices <= 2) ? CC_LABEL_NONE : batch[i].numVertices, 1.0f);
+
+        if (!dropBoundarySquare)
+            return;
+        auto it = std::find(result.labels.begin(), result.labels.end(), 4);
+        if (it != result.labels.end())
+            result.Drop(it - result.labels.begin());
+   }
+
+   // pixel dumps of every contour are diagnostics, off by default
+   static std::vector<int> CountVertices(std::list<Contour<int>> &approxContours,
+                                         bool diagnostics = false) {
+        std::vector<CCContourDescriptor> batch;
+        CCClassification classification;
         std::vector<int> result;
 
+        if (diagnostics)
+            PrintContours(approxContours);
+
+        Describe(approxContours, batch);
+        ClassifyVertices(batch.data(), batch.size(), classification);
+        for (int l : classification.labels)
+            if (l != CC_LABEL_NONE)
+                result.push_back(l);
+        return result;
+   }
+
+   static bool DetectShapes(std::list<Contour<int>> &approxContours,
+                            std::vector<int> vertices, bool diagnostics = false) {
+        std::vector<CCContourDescriptor> batch;
+        CCClassification classification;
+
+        if (diagnostics)
+            PrintContours(approxContours);
+
+        Describe(approxContours, batch);
+        ClassifyVertices(batch.data(), batch.size(), classification);
+        return Report(classification.Matches(vertices));
+   }
+
+   static bool Report(bool match) {
+        if (match) {
+            CC_INFO("MATCH");
+            CONSOLE_INFO("MATCH");
+        } else {
+            CC_INFO("MISMATCH");
+            CONSOLE_INFO("MISMATCH");
+        }
+        return match;
+   }
+
+   static void PrintContours(std::list<Contour<int>> &approxContours) {
         for (auto &c : approxContours) {
 
            int nr_vertices = c.getSize();
@@ -64,48 +214,14 @@ class CCImageClassifier {
 
            CC_INFO("Polygon ID ", c.getUUId(), "(", nr_vertices, ")");
            CONSOLE_INFO("Polygon ID", c.getUUId(), " (", nr_vertices, ")");
-           
+
            std::cout << "[" << " ";
            for (auto &p : c.boundaryPixels) {
               std::cout << " (" << p.getX() << "," << p.getY() << ")" << ",";
               CC_INFO("CTOUR", c.getUUId(), p.getX(), p.getY());
            }
            std::cout << "]" << " " << std::endl;
-           result.push_back(nr_vertices);
-        }
-
-        // Get rid of boundary square
-        auto it = std::find(result.begin(), result.end(), 4);
-        if (it != result.end())
-            result.erase(it);
-
-        return result;
-   }
-
-   static bool DetectShapes(std::list<Contour<int>> &approxContours,
-                            std::vector<int> vertices) {
-        std::vector<int> result;
-
-        result = CCImageClassifier::CountVertices(approxContours);
-        if (!result.size())
-            goto error;
-
-        for (int &v : vertices) {
-            auto it = std::find(result.begin(), result.end(), v);
-            if (it != result.end())
-                result.erase(it);
-            else
-                goto error;
         }
-
-        CC_INFO("MATCH");
-        CONSOLE_INFO("MATCH");
-        return true;
-
-        error:
-        CC_INFO("MISMATCH");
-        CONSOLE_INFO("MISMATCH");
-        return false;
    }
 };
 #endif
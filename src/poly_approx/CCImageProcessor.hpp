@@ -30,19 +30,42 @@
 #ifndef _CCIMAGEPROCESSOR_HPP_
 #define _CCIMAGEPROCESSOR_HPP_
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
+#include <cstdio>
+#include <cstdint>
 
 #include "CCConvolutionFilter.hpp"
 #include "CCGaussianFilter.hpp"
+#include "CCBoxFilter.hpp"
+#include "CCMedianFilter.hpp"
 #include "CCDerivativeFilter.hpp"
 #include "CCSoebelFilter.hpp"
+#include "CCCannyFilter.hpp"
 #include "CCMorphologicalFilter.hpp"
 #include "CCErosionFilter.hpp"
 #include "CCFeatureExtractor.hpp"
 #include "CCImageClassifier.hpp"
 #include "CCImageReader.hpp"
+#include "CCDataFrame.hpp"
+#include "CCImagePyramid.hpp"
+#include "CCConnectedComponents.hpp"
+#include "CCWatershed.hpp"
+#include "CCMoments.hpp"
+#include "CCFeatureClassifier.hpp"
+#include "CCCnnClassifier.hpp"
+#include "CCPipelineGraph.hpp"
 #include "CCThresholding.hpp"
+#include "CCHash.hpp"
+
+// parts of CCImageProcessor::Run, e.g. for stages on different threads
+enum CCProcessorStages {
+    CC_STAGES_FILTERS  = 1, // denoise up to the watershed split
+    CC_STAGES_FEATURES = 2, // moments, CNN and contours of the filtered image
+    CC_STAGES_ALL      = 3,
+};
 
 // Image processor
 class CCImageProcessor {
@@ -74,40 +97,371 @@ class CCImageProcessor {
         pCV_(pCV), pDV_(pDV), pSD_(pSD), pMF_(pMF), pThresh_(pThresh) {}
 
    CCImageProcessor(const CCImageProcessor &proc) :
-        pCV_(proc.pCV_), pDV_(proc.pDV_), pSD_(proc.pSD_), pMF_(proc.pMF_), pThresh_(proc.pThresh_) {}
+        pCV_(proc.pCV_), pDV_(proc.pDV_), pSD_(proc.pSD_), pMF_(proc.pMF_), pThresh_(proc.pThresh_),
+        roiX_(proc.roiX_), roiY_(proc.roiY_), roiWidth_(proc.roiWidth_), roiHeight_(proc.roiHeight_),
+        pyramidLevels_(proc.pyramidLevels_), pyramidPadding_(proc.pyramidPadding_),
+        pDenoise_(proc.pDenoise_), pSplit_(proc.pSplit_), pMoments_(proc.pMoments_),
+        pClassifier_(proc.pClassifier_), pCnn_(proc.pCnn_), diagnostics_(proc.diagnostics_),
+        numThreads_(proc.numThreads_), config_(proc.config_) {}
 
    virtual ~CCImageProcessor() {}
 
+   // restrict processing to a sub-rectangle, a zero sized region selects
+   // the whole image
+   void setRegionOfInterest(int x, int y, int width, int height) {
+       roiX_ = x;
+       roiY_ = y;
+       roiWidth_ = width;
+       roiHeight_ = height;
+   }
+
+   CCImageView getRegionOfInterest(CCImageReader &img) {
+       if ((roiWidth_ <= 0) || (roiHeight_ <= 0))
+           return img.getView();
+       return img.getView(roiX_, roiY_, roiWidth_, roiHeight_);
+   }
+
+   // runs ahead of every other stage, e.g. a median against impulse noise
+   void setDenoiseFilter(std::shared_ptr<CCImageConvolutionFilter> pDenoise) {
+       pDenoise_ = pDenoise;
+   }
+
+   // separates touching blobs of the binary image before contour tracing
+   void setSplitter(std::shared_ptr<CCWatershed> pSplit) {
+       pSplit_ = pSplit;
+   }
+
+   // per-component moment features of the binary image, taken before
+   // contour tracing; holds the rows of the last Run, of every candidate
+   // region with a pyramid
+   void setMoments(std::shared_ptr<CCMoments> pMoments) {
+       pMoments_ = pMoments;
+   }
+
+   std::shared_ptr<CCMoments> getMoments(void) {
+       return pMoments_;
+   }
+
+   // traced and approximated contours of every Run so far
+   std::shared_ptr<CCFeatureExtractor> getFeatureExtractor(void) {
+       return pSD_;
+   }
+
+   // labels the moment rows instead of counting polygon vertices, the
+   // expected values passed to Classify are then model labels
+   void setClassifier(std::shared_ptr<CCFeatureClassifier> pClassifier) {
+       pClassifier_ = pClassifier;
+   }
+
+   // labels component crops with a network, takes precedence over the
+   // feature classifier in Classify
+   void setCnnClassifier(std::shared_ptr<CCCnnClassifier> pCnn) {
+       pCnn_ = pCnn;
+   }
+
+   // independent stages of Run may use up to numThreads threads
+   void setNumThreads(int numThreads) {
+       numThreads_ = numThreads;
+   }
+
+   // search for candidates on a coarse pyramid level first, levels < 2
+   // process the full resolution image directly
+   void setPyramid(int numLevels, int padding) {
+       pyramidLevels_ = numLevels;
+       pyramidPadding_ = padding;
+   }
+
+   // settings that change the results, recorded by the builder
+   void setConfig(const std::string &config) {
+       config_ = config;
+   }
+
+   const std::string &getConfig(void) const {
+       return config_;
+   }
+
+   uint64_t getConfigHash(void) const {
+       return CCHash64(config_);
+   }
+
+   // full resolution regions refined by the last coarse-to-fine run
+   const std::vector<CCRect> &getCandidateRegions(void) {
+       return candidates_;
+   }
+
    virtual void Run(CCImageReader &img) {
-       if (pMF_)
-            pMF_->Run(img);
+       CCImageView view = getRegionOfInterest(img);
 
-       if (pCV_)
-            pCV_->Run(img);
+       if (pyramidLevels_ > 1)
+           RunCoarseToFine(img, view);
+       else
+           Run(img, view);
+   }
 
-       if (pDV_)
-            pDV_->Run(img);
+   // stages run in place on the view, pixels outside are left untouched
+   virtual void Run(CCImageReader &img, const CCImageView &view) {
+       Run(img, view, CC_STAGES_ALL);
+   }
 
-       if (pThresh_)
-           pThresh_->Run(img);
+   // a part of the stages, CCProcessorStages flags
+   virtual void Run(CCImageReader &img, const CCImageView &view, int stages) {
+       RunGraph(&img, view, stages);
+   }
 
-       // debugging
-       img.GetAllPixels(std::string("EDGE"));
+   // a frame of a CCFrameSource, processed in place in its slot
+   virtual void Run(CCDataFrame &frame, int stages = CC_STAGES_ALL) {
+       Run(frame.getView(), stages);
+   }
 
-       if (pSD_)
-            pSD_->Run(img);
+   // pixels without an image behind them, e.g. a scratch buffer
+   virtual void Run(const CCImageView &view, int stages) {
+       RunGraph(nullptr, view, stages);
    }
 
-   virtual bool Classify(CCImageReader &img, std::vector<int> exp) {
+   // the stages of Run: filters in place on the gray image, derivative,
+   // threshold and split each on their own buffer, then the consumers of
+   // the binary image side by side; the last image is copied back
+   virtual void BuildGraph(CCImageReader &img, CCPipelineGraph &graph, int stages = CC_STAGES_ALL) {
+       BuildGraph(&img, graph, stages);
+   }
+
+   // detect candidate components on the coarsest level and run the whole
+   // pipeline at full resolution only over their (padded) bounding boxes
+   virtual void RunCoarseToFine(CCImageReader &img, const CCImageView &view) {
+       CCImagePyramid pyramid;
+       CCConnectedComponents components;
+       std::vector<CCRect> regions;
+       int level, scale;
+
+       candidates_.clear();
+       if (view.empty() || (view.getNumChannels() != 1) ||
+           !pyramid.Build(view, pyramidLevels_) || (pyramid.getNumLevels() < 2)) {
+           Run(img, view);
+           return;
+       }
+
+       // coarse levels are owned by the pyramid, filter them in place
+       level = pyramid.getNumLevels() - 1;
+       scale = pyramid.getScale(level);
+       RunFilters(pyramid.getLevel(level));
+       components.Run(pyramid.getLevel(level));
+
+       for (auto &c : components.getComponents()) {
+           CCRect r{c.minX * scale - pyramidPadding_, c.minY * scale - pyramidPadding_,
+                    c.getWidth() * scale + 2 * pyramidPadding_,
+                    c.getHeight() * scale + 2 * pyramidPadding_};
+           // clip to the view
+           int x1 = std::min(r.x + r.width, view.getWidth());
+           int y1 = std::min(r.y + r.height, view.getHeight());
+           r.x = std::max(r.x, 0);
+           r.y = std::max(r.y, 0);
+           r.width = x1 - r.x;
+           r.height = y1 - r.y;
+           regions.push_back(r);
+       }
+
+       // overlapping boxes would be filtered twice, merge them
+       for (bool merged = true; merged; ) {
+           merged = false;
+           for (size_t i = 0; i < regions.size() && !merged; i++) {
+               for (size_t j = i + 1; j < regions.size(); j++) {
+                   if (regions[i].overlaps(regions[j])) {
+                       regions[i] = regions[i].merge(regions[j]);
+                       regions.erase(regions.begin() + j);
+                       merged = true;
+                       break;
+                   }
+               }
+           }
+       }
+
+       // each Run replaces the moment and network rows, collect them over
+       // the regions like the contours
+       CCMoments moments;
+       std::unique_ptr<CCCnnClassifier> pCnn(pCnn_ ? new CCCnnClassifier(*pCnn_) : nullptr);
+       if (pCnn)
+           pCnn->Clear();
+       for (auto &r : regions) {
+           candidates_.push_back(CCRect{view.getOriginX() + r.x, view.getOriginY() + r.y,
+                                        r.width, r.height});
+           Run(img, view.getRegion(r));
+           if (pMoments_)
+               moments.Append(*pMoments_);
+           if (pCnn)
+               pCnn->Append(*pCnn_);
+       }
+       if (pMoments_)
+           *pMoments_ = moments;
+       if (pCnn)
+           *pCnn_ = *pCnn;
+   }
+
+   // prints the traced contours when classifying by vertex count
+   void setDiagnostics(bool diagnostics) {
+       diagnostics_ = diagnostics;
+   }
+
+   // labels the components of the last Run with the network, the feature
+   // classifier or the vertex count of their contours, in that order
+   virtual void Classify(CCClassification &result) {
+       result.Clear();
+       if (pCnn_) {
+           for (size_t i = 0; i < pCnn_->getLabels().size(); i++)
+               result.Add(pCnn_->getLabels()[i], pCnn_->getConfidence()[i]);
+           return;
+       }
+
+       if (pClassifier_ && pMoments_ &&
+           (pClassifier_->getNumFeatures() == CC_NUM_HU_MOMENTS)) {
+           const int rows = pMoments_->getNumRows();
+           std::vector<float> features, confidence(rows);
+           std::vector<int> labels(rows);
+           pMoments_->getLogHu(features);
+           pClassifier_->Predict(features.data(), rows, CC_NUM_HU_MOMENTS, labels.data(), confidence.data());
+           for (int i = 0; i < rows; i++)
+               result.Add(labels[i], confidence[i]);
+           return;
+       }
+
        if (pSD_) {
+           std::vector<CCContourDescriptor> batch;
            auto features = pSD_->GetFeatures();
-           return CCImageClassifier::DetectShapes(features, exp);
+           if (diagnostics_)
+               CCImageClassifier::PrintContours(features);
+           CCImageClassifier::Describe(features, batch);
+           CCImageClassifier::ClassifyVertices(batch.data(), batch.size(), result);
        }
-       return false;
+   }
+
+   virtual bool Classify(CCImageReader &img, std::vector<int> exp) {
+       CCClassification result;
+       Classify(result);
+       return CCImageClassifier::Report(result.Matches(exp));
    }
 
    private:
 
+   void RunGraph(CCImageReader *pImg, const CCImageView &view, int stages) {
+       if (view.empty())
+           return;
+
+       if (!pGraph_)
+           pGraph_ = std::make_shared<CCPipelineGraph>();
+       BuildGraph(pImg, *pGraph_, stages);
+       pGraph_->setNumThreads(numThreads_);
+       pGraph_->Run(view);
+   }
+
+   // pImg only names the edge log, bare views have no image to log against
+   void BuildGraph(CCImageReader *pImg, CCPipelineGraph &graph, int stages) {
+       CCBufferKind cur = CCBufferKind::GRAY;
+
+       graph.Clear();
+       graph.setInput(cur);
+       if (stages & CC_STAGES_FILTERS)
+           cur = AddFilterStages(graph, cur);
+       if (stages & CC_STAGES_FEATURES)
+           cur = AddFeatureStages(graph, cur, pImg);
+       graph.setOutput(cur);
+   }
+
+   CCBufferKind AddFilterStages(CCPipelineGraph &graph, CCBufferKind cur) {
+       std::shared_ptr<CCImageConvolutionFilter> pDenoise(pDenoise_), pCV(pCV_);
+       std::shared_ptr<CCMorphologicalFilter> pMF(pMF_);
+       if (pDenoise)
+           graph.addStage("denoise", {cur}, cur, [pDenoise, cur](CCPipelineFrame &f) {
+               pDenoise->Run(f.getImage(cur));
+           });
+       if (pMF)
+           graph.addStage("morph", {cur}, cur, [pMF, cur](CCPipelineFrame &f) {
+               pMF->Run(f.getImage(cur));
+           });
+       if (pCV)
+           graph.addStage("blur", {cur}, cur, [pCV, cur](CCPipelineFrame &f) {
+               pCV->Run(f.getImage(cur));
+           });
+
+       std::shared_ptr<CCImageDerivativeFilter> pDV(pDV_);
+       if (pDV) {
+           graph.addStage("derivative", {cur}, CCBufferKind::GRADIENT, [pDV](CCPipelineFrame &f) {
+               pDV->Run(f.getImage(CCBufferKind::GRADIENT));
+           });
+           cur = CCBufferKind::GRADIENT;
+       }
+
+       std::shared_ptr<CCThresholding> pThresh(pThresh_);
+       if (pThresh) {
+           graph.addStage("threshold", {cur}, CCBufferKind::BINARY, [pThresh](CCPipelineFrame &f) {
+               pThresh->Run(f.getImage(CCBufferKind::BINARY));
+           });
+           cur = CCBufferKind::BINARY;
+       }
+
+       std::shared_ptr<CCWatershed> pSplit(pSplit_);
+       if (pSplit)
+           graph.addStage("split", {cur}, cur, [pSplit, cur](CCPipelineFrame &f) {
+               pSplit->Run(f.getImage(cur));
+           });
+
+       return cur;
+   }
+
+   CCBufferKind AddFeatureStages(CCPipelineGraph &graph, CCBufferKind cur, CCImageReader *pImg) {
+       // debugging
+       if (pImg)
+           graph.addStage("edge log", {cur}, CCBufferKind::NONE, [pImg, cur](CCPipelineFrame &f) {
+               pImg->GetAllPixels(f.getImage(cur), std::string("EDGE"));
+           });
+
+       // one labelling of the binary image for all stages reading components
+       std::shared_ptr<CCMoments> pMoments(pMoments_);
+       std::shared_ptr<CCCnnClassifier> pCnn(pCnn_);
+       if (pMoments || pCnn)
+           graph.addStage("labels", {cur}, CCBufferKind::LABELS, [cur](CCPipelineFrame &f) {
+               f.getComponents().Run(f.getImage(cur));
+           });
+
+       if (pMoments)
+           graph.addStage("moments", {CCBufferKind::LABELS}, CCBufferKind::NONE, [pMoments](CCPipelineFrame &f) {
+               pMoments->Run(f.getComponents());
+           });
+
+       if (pCnn)
+           graph.addStage("cnn", {CCBufferKind::LABELS}, CCBufferKind::NONE, [pCnn](CCPipelineFrame &f) {
+               pCnn->Run(f.getComponents());
+           });
+
+       // the tracer draws into its input, it gets a buffer of its own
+       std::shared_ptr<CCFeatureExtractor> pSD(pSD_);
+       if (pSD) {
+           graph.addStage("contours", {cur}, CCBufferKind::CONTOURS, [pSD](CCPipelineFrame &f) {
+               pSD->Run(f.getImage(CCBufferKind::CONTOURS));
+           });
+           cur = CCBufferKind::CONTOURS;
+       }
+       return cur;
+   }
+
+   void RunFilters(const CCImageView &view) {
+       if (pDenoise_)
+            pDenoise_->Run(view);
+
+       if (pMF_)
+            pMF_->Run(view);
+
+       if (pCV_)
+            pCV_->Run(view);
+
+       if (pDV_)
+            pDV_->Run(view);
+
+       if (pThresh_)
+           pThresh_->Run(view);
+
+       if (pSplit_)
+           pSplit_->Run(view);
+   }
+
    std::shared_ptr<CCImageConvolutionFilter> pCV_;
 
    std::shared_ptr<CCImageDerivativeFilter> pDV_;
@@ -117,6 +471,39 @@ class CCImageProcessor {
    std::shared_ptr<CCMorphologicalFilter> pMF_;
 
    std::shared_ptr<CCThresholding> pThresh_;
+
+   int roiX_ {0};
+
+   int roiY_ {0};
+
+   int roiWidth_ {0};
+
+   int roiHeight_ {0};
+
+   int pyramidLevels_ {0};
+
+   int pyramidPadding_ {0};
+
+   std::vector<CCRect> candidates_;
+
+   std::shared_ptr<CCImageConvolutionFilter> pDenoise_;
+
+   std::shared_ptr<CCWatershed> pSplit_;
+
+   std::shared_ptr<CCMoments> pMoments_;
+
+   std::shared_ptr<CCFeatureClassifier> pClassifier_;
+
+   std::shared_ptr<CCCnnClassifier> pCnn_;
+
+   bool diagnostics_ {false};
+
+   int numThreads_ {1};
+
+   std::string config_;
+
+   // created by the first Run, copy constructed processors get their own
+   std::shared_ptr<CCPipelineGraph> pGraph_;
 };
 
 //
@@ -135,41 +522,243 @@ class CCImageProcessorBuilder {
     virtual ~CCImageProcessorBuilder() {}
 
     virtual CCImageProcessor build() {
-        return CCImageProcessor(pCV_, pDV_, pSD_, pMF_, pThresh_);
+        CCImageProcessor proc(pCV_, pDV_, pSD_, pMF_, pThresh_);
+        proc.setRegionOfInterest(roiX_, roiY_, roiWidth_, roiHeight_);
+        proc.setPyramid(pyramidLevels_, pyramidPadding_);
+        proc.setDenoiseFilter(pDenoise_);
+        proc.setSplitter(pSplit_);
+        proc.setMoments(pMoments_);
+        proc.setClassifier(pClassifier_);
+        proc.setCnnClassifier(pCnn_);
+        proc.setDiagnostics(diagnostics_);
+        proc.setNumThreads(numThreads_);
+        proc.setConfig(getConfig());
+        return proc;
+    }
+
+    // one entry per stage in a fixed order, whatever order the stages
+    // were added in; concurrency and diagnostics do not change results.
+    // The network is described here since its weights may still change
+    // between addCnnClassifier and build
+    std::string getConfig(void) const {
+        std::map<std::string, std::string> settings(settings_);
+        std::string config;
+        if (pCnn_)
+            settings["cnn"] = DescribeNetwork(*pCnn_->getNetwork(), pCnn_->getClassLabels());
+        for (auto &s : settings)
+            config += s.first + "=" + s.second + ";";
+        return config;
+    }
+
+    // coarse-to-fine detection over a Gaussian pyramid
+    virtual CCImageProcessorBuilder&
+        addPyramid(int numLevels, int padding) {
+            pyramidLevels_ = numLevels;
+            pyramidPadding_ = padding;
+            settings_["pyramid"] = Describe(numLevels, padding);
+            return *this;
+    }
+
+    virtual CCImageProcessorBuilder&
+        addRegionOfInterest(int x, int y, int width, int height) {
+            roiX_ = x;
+            roiY_ = y;
+            roiWidth_ = width;
+            roiHeight_ = height;
+            settings_["roi"] = Describe(x, y, width, height);
+            return *this;
     }
 
     virtual CCImageProcessorBuilder&
         addGaussianFilter(int dimX, int dimY, float variance) {
-            pCV_.reset(new CCGaussianFilter(dimX, dimY, variance));
+            pCV_.reset(CreateGaussianFilter(dimX, dimY, variance, CCGaussianMode::KERNEL));
+            settings_["blur"] = "gaussian" + Describe(dimX, dimY, variance, int(CCGaussianMode::KERNEL));
+            return *this;
+    }
+
+    // FIXED_POINT is the faster integer path for 8-bit images, opt-in since
+    // its rounding changes some detections
+    virtual CCImageProcessorBuilder&
+        addGaussianFilter(int dimX, int dimY, float variance, CCGaussianMode mode) {
+            pCV_.reset(CreateGaussianFilter(dimX, dimY, variance, mode));
+            settings_["blur"] = "gaussian" + Describe(dimX, dimY, variance, int(mode));
+            return *this;
+    }
+
+    virtual CCImageProcessorBuilder&
+        addBoxFilter(int dimX, int dimY) {
+            pCV_.reset(new CCBoxFilter(dimX, dimY));
+            settings_["blur"] = "box" + Describe(dimX, dimY);
+            return *this;
+    }
+
+    // separate stage ahead of the others, can be combined with a blur
+    virtual CCImageProcessorBuilder&
+        addMedianFilter(int dimX, int dimY) {
+            pDenoise_.reset(new CCMedianFilter(dimX, dimY));
+            settings_["denoise"] = "median" + Describe(dimX, dimY);
             return *this;
     }
 
     virtual CCImageProcessorBuilder&
         addSoebelFilter(int dimX, int dimY, float variance) {
             pDV_.reset(new CCSoebelFilter(dimX, dimY, variance));
+            settings_["derivative"] = "soebel" + Describe(dimX, dimY, variance, int(CCSobelNorm::L2));
+            return *this;
+    }
+
+    virtual CCImageProcessorBuilder&
+        addSoebelFilter(int dimX, int dimY, float variance, CCSobelNorm norm) {
+            pDV_.reset(new CCSoebelFilter(dimX, dimY, variance, norm));
+            settings_["derivative"] = "soebel" + Describe(dimX, dimY, variance, int(norm));
+            return *this;
+    }
+
+    // replaces the Soebel stage, output is already binary
+    virtual CCImageProcessorBuilder&
+        addCannyFilter(int low, int high) {
+            pDV_.reset(new CCCannyFilter(low, high));
+            settings_["derivative"] = "canny" + Describe(low, high);
             return *this;
     }
 
     virtual CCImageProcessorBuilder&
         addMorphFilter(int dimX, int dimY, int thresh) {
-            pMF_.reset(new CCErosionFilter(dimX, dimY, thresh));
+            pMF_.reset(CreateErosionFilter(dimX, dimY, thresh));
+            settings_["morph"] = "erosion" + Describe(dimX, dimY, thresh);
             return *this;
     }
 
     virtual CCImageProcessorBuilder&
         addFeatureExtractor(int distance) {
             pSD_.reset(new CCFeatureExtractor(distance));
+            settings_["contours"] = Describe(distance);
             return *this;
     }
 
     virtual CCImageProcessorBuilder&
         addThresholding(int thresh) {
             pThresh_.reset(new CCThresholding(thresh));
+            settings_["threshold"] = Describe(thresh);
+            return *this;
+    }
+
+    // watershed split of touching blobs, runs after thresholding
+    virtual CCImageProcessorBuilder&
+        addWatershedSplit(float minPeak, int radius) {
+            pSplit_.reset(new CCWatershed(minPeak, radius));
+            settings_["split"] = "watershed" + Describe(minPeak, radius);
+            return *this;
+    }
+
+    // raw, central and Hu moments per connected component
+    virtual CCImageProcessorBuilder&
+        addMoments() {
+            pMoments_.reset(new CCMoments());
+            settings_["moments"] = "hu";
+            return *this;
+    }
+
+    // logistic regression over the log-scaled Hu moments, implies the
+    // moments stage; if the model fails to load vertex counting is kept
+    virtual CCImageProcessorBuilder&
+        addFeatureClassifier(const std::string &modelPath) {
+            uint64_t hash;
+
+            pClassifier_.reset(new CCFeatureClassifier());
+            if (!pClassifier_->Load(modelPath) || !CCHashFile(modelPath, hash)) {
+                pClassifier_.reset();
+                settings_.erase("classifier");
+                return *this;
+            }
+            if (!pMoments_)
+                pMoments_.reset(new CCMoments());
+            settings_["classifier"] = std::to_string(hash);
+            settings_["moments"] = "hu";
+            return *this;
+    }
+
+    // run independent stages concurrently
+    virtual CCImageProcessorBuilder&
+        addConcurrency(int numThreads) {
+            numThreads_ = numThreads;
+            return *this;
+    }
+
+    // print the traced contours while classifying
+    virtual CCImageProcessorBuilder&
+        addDiagnostics() {
+            diagnostics_ = true;
+            return *this;
+    }
+
+    // the network is built, loaded and compiled by the caller, its input
+    // must be 1 x size x size with one output per class label; networks
+    // that are not compiled are rejected
+    virtual CCImageProcessorBuilder&
+        addCnnClassifier(std::shared_ptr<CCNeuralNetwork> pNetwork, const std::vector<int> &classLabels) {
+            if (!pNetwork || !pNetwork->isCompiled()) {
+                CC_ERR("cnn classifier needs a compiled network");
+                pCnn_.reset();
+                return *this;
+            }
+            pCnn_.reset(new CCCnnClassifier(pNetwork, classLabels));
             return *this;
     }
 
     private:
 
+    template<class... Args>
+    static std::string Describe(Args... args) {
+        return "(" + DescribeArgs(args...) + ")";
+    }
+
+    template<class T, class... Args>
+    static std::string DescribeArgs(T arg, Args... args) {
+        return DescribeArg(arg) + (sizeof...(args) ? "," : "") + DescribeArgs(args...);
+    }
+
+    static std::string DescribeArgs(void) {
+        return std::string();
+    }
+
+    template<class T>
+    static std::string DescribeArg(T arg) {
+        return std::to_string(arg);
+    }
+
+    // hex floats are exact, nearby values get different descriptions
+    static std::string DescribeArg(double arg) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%a", arg);
+        return buf;
+    }
+
+    static std::string DescribeArg(float arg) {
+        return DescribeArg(double(arg));
+    }
+
+    // the network is identified by its input, the kind and geometry of
+    // every layer, its weights and the class labels
+    static std::string DescribeNetwork(const CCNeuralNetwork &network, const std::vector<int> &classLabels) {
+        std::string s = "uncompiled";
+        if (network.isCompiled()) {
+            const CCTensorShape &in = network.getInputShape();
+            s = "in" + Describe(in.channels, in.height, in.width);
+        }
+        for (int i = 0; i < network.getNumLayers(); i++) {
+            const CCLayer &layer = network.getLayer(i);
+            const std::vector<float> &p = layer.getParameters();
+            s += "," + layer.getDescription();
+            if (!p.empty())
+                s += "#" + std::to_string(CCHash64(p.data(), p.size() * sizeof(float)));
+        }
+        s += ",labels(";
+        for (size_t i = 0; i < classLabels.size(); i++)
+            s += (i ? "," : "") + std::to_string(classLabels[i]);
+        return s + ")";
+    }
+
     std::shared_ptr<CCImageConvolutionFilter> pCV_;
 
     std::shared_ptr<CCImageDerivativeFilter> pDV_;
@@ -179,6 +768,34 @@ class CCImageProcessorBuilder {
     std::shared_ptr<CCMorphologicalFilter> pMF_;
 
     std::shared_ptr<CCThresholding> pThresh_;
+
+    int roiX_ {0};
+
+    int roiY_ {0};
+
+    int roiWidth_ {0};
+
+    int roiHeight_ {0};
+
+    int pyramidLevels_ {0};
+
+    int pyramidPadding_ {0};
+
+    std::shared_ptr<CCImageConvolutionFilter> pDenoise_;
+
+    std::shared_ptr<CCWatershed> pSplit_;
+
+    std::shared_ptr<CCMoments> pMoments_;
+
+    std::shared_ptr<CCFeatureClassifier> pClassifier_;
+
+    std::shared_ptr<CCCnnClassifier> pCnn_;
+
+    bool diagnostics_ {false};
+
+    int numThreads_ {1};
+
+    std::map<std::string, std::string> settings_;
 };
 
 #endif
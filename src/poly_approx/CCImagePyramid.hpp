@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Image Pyramid : Gaussian pyramid of a gray-scale image. Every level is
+ *  the previous one blurred with the 5-tap binomial kernel [1 4 6 4 1]/16
+ *  and decimated by two in each direction (Burt-Adelson REDUCE).
+ *
+ */
+
+#ifndef _CCIMAGEPYRAMID_HPP_
+#define _CCIMAGEPYRAMID_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CCImageBuffer.hpp"
+#include "CCImageView.hpp"
+
+// vertical 1-4-6-4-1 pass over five source rows, 16-bit sums
+static void PyramidReduceColumns(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2,
+                                 const uint8_t *r3, const uint8_t *r4,
+                                 uint16_t *sum, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(r0 + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(r1 + x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(r2 + x));
+        __m128i d = _mm_loadu_si128((const __m128i *)(r3 + x));
+        __m128i e = _mm_loadu_si128((const __m128i *)(r4 + x));
+
+        // a + e + 4 * (b + d) + 6 * c, per 8 lane half
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(e, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(e, zero));
+        __m128i bdLo = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i bdHi = _mm_add_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(d, zero));
+        __m128i cLo = _mm_unpacklo_epi8(c, zero);
+        __m128i cHi = _mm_unpackhi_epi8(c, zero);
+
+        lo = _mm_add_epi16(lo, _mm_slli_epi16(bdLo, 2));
+        hi = _mm_add_epi16(hi, _mm_slli_epi16(bdHi, 2));
+        lo = _mm_add_epi16(lo, _mm_add_epi16(_mm_slli_epi16(cLo, 2), _mm_slli_epi16(cLo, 1)));
+        hi = _mm_add_epi16(hi, _mm_add_epi16(_mm_slli_epi16(cHi, 2), _mm_slli_epi16(cHi, 1)));
+
+        _mm_storeu_si128((__m128i *)(sum + x), lo);
+        _mm_storeu_si128((__m128i *)(sum + x + 8), hi);
+    }
+#endif
+    for (; x < width; x++)
+        sum[x] = r0[x] + r4[x] + 4 * (r1[x] + r3[x]) + 6 * r2[x];
+}
+
+// dst must be ((src.w + 1) / 2) x ((src.h + 1) / 2), borders are replicated
+static void PyramidReduce(const CCImageView &src, const CCImageView &dst) {
+    int width  = src.getWidth();
+    int height = src.getHeight();
+    // two replicated columns on each side of the column sums
+    std::vector<uint16_t> sum(width + 4);
+    uint16_t *s = &sum[2];
+
+    for (int y = 0; y < dst.getHeight(); y++) {
+        const uint8_t *rows[5];
+        for (int k = 0; k < 5; k++)
+            rows[k] = src.getRow(std::min(std::max(2 * y + k - 2, 0), height - 1));
+
+        PyramidReduceColumns(rows[0], rows[1], rows[2], rows[3], rows[4], s, width);
+        s[-2] = s[-1] = s[0];
+        s[width] = s[width + 1] = s[width - 1];
+
+        uint8_t *out = dst.getRow(y);
+        for (int x = 0; x < dst.getWidth(); x++) {
+            const uint16_t *c = s + 2 * x;
+            uint32_t v = c[-2] + c[2] + 4 * (c[-1] + c[1]) + 6 * c[0];
+            out[x] = static_cast<uint8_t>((v + 128) >> 8);
+        }
+    }
+}
+
+class CCImagePyramid {
+
+    public:
+
+    CCImagePyramid() {}
+
+    CCImagePyramid(const CCImagePyramid &) = delete;
+
+    CCImagePyramid& operator=(const CCImagePyramid &) = delete;
+
+    virtual ~CCImagePyramid() {}
+
+    // level 0 aliases the source view, coarser levels are owned
+    bool Build(const CCImageView &base, int numLevels) {
+        levels_.clear();
+        buffers_.clear();
+        if (base.empty() || (base.getNumChannels() != 1) || (numLevels < 1))
+            return false;
+
+        levels_.push_back(base);
+        for (int l = 1; l < numLevels; l++) {
+            const CCImageView &prev = levels_.back();
+            if ((prev.getWidth() < 2) || (prev.getHeight() < 2))
+                break;
+
+            int width  = (prev.getWidth() + 1) / 2;
+            int height = (prev.getHeight() + 1) / 2;
+            buffers_.push_back(CCImageBuffer(width * height));
+            if (!buffers_.back())
+                return false;
+
+            CCImageView level(buffers_.back().get(), width, height, width, 1);
+            PyramidReduce(prev, level);
+            levels_.push_back(level);
+        }
+        return true;
+    }
+
+    int getNumLevels(void) const noexcept {
+        return levels_.size();
+    }
+
+    // factor between level 0 and the given level
+    int getScale(int level) const noexcept {
+        return 1 << level;
+    }
+
+    const CCImageView &getLevel(int level) const {
+        return levels_.at(level);
+    }
+
+    private:
+
+    std::vector<CCImageView> levels_;
+
+    std::vector<CCImageBuffer> buffers_;
+};
+
+#endif
@@ -37,6 +37,10 @@
 
 #include "CCPixel.hpp"
 #include "CCLogger.hpp"
+#include "CCPixelKernels.hpp"
+#include "CCTaskScheduler.hpp"
+
+#include <vector>
 
 typedef unsigned char byte;
 
@@ -68,19 +72,47 @@ CCImageReader::CCImageReader(const char *filename, CCImageSourceType type, CCCol
     type_(type),
     desiredChannels_(channels) {}
 
-CCImageReader::CCImageReader(const CCImageReader &srcImg) {
-    width_  = srcImg.width_;
-    height_ = srcImg.height_;
-    type_ = srcImg.type_;
-    numChannels_ = srcImg.numChannels_;
-    desiredChannels_ = srcImg.desiredChannels_;
-    data_ = (unsigned char *) stbi__malloc(sizeof(unsigned char) * width_ * height_ * numChannels_);
-    memcpy(data_, srcImg.data_, sizeof(unsigned char) * width_ * height_ * numChannels_);
-    std::cout << "numChannels :" << numChannels_ << std::endl;
+CCImageReader::CCImageReader(CCImageReader &&srcImg) noexcept :
+    CCDataObject(srcImg),
+    filename_(std::move(srcImg.filename_)),
+    type_(srcImg.type_),
+    desiredChannels_(srcImg.desiredChannels_),
+    width_(srcImg.width_),
+    height_(srcImg.height_),
+    numChannels_(srcImg.numChannels_),
+    data_(std::move(srcImg.data_)) {
+    srcImg.width_ = srcImg.height_ = srcImg.numChannels_ = 0;
+}
+
+CCImageReader& CCImageReader::operator=(CCImageReader &&srcImg) noexcept {
+    if (this != &srcImg) {
+        CCDataObject::operator=(srcImg);
+        filename_ = std::move(srcImg.filename_);
+        type_ = srcImg.type_;
+        desiredChannels_ = srcImg.desiredChannels_;
+        width_ = srcImg.width_;
+        height_ = srcImg.height_;
+        numChannels_ = srcImg.numChannels_;
+        data_ = std::move(srcImg.data_);
+        srcImg.width_ = srcImg.height_ = srcImg.numChannels_ = 0;
+    }
+    return *this;
 }
 
 CCImageReader::~CCImageReader() {}
 
+CCImageReader CCImageReader::clone(void) const {
+    CCImageReader newImg;
+    newImg.filename_ = filename_;
+    newImg.type_ = type_;
+    newImg.desiredChannels_ = desiredChannels_;
+    newImg.width_ = width_;
+    newImg.height_ = height_;
+    newImg.numChannels_ = numChannels_;
+    newImg.data_ = data_.clone(sizeof(unsigned char) * width_ * height_ * numChannels_);
+    return newImg;
+}
+
 void CCImageReader::setFilename(const char *filename) {
     filename_ = std::string(filename);
 }
@@ -122,11 +154,20 @@ void CCImageReader::setColorChannels(CCColorChannels colorChannel) {
 }
 
 unsigned char* CCImageReader::getDataBlob() {
-    return data_;
+    return data_.get();
 }
 
+// takes ownership of a malloc'ed blob
 void CCImageReader::setDataBlob(unsigned char *data) {
-    data_ = data;
+    data_.reset(data);
+}
+
+CCImageView CCImageReader::getView(void) {
+    return CCImageView(data_.get(), width_, height_, width_ * numChannels_, numChannels_);
+}
+
+CCImageView CCImageReader::getView(int x, int y, int width, int height) {
+    return getView().getRegion(x, y, width, height);
 }
 
 int CCImageReader::getSize(void) {
@@ -145,56 +186,95 @@ bool CCImageReader::Load() {
     if (type_ >= CCImageSourceType::UNSUPPORTED)
         goto error;
 
-    if (data_ != nullptr)
+    if (data_)
         goto skip;
 
     switch (desiredChannels_) {
     case CCColorChannels::DEFAULT:
-        data_ = stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, 0);
+        data_.reset(stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, 0));
         break;
     case CCColorChannels::GRAY:
-        data_ = stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_grey);
+        data_.reset(stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_grey));
         break;
     case CCColorChannels::GRAY2:
-        data_ = stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_grey_alpha);
+        data_.reset(stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_grey_alpha));
         break;
     case CCColorChannels::RGB:
-        data_ = stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_rgb);
+        data_.reset(stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_rgb));
         break;
     case CCColorChannels::RGBA:
-        data_ = stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_rgb_alpha);
+        data_.reset(stbi_load(filename_.c_str(), &width_, &height_, &numChannels_, STBI_rgb_alpha));
         break;
     default:
         assert(0);
         break;
     }
 
+    // stb reports the channels present in the file, not in the blob
+    if (data_ && desiredChannels_ != CCColorChannels::DEFAULT)
+        numChannels_ = static_cast<int>(desiredChannels_);
+
 skip:
-    if (data_ != nullptr)
+    if (data_)
         return true;
 
 error:
     return false;
 }
 
+const char *CCImageReader::getFileExtension(void) {
+    if (type_ == CCImageSourceType::PNG)
+        return ".png";
+    else if (type_ == CCImageSourceType::BMP) 
+        return ".bmp";
+    else if (type_ == CCImageSourceType::JPG) 
+        return ".jpg";
+    else if (type_ == CCImageSourceType::PGM)
+        return (numChannels_ <= 2) ? ".pgm" : ".ppm";
+    return "";
+}
+
 std::string CCImageReader::generateUUIDName(void) {
     CCUUid ccuid = UUidInfo();
     std::string str = ccuid.getString();
 
-    if (type_ == CCImageSourceType::PNG)
-        str.append(".png");
-    else if (type_ == CCImageSourceType::BMP) 
-        str.append(".bmp");
-    else if (type_ == CCImageSourceType::JPG) 
-        str.append(".jpg");
+    str.append(getFileExtension());
     return str;
 }
 
+// raw P5 (gray) or P6 (rgb) dump, alpha is dropped
+static int WriteNetpbm(const char *name, int width, int height, int numChannels,
+        const unsigned char *data) {
+    int outChannels = (numChannels <= 2) ? 1 : 3;
+    FILE *fp = fopen(name, "wb");
+    if (fp == nullptr)
+        return 0;
+
+    fprintf(fp, "P%d\n%d %d\n255\n", (outChannels == 1) ? 5 : 6, width, height);
+    if (outChannels == numChannels) {
+        fwrite(data, 1, (size_t) width * height * numChannels, fp);
+    } else {
+        std::vector<unsigned char> row(width * outChannels);
+        for (int y = 0; y < height; y++) {
+            const unsigned char *src = data + (size_t) y * width * numChannels;
+            for (int x = 0; x < width; x++)
+                for (int c = 0; c < outChannels; c++)
+                    row[x * outChannels + c] = src[x * numChannels + c];
+            fwrite(row.data(), 1, row.size(), fp);
+        }
+    }
+
+    int ret = ferror(fp) ? 0 : 1;
+    if (fclose(fp) != 0)
+        ret = 0;
+    return ret;
+}
+
 bool CCImageReader::Save() {
     int ret;
     std::string name;
 
-    if ((data_ == nullptr) || (width_ == 0) || (height_ == 0))
+    if (!data_ || (width_ == 0) || (height_ == 0))
         goto error;
 
     if (filename_.empty()) {
@@ -204,13 +284,17 @@ bool CCImageReader::Save() {
 
     switch (type_) {
     case CCImageSourceType::PNG:
-        ret = stbi_write_png(name.c_str(), width_, height_, numChannels_, data_, width_ * numChannels_);
+        ret = stbi_write_png(name.c_str(), width_, height_, numChannels_, data_.get(), width_ * numChannels_);
         break;
     case CCImageSourceType::BMP:
-        ret = stbi_write_bmp(name.c_str(), width_, height_, numChannels_, data_);
+        ret = stbi_write_bmp(name.c_str(), width_, height_, numChannels_, data_.get());
         break;
     case CCImageSourceType::JPG:
-        ret = stbi_write_jpg(name.c_str(), width_, height_, numChannels_, data_, CCJPEG_LOSS);
+        ret = stbi_write_jpg(name.c_str(), width_, height_, numChannels_, data_.get(), CCJPEG_LOSS);
+        break;
+    case CCImageSourceType::PGM:
+        ret = WriteNetpbm(name.c_str(), width_, height_, numChannels_, data_.get());
+        break;
     default:
         ret = 0;
         break;
@@ -222,10 +306,7 @@ error:
 }
 
 bool CCImageReader::Destroy() {
-    if (data_) {
-        stbi_image_free(data_);
-        data_= nullptr;
-    }
+    data_.reset();
     return true;
 }
 
@@ -258,11 +339,20 @@ CCImageReader CCImageReader::ConvertRGB2GRAY(bool &ok) {
     newImg.setDataBlob(pData);
     pSrc = getDataBlob();
 
-    for (int count = 0; count < getSize(); pSrc += getNumChannels(),
-            pData += newImg.getNumChannels(), count++) {
-        *pData = (*pSrc + *(pSrc + 1) + *(pSrc + 2)) / 3.0;
-        if (cchannels == CCColorChannels::RGBA)
+    if (cchannels == CCColorChannels::RGB) {
+        const CCPixelKernels &kernels = GetPixelKernels();
+        const unsigned char *src = pSrc;
+        unsigned char *dst = pData;
+        CCTaskScheduler::getInstance().ParallelFor(0, getSize(), CC_TILE_PIXELS,
+            [&kernels, src, dst](int first, int last) {
+            kernels.rgbToGray(src + 3 * first, last - first, dst + first);
+        });
+    } else {
+        for (int count = 0; count < getSize(); pSrc += getNumChannels(),
+                pData += newImg.getNumChannels(), count++) {
+            *pData = (*pSrc + *(pSrc + 1) + *(pSrc + 2)) / 3.0;
             *(pData + 1) = *(pSrc + 3);
+        }
     }
 
     ok = true;
@@ -274,19 +364,23 @@ error:
 }
 
 void CCImageReader::GetAllPixels(std::string tag) {
+    GetAllPixels(getView(), tag);
+}
+
+void CCImageReader::GetAllPixels(const CCImageView &view, std::string tag) {
     byte *src;
     int height, width;
 
-    src    = getDataBlob();
-    height = getHeight();
-    width  = getWidth();
+    height = view.getHeight();
+    width  = view.getWidth();
 
     for (int y = 0; y < height; y++) {
+        src = view.getRow(y);
         for (int x = 0; x < width; x++) {
             Pixel<int> pixel(x, y);
-            int index = y * width + x;
-            if ((byte) src[index])
-                CC_INFO(tag, UUidInfo().getString(), x, y, (int) src[index]);
+            if ((byte) src[x])
+                CC_INFO(tag, UUidInfo().getString(), view.getOriginX() + x,
+                    view.getOriginY() + y, (int) src[x]);
         }
     }
 }
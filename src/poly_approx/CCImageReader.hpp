@@ -31,6 +31,8 @@
 #define _CCIMAGEREADER_HPP_
 
 #include "CCDataObject.hpp"
+#include "CCImageBuffer.hpp"
+#include "CCImageView.hpp"
 
 // Image Format
 enum class CCImageSourceType {
@@ -41,21 +43,24 @@ enum class CCImageSourceType {
 
     JPG, // jpeg
 
+    PGM, // uncompressed netpbm (pgm/ppm), cheapest to write
+
     UNSUPPORTED,
 };
 
 // selection for desired number of desiredChannels
+// (values match the channel count of the loaded blob)
 enum class CCColorChannels {
 
-    DEFAULT,
+    DEFAULT = 0,
 
-    GRAY,
+    GRAY = 1,
 
-    GRAY2,
+    GRAY2 = 2,
 
-    RGB,  // digital color-space
+    RGB = 3,  // digital color-space
 
-    RGBA, // with aplha channel
+    RGBA = 4, // with aplha channel
 
 };
 
@@ -73,10 +78,19 @@ class CCImageReader : public CCDataObject {
 
    CCImageReader(const char *filename, CCImageSourceType type, CCColorChannels color);
 
-   CCImageReader(const CCImageReader &srcImg);
+   // images own their blob, use clone() for a deep copy
+   CCImageReader(const CCImageReader &srcImg) = delete;
+
+   CCImageReader& operator=(const CCImageReader &srcImg) = delete;
+
+   CCImageReader(CCImageReader &&srcImg) noexcept;
+
+   CCImageReader& operator=(CCImageReader &&srcImg) noexcept;
 
    ~CCImageReader();
 
+   CCImageReader clone(void) const;
+
    int getWidth(void);
 
    int getHeight(void);
@@ -91,6 +105,12 @@ class CCImageReader : public CCDataObject {
 
    unsigned char *getDataBlob(void);
 
+   CCImageView getView(void);
+
+   CCImageView getView(int x, int y, int width, int height);
+
+   const char *getFileExtension(void);
+
    std::string generateUUIDName(void);
 
    void setFilename(const char *);
@@ -119,6 +139,8 @@ class CCImageReader : public CCDataObject {
 
    void GetAllPixels(std::string tag);
 
+   void GetAllPixels(const CCImageView &view, std::string tag);
+
    private:
 
    // file name
@@ -131,16 +153,16 @@ class CCImageReader : public CCDataObject {
    CCColorChannels desiredChannels_;
 
    // image width pixels
-   int width_;
+   int width_ {0};
 
    // image height pixels
-   int height_;
+   int height_ {0};
 
    // image channels
-   int numChannels_;
+   int numChannels_ {0};
 
    // image blob
-   unsigned char *data_ {nullptr};
+   CCImageBuffer data_;
 
 };
 
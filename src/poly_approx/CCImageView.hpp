@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  ImageView Class : Non-owning, strided window over an image blob. Views
+ *  are cheap to copy and let stages work on a sub-region in place.
+ *
+ */
+
+#ifndef _CCIMAGEVIEW_HPP_
+#define _CCIMAGEVIEW_HPP_
+
+#include <algorithm>
+
+// axis aligned rectangle in pixel units
+struct CCRect {
+
+    int x;
+
+    int y;
+
+    int width;
+
+    int height;
+
+    bool overlaps(const CCRect &r) const noexcept {
+        return (x < r.x + r.width) && (r.x < x + width) &&
+               (y < r.y + r.height) && (r.y < y + height);
+    }
+
+    CCRect merge(const CCRect &r) const noexcept {
+        int x0 = std::min(x, r.x), y0 = std::min(y, r.y);
+        int x1 = std::max(x + width, r.x + r.width);
+        int y1 = std::max(y + height, r.y + r.height);
+        return CCRect{x0, y0, x1 - x0, y1 - y0};
+    }
+};
+
+class CCImageView {
+
+    public:
+
+    CCImageView() {}
+
+    CCImageView(unsigned char *data, int width, int height, int stride, int numChannels) :
+        data_(data), width_(width), height_(height), stride_(stride),
+        numChannels_(numChannels) {}
+
+    int getWidth(void) const noexcept {
+        return width_;
+    }
+
+    int getHeight(void) const noexcept {
+        return height_;
+    }
+
+    // bytes between two consecutive rows
+    int getStride(void) const noexcept {
+        return stride_;
+    }
+
+    int getNumChannels(void) const noexcept {
+        return numChannels_;
+    }
+
+    int getSize(void) const noexcept {
+        return width_ * height_;
+    }
+
+    // views over copies of a region keep the position in the parent
+    void setOrigin(int x, int y) noexcept {
+        originX_ = x;
+        originY_ = y;
+    }
+
+    // offset of the view within the parent image
+    int getOriginX(void) const noexcept {
+        return originX_;
+    }
+
+    int getOriginY(void) const noexcept {
+        return originY_;
+    }
+
+    unsigned char *getDataBlob(void) const noexcept {
+        return data_;
+    }
+
+    unsigned char *getRow(int y) const noexcept {
+        return data_ + y * stride_;
+    }
+
+    bool empty(void) const noexcept {
+        return (data_ == nullptr) || (width_ <= 0) || (height_ <= 0);
+    }
+
+    // rows of the view are laid out back to back
+    bool isContiguous(void) const noexcept {
+        return stride_ == width_ * numChannels_;
+    }
+
+    // sub-rectangle, clipped against this view
+    CCImageView getRegion(int x, int y, int width, int height) const {
+        int x0 = std::max(0, x), y0 = std::max(0, y);
+        int x1 = std::min(width_, x + width), y1 = std::min(height_, y + height);
+
+        if ((x1 <= x0) || (y1 <= y0))
+            return CCImageView();
+
+        CCImageView view(data_ + y0 * stride_ + x0 * numChannels_,
+                         x1 - x0, y1 - y0, stride_, numChannels_);
+        view.originX_ = originX_ + x0;
+        view.originY_ = originY_ + y0;
+        return view;
+    }
+
+    CCImageView getRegion(const CCRect &rect) const {
+        return getRegion(rect.x, rect.y, rect.width, rect.height);
+    }
+
+    private:
+
+    unsigned char *data_ {nullptr};
+
+    int width_ {0};
+
+    int height_ {0};
+
+    int stride_ {0};
+
+    int numChannels_ {0};
+
+    int originX_ {0};
+
+    int originY_ {0};
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  ImageWriter Class : Saves images asynchronously off the processing path.
+ *
+ */
+
+#include <algorithm>
+
+#include "CCImageWriter.hpp"
+#include "CCLogger.hpp"
+
+CCImageWriter::CCImageWriter(int numWorkers, size_t queueDepth, CCImageSourceType format) :
+    maxActive_(std::max(numWorkers, 1)), queueDepth_(queueDepth ? queueDepth : 1), format_(format) {}
+
+CCImageWriter::~CCImageWriter() {
+    Shutdown();
+}
+
+bool CCImageWriter::Submit(CCImageReader &&img) {
+    std::unique_lock<std::mutex> lock(lock_);
+
+    // help with the queued work, the scheduler may have no spare thread;
+    // with nothing left to run the writers are busy elsewhere and notify
+    while (!stop_ && (queue_.size() >= queueDepth_)) {
+        lock.unlock();
+        bool ran = CCTaskScheduler::getInstance().RunOne();
+        lock.lock();
+        if (!ran)
+            notFull_.wait(lock, [this]() { return stop_ || (queue_.size() < queueDepth_); });
+    }
+    if (stop_)
+        return false;
+
+    if ((format_ != CCImageSourceType::UNSUPPORTED) && (format_ != img.getFormat())) {
+        std::string name(img.getFilename());
+        img.setFormat(format_);
+        if (!name.empty()) {
+            size_t dot = name.rfind('.');
+            if ((dot != std::string::npos) && (name.find('/', dot) == std::string::npos))
+                name.erase(dot);
+            name.append(img.getFileExtension());
+            img.setFilename(name.c_str());
+        }
+    }
+    queue_.push_back(std::move(img));
+    if (active_ < maxActive_) {
+        active_++;
+        tasks_.Run([this]() { Drain(); });
+    }
+    return true;
+}
+
+void CCImageWriter::Flush(void) {
+    tasks_.Wait();
+}
+
+void CCImageWriter::Shutdown(void) {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stop_ = true;
+    }
+    notFull_.notify_all();
+    // pending images are still written after stop
+    tasks_.Wait();
+}
+
+int CCImageWriter::getNumWritten(void) {
+    return numWritten_.load();
+}
+
+int CCImageWriter::getNumFailed(void) {
+    return numFailed_.load();
+}
+
+void CCImageWriter::Drain(void) {
+    for (;;) {
+        CCImageReader img;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            if (queue_.empty()) {
+                active_--;
+                return;
+            }
+            img = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        notFull_.notify_one();
+
+        if (img.Save()) {
+            numWritten_++;
+        } else {
+            numFailed_++;
+            CC_ERR("failed to save image", img.getFilename());
+        }
+        img.Destroy();
+    }
+}
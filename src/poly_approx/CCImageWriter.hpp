@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  ImageWriter Class : Saves images asynchronously. Submitted images are
+ *  moved into a bounded queue and encoded by tasks on the shared task
+ *  scheduler, a full queue blocks the producer (backpressure).
+ *
+ */
+
+#ifndef _CCIMAGEWRITER_HPP_
+#define _CCIMAGEWRITER_HPP_
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "CCImageReader.hpp"
+#include "CCTaskScheduler.hpp"
+
+class CCImageWriter {
+
+    public:
+
+    // at most numWorkers images are encoded at once, format UNSUPPORTED
+    // keeps the format of each submitted image
+    CCImageWriter(int numWorkers = 2, size_t queueDepth = 8,
+        CCImageSourceType format = CCImageSourceType::UNSUPPORTED);
+
+    CCImageWriter(const CCImageWriter &) = delete;
+
+    CCImageWriter& operator=(const CCImageWriter &) = delete;
+
+    ~CCImageWriter();
+
+    // takes ownership of the image, blocks while the queue is full
+    bool Submit(CCImageReader &&img);
+
+    // wait until every submitted image has been written
+    void Flush(void);
+
+    // drain the queue and stop the workers
+    void Shutdown(void);
+
+    int getNumWritten(void);
+
+    int getNumFailed(void);
+
+    private:
+
+    // encodes queued images until the queue is empty
+    void Drain(void);
+
+    int maxActive_;
+
+    size_t queueDepth_;
+
+    CCImageSourceType format_;
+
+    std::deque<CCImageReader> queue_;
+
+    std::mutex lock_;
+
+    std::condition_variable notFull_;
+
+    // drain tasks running
+    int active_ {0};
+
+    bool stop_ {false};
+
+    std::atomic<int> numWritten_ {0};
+
+    std::atomic<int> numFailed_ {0};
+
+    CCTaskGroup tasks_;
+};
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  IncrementalProcessor : Filters a stream of frames of a mostly static
+ *  scene (a conveyor) incrementally. Each frame is compared tile by tile
+ *  with the previous one (sum of absolute differences), only the changed
+ *  tiles go through the filters again and only the components around them
+ *  are labeled again. Components carry their identity from frame to frame
+ *  by matching centroids, so an object moving through the scene keeps it.
+ *
+ *  The filters of a changed area read halo extra pixels on every side and
+ *  their output is kept halo pixels beyond the changed tiles, so the halo
+ *  must cover the combined radius of the filters (2 + 1 for a 5x5 blur and
+ *  a 3x3 Soebel) for the result to match filtering the whole frame. Stages
+ *  without a bounded support (watershed split) do not qualify.
+ *
+ */
+
+#ifndef _CCINCREMENTALPROCESSOR_HPP_
+#define _CCINCREMENTALPROCESSOR_HPP_
+
+#include <cmath>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "CCLogger.hpp"
+#include "CCImageView.hpp"
+#include "CCPixelKernels.hpp"
+#include "CCImageProcessor.hpp"
+#include "CCConnectedComponents.hpp"
+
+// a component followed from frame to frame
+struct CCTrack {
+
+    int id;         // kept while the component can be matched
+
+    int age;        // frames the component has been seen in
+
+    int area;
+
+    CCRect box;     // bounding box in frame coordinates
+
+    float cx, cy;   // centroid
+};
+
+class CCIncrementalProcessor {
+
+    public:
+
+    CCIncrementalProcessor(const CCImageProcessor &processor, int tileSize = 32, int halo = 8) :
+        processor_(processor), tileSize_(tileSize), halo_(halo) {}
+
+    virtual ~CCIncrementalProcessor() {}
+
+    // tiles are tileSize x tileSize, the last row and column may be smaller
+    void setTileSize(int tileSize) {
+        tileSize_ = std::max(tileSize, 1);
+        Reset();
+    }
+
+    void setHalo(int halo) {
+        halo_ = std::max(halo, 0);
+        Reset();
+    }
+
+    // largest mean absolute difference of a tile still taken as unchanged
+    void setThreshold(int threshold) {
+        threshold_ = std::max(threshold, 0);
+    }
+
+    // farthest a centroid may move between two frames and keep its id
+    void setMaxDistance(float maxDistance) {
+        maxDistance_ = maxDistance;
+    }
+
+    // the next frame is processed from scratch
+    void Reset(void) {
+        width_ = height_ = 0;
+    }
+
+    // filters the gray view in place (CC_STAGES_FILTERS of the processor)
+    // and updates the components, returns the number of changed tiles or
+    // -1 if the view is not a gray image
+    int Run(const CCImageView &view) {
+        std::vector<CCRect> regions;
+
+        if (view.empty() || (view.getNumChannels() != 1)) {
+            CC_ERR("incremental processing needs a gray image");
+            return -1;
+        }
+
+        if ((view.getWidth() != width_) || (view.getHeight() != height_))
+            Resize(view);
+        DiffTiles(view);
+        GroupTiles(regions);
+
+        for (auto &r : regions)
+            Refilter(r);
+        for (int y = 0; y < height_; y++)
+            memcpy(view.getRow(y), &output_[y * width_], width_);
+
+        Retrace(regions);
+        regions_ = regions;
+        return numChangedTiles_;
+    }
+
+    int getNumTiles(void) const noexcept {
+        return tilesX_ * tilesY_;
+    }
+
+    int getNumChangedTiles(void) const noexcept {
+        return numChangedTiles_;
+    }
+
+    // areas of the output the last Run computed again
+    const std::vector<CCRect> &getChangedRegions(void) const noexcept {
+        return regions_;
+    }
+
+    // components of the last frame, ordered by id
+    const std::vector<CCTrack> &getTracks(void) const noexcept {
+        return tracks_;
+    }
+
+    private:
+
+    void Resize(const CCImageView &view) {
+        width_ = view.getWidth();
+        height_ = view.getHeight();
+        tilesX_ = (width_ + tileSize_ - 1) / tileSize_;
+        tilesY_ = (height_ + tileSize_ - 1) / tileSize_;
+        input_.assign(width_ * height_, 0);
+        output_.assign(width_ * height_, 0);
+        scratch_.assign(width_ * height_, 0);
+        tiles_.assign(tilesX_ * tilesY_, 0);
+        tracks_.clear();
+        reset_ = true;
+    }
+
+    // marks the changed tiles and keeps their pixels for the next frame
+    void DiffTiles(const CCImageView &view) {
+        const CCPixelKernels &kernels = GetPixelKernels();
+
+        numChangedTiles_ = 0;
+        for (int ty = 0; ty < tilesY_; ty++) {
+            for (int tx = 0; tx < tilesX_; tx++) {
+                int x0 = tx * tileSize_, y0 = ty * tileSize_;
+                int w = std::min(tileSize_, width_ - x0), h = std::min(tileSize_, height_ - y0);
+                uint64_t sad = 0;
+
+                if (!reset_) {
+                    for (int y = y0; y < y0 + h; y++)
+                        sad += kernels.sad(view.getRow(y) + x0, &input_[y * width_ + x0], w);
+                }
+                unsigned char &changed = tiles_[ty * tilesX_ + tx];
+                changed = (reset_ || (sad > static_cast<uint64_t>(threshold_) * w * h)) ? 255 : 0;
+                if (!changed)
+                    continue;
+                for (int y = y0; y < y0 + h; y++)
+                    memcpy(&input_[y * width_ + x0], view.getRow(y) + x0, w);
+                numChangedTiles_++;
+            }
+        }
+        reset_ = false;
+    }
+
+    // groups of touching changed tiles, grown by the halo their filtered
+    // output can spread to
+    void GroupTiles(std::vector<CCRect> &regions) {
+        CCConnectedComponents groups;
+
+        groups.Run(CCImageView(tiles_.data(), tilesX_, tilesY_, tilesX_, 1));
+        for (auto &g : groups.getComponents()) {
+            CCRect r{g.minX * tileSize_, g.minY * tileSize_,
+                     g.getWidth() * tileSize_, g.getHeight() * tileSize_};
+            regions.push_back(Grow(r, halo_));
+        }
+        MergeOverlapping(regions);
+    }
+
+    // filters out with halo pixels of context around it
+    void Refilter(const CCRect &out) {
+        CCRect in = Grow(out, halo_);
+
+        for (int y = 0; y < in.height; y++)
+            memcpy(&scratch_[y * in.width], &input_[(in.y + y) * width_ + in.x], in.width);
+        processor_.Run(CCImageView(scratch_.data(), in.width, in.height, in.width, 1),
+                       CC_STAGES_FILTERS);
+        for (int y = out.y; y < out.y + out.height; y++)
+            memcpy(&output_[y * width_ + out.x],
+                   &scratch_[(y - in.y) * in.width + (out.x - in.x)], out.width);
+    }
+
+    // labels the components in and around the changed regions again and
+    // matches them with the ones they replace
+    void Retrace(const std::vector<CCRect> &regions) {
+        CCImageView output(output_.data(), width_, height_, width_, 1);
+        std::vector<CCRect> areas;
+        std::vector<CCTrack> kept, removed, added;
+        std::vector<bool> hit(tracks_.size(), false);
+
+        // a component reaching into an area is labeled again as a whole
+        for (auto &r : regions)
+            areas.push_back(Grow(r, 1));
+        for (bool grown = true; grown; ) {
+            grown = false;
+            for (size_t t = 0; t < tracks_.size(); t++) {
+                for (size_t a = 0; !hit[t] && (a < areas.size()); a++) {
+                    if (tracks_[t].box.overlaps(areas[a])) {
+                        areas[a] = areas[a].merge(tracks_[t].box);
+                        hit[t] = grown = true;
+                    }
+                }
+            }
+            MergeOverlapping(areas);
+        }
+        for (size_t t = 0; t < tracks_.size(); t++)
+            (hit[t] ? removed : kept).push_back(tracks_[t]);
+
+        for (auto &a : areas) {
+            int n = components_.Run(output.getRegion(a));
+            const std::vector<int> &labels = components_.getLabels();
+            std::vector<double> sumX(n, 0.0), sumY(n, 0.0);
+
+            for (int y = 0; y < a.height; y++) {
+                for (int x = 0; x < a.width; x++) {
+                    int l = labels[y * a.width + x];
+                    if (l) {
+                        sumX[l - 1] += x;
+                        sumY[l - 1] += y;
+                    }
+                }
+            }
+            for (auto &c : components_.getComponents()) {
+                CCTrack t{0, 1, c.area, CCRect{a.x + c.minX, a.y + c.minY, c.getWidth(), c.getHeight()},
+                          static_cast<float>(a.x + sumX[c.label - 1] / c.area),
+                          static_cast<float>(a.y + sumY[c.label - 1] / c.area)};
+                added.push_back(t);
+            }
+        }
+
+        Match(removed, added);
+        for (auto &t : kept)
+            t.age++;
+        kept.insert(kept.end(), added.begin(), added.end());
+        std::sort(kept.begin(), kept.end(), [](const CCTrack &a, const CCTrack &b) {
+            return a.id < b.id;
+        });
+        tracks_.swap(kept);
+    }
+
+    // closest pairs first, a new component without a predecessor near
+    // enough gets a fresh id
+    void Match(const std::vector<CCTrack> &removed, std::vector<CCTrack> &added) {
+        struct Pair {
+            float distance;
+            int r, a;
+        };
+        std::vector<Pair> pairs;
+        std::vector<bool> usedR(removed.size(), false), usedA(added.size(), false);
+
+        for (size_t r = 0; r < removed.size(); r++) {
+            for (size_t a = 0; a < added.size(); a++) {
+                float d = std::hypot(removed[r].cx - added[a].cx, removed[r].cy - added[a].cy);
+                if (d <= maxDistance_)
+                    pairs.push_back(Pair{d, static_cast<int>(r), static_cast<int>(a)});
+            }
+        }
+        std::stable_sort(pairs.begin(), pairs.end(), [](const Pair &p, const Pair &q) {
+            return p.distance < q.distance;
+        });
+        for (auto &p : pairs) {
+            if (usedR[p.r] || usedA[p.a])
+                continue;
+            usedR[p.r] = usedA[p.a] = true;
+            added[p.a].id = removed[p.r].id;
+            added[p.a].age = removed[p.r].age + 1;
+        }
+        for (size_t a = 0; a < added.size(); a++) {
+            if (!usedA[a])
+                added[a].id = nextId_++;
+        }
+    }
+
+    // r grown by n pixels on every side, clipped to the frame
+    CCRect Grow(const CCRect &r, int n) const {
+        int x0 = std::max(r.x - n, 0), y0 = std::max(r.y - n, 0);
+        int x1 = std::min(r.x + r.width + n, width_), y1 = std::min(r.y + r.height + n, height_);
+        return CCRect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    static void MergeOverlapping(std::vector<CCRect> &rects) {
+        for (bool merged = true; merged; ) {
+            merged = false;
+            for (size_t i = 0; i < rects.size() && !merged; i++) {
+                for (size_t j = i + 1; j < rects.size(); j++) {
+                    if (rects[i].overlaps(rects[j])) {
+                        rects[i] = rects[i].merge(rects[j]);
+                        rects.erase(rects.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    CCImageProcessor processor_;
+
+    CCConnectedComponents components_;
+
+    int tileSize_;
+
+    int halo_;
+
+    int threshold_ {0};
+
+    float maxDistance_ {16.0f};
+
+    int width_ {0};
+
+    int height_ {0};
+
+    int tilesX_ {0};
+
+    int tilesY_ {0};
+
+    int numChangedTiles_ {0};
+
+    bool reset_ {true};
+
+    int nextId_ {1};
+
+    std::vector<unsigned char> input_;      // frame the output was computed from
+
+    std::vector<unsigned char> output_;
+
+    std::vector<unsigned char> scratch_;
+
+    std::vector<unsigned char> tiles_;      // 255 where the last frame changed
+
+    std::vector<CCRect> regions_;
+
+    std::vector<CCTrack> tracks_;
+};
+
+#endif
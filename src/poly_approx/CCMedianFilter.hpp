@@ -0,0 +1,231 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Median Filter : median over a dimX x dimY window. Not a convolution, but
+ *  borders and in place row streaming come from the convolution engine.
+ *
+ *  3x3 : Paeth's 19 compare-exchange sorting network, SSE2 min/max over
+ *        sixteen samples at a time
+ *  any : Perreault-Hebert constant time median. Every column keeps a 256
+ *        bin histogram of its dimY samples (one row in, one row out per
+ *        output row), the window histogram slides along the row by adding
+ *        one column and removing another. A 16 bin coarse level locates
+ *        the median before the fine bins are scanned.
+ *
+ */
+
+#ifndef _CCMEDIANFILTER_HPP_
+#define _CCMEDIANFILTER_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CCConvolutionFilter.hpp"
+#include "CCConvolutionEngine.hpp"
+
+#define CC_MEDIAN_SORT(a, b) { auto t = a; a = Min(t, b); b = Max(t, b); }
+
+// median of nine through a sorting network, T is a scalar or a SIMD lane type
+template <typename T, typename MinOp, typename MaxOp>
+static inline T Median9(T p0, T p1, T p2, T p3, T p4, T p5, T p6, T p7, T p8,
+                        MinOp Min, MaxOp Max) {
+    CC_MEDIAN_SORT(p1, p2); CC_MEDIAN_SORT(p4, p5); CC_MEDIAN_SORT(p7, p8);
+    CC_MEDIAN_SORT(p0, p1); CC_MEDIAN_SORT(p3, p4); CC_MEDIAN_SORT(p6, p7);
+    CC_MEDIAN_SORT(p1, p2); CC_MEDIAN_SORT(p4, p5); CC_MEDIAN_SORT(p7, p8);
+    CC_MEDIAN_SORT(p0, p3); CC_MEDIAN_SORT(p5, p8); CC_MEDIAN_SORT(p4, p7);
+    CC_MEDIAN_SORT(p3, p6); CC_MEDIAN_SORT(p1, p4); CC_MEDIAN_SORT(p2, p5);
+    CC_MEDIAN_SORT(p4, p7); CC_MEDIAN_SORT(p4, p2); CC_MEDIAN_SORT(p6, p4);
+    CC_MEDIAN_SORT(p4, p2);
+    return p4;
+}
+
+// out[i] = median of the 3x3 neighbourhood, r0..r2 are bordered rows
+static void MedianRow3x3(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2,
+                         int n, int step, uint8_t *out) {
+    auto smin = [](uint8_t a, uint8_t b) { return std::min(a, b); };
+    auto smax = [](uint8_t a, uint8_t b) { return std::max(a, b); };
+    int i = 0;
+#if defined(__SSE2__)
+    auto vmin = [](__m128i a, __m128i b) { return _mm_min_epu8(a, b); };
+    auto vmax = [](__m128i a, __m128i b) { return _mm_max_epu8(a, b); };
+    auto ld = [](const uint8_t *p) { return _mm_loadu_si128((const __m128i *)p); };
+    for (; i + 16 <= n; i += 16) {
+        __m128i m = Median9(ld(r0 + i), ld(r0 + i + step), ld(r0 + i + 2 * step),
+                            ld(r1 + i), ld(r1 + i + step), ld(r1 + i + 2 * step),
+                            ld(r2 + i), ld(r2 + i + step), ld(r2 + i + 2 * step),
+                            vmin, vmax);
+        _mm_storeu_si128((__m128i *)(out + i), m);
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = Median9(r0[i], r0[i + step], r0[i + 2 * step],
+                         r1[i], r1[i + step], r1[i + 2 * step],
+                         r2[i], r2[i + step], r2[i + 2 * step], smin, smax);
+}
+
+// dst[b] += sign * src[b] over the 256 fine bins
+static inline void HistogramAdd(uint16_t *dst, const uint16_t *src, bool add) {
+    int b = 0;
+#if defined(__SSE2__)
+    for (; b < 256; b += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + b));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + b));
+        d = add ? _mm_add_epi16(d, s) : _mm_sub_epi16(d, s);
+        _mm_storeu_si128((__m128i *)(dst + b), d);
+    }
+#endif
+    for (; b < 256; b++)
+        dst[b] = add ? dst[b] + src[b] : dst[b] - src[b];
+}
+
+class CCMedianFilter : public CCImageConvolutionFilter {
+
+    public:
+
+    CCMedianFilter() : CCImageConvolutionFilter(3, 3) {}
+
+    // windows are limited to 65535 samples (16-bit bin counts)
+    CCMedianFilter(int dX, int dY, CCBorderMode border = CCBorderMode::REPLICATE) :
+        CCImageConvolutionFilter(dX, dY), border_(border) {}
+
+    virtual ~CCMedianFilter() {}
+
+    virtual void Run(const CCImageView &img) {
+        if (img.empty() || (dimX <= 0) || (dimY <= 0) || !(dimX & 1) || !(dimY & 1) ||
+            (dimX * dimY > 65535))
+            return;
+
+        if ((dimX == 3) && (dimY == 3))
+            RunNetwork3x3(img);
+        else
+            RunHistogram(img);
+    }
+
+    void RunNetwork3x3(const CCImageView &img) {
+        int nc = img.getNumChannels();
+        int n  = img.getWidth() * nc;
+        std::vector<uint8_t> zero((img.getWidth() + 2) * nc, 0);
+
+        auto load = [&](int y, uint8_t *dst) {
+            LoadBorderedRow(img, y, 1, border_, dst);
+        };
+
+        auto emit = [&](int y, const uint8_t *const *rows) {
+            const uint8_t *r[3];
+            for (int j = 0; j < 3; j++)
+                r[j] = rows[j + 1] ? rows[j + 1] : zero.data();
+            MedianRow3x3(r[0], r[1], r[2], n, nc, img.getRow(y));
+        };
+
+        ProcessRowRing<uint8_t>(img, 3, zero.size(), border_, load, emit);
+    }
+
+    void RunHistogram(const CCImageView &img) {
+        int nc = img.getNumChannels();
+        int width = img.getWidth();
+        int halfX = dimX / 2;
+        int cols = (width + 2 * halfX) * nc;
+        int rank = (dimX * dimY) / 2;
+        // per bordered sample column, fine and coarse counts
+        std::vector<uint16_t> colFine(cols * 256, 0);
+        std::vector<uint16_t> colCoarse(cols * 16, 0);
+        std::vector<uint16_t> fine(256), coarse(16);
+
+        // a missing (ZERO border) row counts as samples of value 0
+        auto update = [&](const uint8_t *row, bool add) {
+            for (int i = 0; i < cols; i++) {
+                uint8_t v = row ? row[i] : 0;
+                colFine[i * 256 + v] += add ? 1 : -1;
+                colCoarse[i * 16 + (v >> 4)] += add ? 1 : -1;
+            }
+        };
+
+        auto load = [&](int y, uint8_t *dst) {
+            LoadBorderedRow(img, y, halfX, border_, dst);
+        };
+
+        auto emit = [&](int y, const uint8_t *const *rows) {
+            if (y == 0) {
+                for (int j = 1; j <= dimY; j++)
+                    update(rows[j], true);
+            } else {
+                update(rows[0], false);
+                update(rows[dimY], true);
+            }
+
+            uint8_t *out = img.getRow(y);
+            for (int c = 0; c < nc; c++) {
+                std::fill(fine.begin(), fine.end(), 0);
+                std::fill(coarse.begin(), coarse.end(), 0);
+                for (int i = 0; i < dimX; i++)
+                    Slide(i * nc + c, -1, fine.data(), coarse.data(), colFine, colCoarse);
+
+                for (int x = 0; x < width; x++) {
+                    if (x > 0)
+                        Slide((x + dimX - 1) * nc + c, (x - 1) * nc + c,
+                              fine.data(), coarse.data(), colFine, colCoarse);
+                    out[x * nc + c] = Select(fine.data(), coarse.data(), rank);
+                }
+            }
+        };
+
+        ProcessRowRing<uint8_t>(img, dimY, cols, border_, load, emit);
+    }
+
+    private:
+
+    // window histogram gains column in and loses column out (-1 for none)
+    static void Slide(int in, int out, uint16_t *fine, uint16_t *coarse,
+                      const std::vector<uint16_t> &colFine,
+                      const std::vector<uint16_t> &colCoarse) {
+        HistogramAdd(fine, &colFine[in * 256], true);
+        for (int b = 0; b < 16; b++)
+            coarse[b] += colCoarse[in * 16 + b];
+        if (out < 0)
+            return;
+        HistogramAdd(fine, &colFine[out * 256], false);
+        for (int b = 0; b < 16; b++)
+            coarse[b] -= colCoarse[out * 16 + b];
+    }
+
+    // value of the sample with the given rank (0 based)
+    static uint8_t Select(const uint16_t *fine, const uint16_t *coarse, int rank) {
+        int b = 0, seen = 0;
+        while (seen + coarse[b] <= rank)
+            seen += coarse[b++];
+        int v = b * 16;
+        while (seen + fine[v] <= rank)
+            seen += fine[v++];
+        return static_cast<uint8_t>(v);
+    }
+
+    CCBorderMode border_ {CCBorderMode::REPLICATE};
+};
+#endif
@@ -0,0 +1,217 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Moments : raw, central and Hu moments of every labeled component in
+ *  one pass over the label image. Rows are consumed as runs of equal
+ *  labels, the power sums of x over a run have closed forms, so the cost
+ *  is one visit per pixel plus a few multiplies per run.
+ *
+ *  The features of component l (label l, row l - 1) are stored at
+ *  getFeatures()[(l - 1) * CC_NUM_MOMENTS], columns as in CCMomentIndex.
+ *
+ */
+
+#ifndef _CCMOMENTS_HPP_
+#define _CCMOMENTS_HPP_
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "CCImageView.hpp"
+#include "CCConnectedComponents.hpp"
+
+// columns of the feature matrix
+enum CCMomentIndex {
+
+    // raw moments m_pq = sum x^p y^q
+    MOM_M00, MOM_M10, MOM_M01, MOM_M20, MOM_M11, MOM_M02,
+    MOM_M30, MOM_M21, MOM_M12, MOM_M03,
+
+    // central moments about the centroid
+    MOM_MU20, MOM_MU11, MOM_MU02, MOM_MU30, MOM_MU21, MOM_MU12, MOM_MU03,
+
+    // Hu invariants of the normalized central moments
+    MOM_HU1, MOM_HU2, MOM_HU3, MOM_HU4, MOM_HU5, MOM_HU6, MOM_HU7,
+
+    CC_NUM_MOMENTS,
+};
+
+#define CC_NUM_RAW_MOMENTS 10
+
+#define CC_NUM_HU_MOMENTS 7
+
+class CCMoments {
+
+    public:
+
+    CCMoments() {}
+
+    virtual ~CCMoments() {}
+
+    // labels the foreground (non-zero) pixels of a binary view first
+    int Run(const CCImageView &img) {
+        CCConnectedComponents components;
+        components.Run(img);
+        return Run(components);
+    }
+
+    // components labelled earlier, e.g. by the pipeline's labelling stage
+    int Run(const CCConnectedComponents &components) {
+        return Run(components.getLabels(), components.getWidth(), components.getHeight(),
+                   components.getComponents().size());
+    }
+
+    // labels are 1..numLabels, 0 is background; returns the number of rows
+    int Run(const std::vector<int> &labels, int width, int height, int numLabels) {
+        std::vector<double> raw(numLabels * CC_NUM_RAW_MOMENTS, 0.0);
+
+        numRows_ = numLabels;
+        features_.assign(numLabels * CC_NUM_MOMENTS, 0.0f);
+
+        for (int y = 0; y < height; y++) {
+            const int *row = &labels[y * width];
+            double y1 = y, y2 = y1 * y, y3 = y2 * y;
+            for (int x = 0; x < width; ) {
+                int l = row[x], a = x;
+                while ((x < width) && (row[x] == l))
+                    x++;
+                if ((l <= 0) || (l > numLabels))
+                    continue;
+
+                // sums of x^0..x^3 over [a, x - 1]
+                double s0, s1, s2, s3;
+                PowerSums(x - 1, s0, s1, s2, s3);
+                if (a > 0) {
+                    double t0, t1, t2, t3;
+                    PowerSums(a - 1, t0, t1, t2, t3);
+                    s0 -= t0; s1 -= t1; s2 -= t2; s3 -= t3;
+                }
+
+                double *m = &raw[(l - 1) * CC_NUM_RAW_MOMENTS];
+                m[MOM_M00] += s0;
+                m[MOM_M10] += s1;
+                m[MOM_M01] += s0 * y1;
+                m[MOM_M20] += s2;
+                m[MOM_M11] += s1 * y1;
+                m[MOM_M02] += s0 * y2;
+                m[MOM_M30] += s3;
+                m[MOM_M21] += s2 * y1;
+                m[MOM_M12] += s1 * y2;
+                m[MOM_M03] += s0 * y3;
+            }
+        }
+
+        for (int l = 0; l < numLabels; l++)
+            Derive(&raw[l * CC_NUM_RAW_MOMENTS], &features_[l * CC_NUM_MOMENTS]);
+        return numRows_;
+    }
+
+    // the rows of other after these, e.g. over several regions of an image
+    void Append(const CCMoments &other) {
+        features_.insert(features_.end(), other.features_.begin(), other.features_.end());
+        numRows_ += other.numRows_;
+    }
+
+    int getNumRows(void) const noexcept {
+        return numRows_;
+    }
+
+    // numRows x CC_NUM_MOMENTS, row major
+    const std::vector<float> &getFeatures(void) const noexcept {
+        return features_;
+    }
+
+    const float *getRow(int row) const {
+        return &features_[row * CC_NUM_MOMENTS];
+    }
+
+    // numRows x CC_NUM_HU_MOMENTS log-scaled Hu moments, the features of
+    // the Hu moment models in ml/classification
+    void getLogHu(std::vector<float> &out) const {
+        out.resize(numRows_ * CC_NUM_HU_MOMENTS);
+        for (int r = 0; r < numRows_; r++)
+            LogScaleHu(getRow(r) + MOM_HU1, &out[r * CC_NUM_HU_MOMENTS]);
+    }
+
+    // -sign(h) * log10(|h|), the scale the training scripts use
+    static void LogScaleHu(const float *hu, float *out) {
+        for (int i = 0; i < CC_NUM_HU_MOMENTS; i++) {
+            double h = hu[i];
+            out[i] = (h == 0) ? 0.0f : float(-std::copysign(1.0, h) * log10(std::fabs(h)));
+        }
+    }
+
+    private:
+
+    // sums of k^0..k^3 for k = 0..n
+    static void PowerSums(double n, double &s0, double &s1, double &s2, double &s3) {
+        s0 = n + 1;
+        s1 = n * (n + 1) / 2;
+        s2 = n * (n + 1) * (2 * n + 1) / 6;
+        s3 = s1 * s1;
+    }
+
+    static void Derive(const double *m, float *f) {
+        for (int i = 0; i < CC_NUM_RAW_MOMENTS; i++)
+            f[i] = m[i];
+        if (m[MOM_M00] <= 0)
+            return;
+
+        double xc = m[MOM_M10] / m[MOM_M00];
+        double yc = m[MOM_M01] / m[MOM_M00];
+        double mu20 = m[MOM_M20] - xc * m[MOM_M10];
+        double mu11 = m[MOM_M11] - xc * m[MOM_M01];
+        double mu02 = m[MOM_M02] - yc * m[MOM_M01];
+        double mu30 = m[MOM_M30] - 3 * xc * m[MOM_M20] + 2 * xc * xc * m[MOM_M10];
+        double mu21 = m[MOM_M21] - 2 * xc * m[MOM_M11] - yc * m[MOM_M20] + 2 * xc * xc * m[MOM_M01];
+        double mu12 = m[MOM_M12] - 2 * yc * m[MOM_M11] - xc * m[MOM_M02] + 2 * yc * yc * m[MOM_M10];
+        double mu03 = m[MOM_M03] - 3 * yc * m[MOM_M02] + 2 * yc * yc * m[MOM_M01];
+
+        f[MOM_MU20] = mu20; f[MOM_MU11] = mu11; f[MOM_MU02] = mu02;
+        f[MOM_MU30] = mu30; f[MOM_MU21] = mu21; f[MOM_MU12] = mu12; f[MOM_MU03] = mu03;
+
+        // eta_pq = mu_pq / m00^(1 + (p + q) / 2)
+        double s2 = m[MOM_M00] * m[MOM_M00];
+        double s3 = s2 * sqrt(m[MOM_M00]);
+        double n20 = mu20 / s2, n11 = mu11 / s2, n02 = mu02 / s2;
+        double n30 = mu30 / s3, n21 = mu21 / s3, n12 = mu12 / s3, n03 = mu03 / s3;
+
+        double a = n30 + n12, b = n21 + n03;
+        double c = n30 - 3 * n12, d = 3 * n21 - n03;
+        f[MOM_HU1] = n20 + n02;
+        f[MOM_HU2] = (n20 - n02) * (n20 - n02) + 4 * n11 * n11;
+        f[MOM_HU3] = c * c + d * d;
+        f[MOM_HU4] = a * a + b * b;
+        f[MOM_HU5] = c * a * (a * a - 3 * b * b) + d * b * (3 * a * a - b * b);
+        f[MOM_HU6] = (n20 - n02) * (a * a - b * b) + 4 * n11 * a * b;
+        f[MOM_HU7] = d * a * (a * a - 3 * b * b) - c * b * (3 * a * a - b * b);
+    }
+
+    int numRows_ {0};
+
+    std::vector<float> features_;
+};
+#endif
@@ -43,19 +43,21 @@ class CCMorphologicalFilter {
         m_(m), n_(n), thresh_(thresh) {
     }
 
-    CCMorphologicalFilter(const CCMorphologicalFilter &er) {
-        m_ = er.m_;
-        thresh_ = er.thresh_;
+    CCMorphologicalFilter(const CCMorphologicalFilter &er) :
+        m_(er.m_), n_(er.n_), thresh_(er.thresh_) {
     }
 
     CCMorphologicalFilter& operator=(const CCMorphologicalFilter &er) {
+        m_ = er.m_;
+        n_ = er.n_;
+        thresh_ = er.thresh_;
         return *this;
     }
 
     virtual ~CCMorphologicalFilter() {
     }
 
-    virtual void Run(CCImageReader &img) {
+    virtual void Run(const CCImageView &img) {
         assert(0);
     }
 
@@ -0,0 +1,573 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  NeuralNetwork : CPU inference for the small networks trained in
+ *  ml/classification, conv1d/conv2d, dense, ReLU, max pooling, sigmoid and
+ *  softmax. Tensors are channel major (C x H x W) and a conv1d is a conv2d
+ *  with kernel height 1 over a C x 1 x W input. Convolutions unroll their
+ *  input with im2col and accumulate whole output rows with SSE; all
+ *  activations live in an arena sized once by Compile().
+ *
+ *  Weight files are raw float32, for every layer with parameters in
+ *  order its weights then its biases: conv [filters][channels][kh][kw],
+ *  dense [outputs][inputs]. Keras stores conv kernels as kh, kw, c, f and
+ *  dense kernels as inputs x outputs, transpose them on export.
+ *
+ */
+
+#ifndef _CCNEURALNETWORK_HPP_
+#define _CCNEURALNETWORK_HPP_
+
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <typeinfo>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CCLogger.hpp"
+
+struct CCTensorShape {
+    int channels;
+    int height;
+    int width;
+
+    int size(void) const {
+        return channels * height * width;
+    }
+
+    bool operator==(const CCTensorShape &s) const {
+        return (channels == s.channels) && (height == s.height) && (width == s.width);
+    }
+};
+
+// bump allocator over one buffer, blocks are 64 byte aligned
+class CCArena {
+
+    public:
+
+    void Reserve(size_t numFloats) {
+        buffer_.assign(numFloats + 16, 0.0f);
+        base_ = reinterpret_cast<float *>((reinterpret_cast<uintptr_t>(buffer_.data()) + 63) & ~uintptr_t(63));
+        capacity_ = numFloats;
+        offset_ = 0;
+    }
+
+    float *Allocate(size_t numFloats) {
+        size_t n = (numFloats + 15) & ~size_t(15);
+        if (offset_ + n > capacity_)
+            return nullptr;
+        float *p = base_ + offset_;
+        offset_ += n;
+        return p;
+    }
+
+    void Reset(void) {
+        offset_ = 0;
+    }
+
+    // room for the given blocks including their padding
+    static size_t getRequiredSize(const std::vector<size_t> &blocks) {
+        size_t n = 0;
+        for (auto b : blocks)
+            n += (b + 15) & ~size_t(15);
+        return n;
+    }
+
+    private:
+
+    std::vector<float> buffer_;
+
+    float *base_ {nullptr};
+
+    size_t capacity_ {0};
+
+    size_t offset_ {0};
+};
+
+// y += a * x
+static inline void CCAxpy(float *y, const float *x, float a, int n) {
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 va = _mm_set1_ps(a);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+#endif
+    for (; i < n; i++)
+        y[i] += a * x[i];
+}
+
+static inline float CCDot(const float *a, const float *b, int n) {
+    float sum = 0.0f;
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+class CCLayer {
+
+    public:
+
+    virtual ~CCLayer() {}
+
+    // an invalid input gives a zero sized shape
+    virtual CCTensorShape getOutputShape(const CCTensorShape &in) const = 0;
+
+    // floats of scratch per sample
+    virtual int getScratchSize(const CCTensorShape &in) const {
+        return 0;
+    }
+
+    // kind and geometry, the parameters are not part of it
+    virtual std::string getDescription(void) const {
+        return typeid(*this).name();
+    }
+
+    // weights followed by biases, empty for layers without parameters
+    std::vector<float> &getParameters(void) {
+        return params_;
+    }
+
+    const std::vector<float> &getParameters(void) const {
+        return params_;
+    }
+
+    // one sample, out never aliases in
+    virtual void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const = 0;
+
+    protected:
+
+    std::vector<float> params_;
+};
+
+class CCConv2DLayer : public CCLayer {
+
+    public:
+
+    // same padding keeps the size for odd kernels, valid shrinks it
+    CCConv2DLayer(int channels, int filters, int kernelHeight, int kernelWidth, bool samePadding) :
+        channels_(channels), filters_(filters), kh_(kernelHeight), kw_(kernelWidth),
+        padY_(samePadding ? (kernelHeight - 1) / 2 : 0),
+        padX_(samePadding ? (kernelWidth - 1) / 2 : 0) {
+        params_.assign(filters * (channels * kh_ * kw_ + 1), 0.0f);
+    }
+
+    std::string getDescription(void) const override {
+        return "conv(" + std::to_string(channels_) + "," + std::to_string(filters_) + "," +
+               std::to_string(kh_) + "," + std::to_string(kw_) + "," +
+               std::to_string(padY_) + "," + std::to_string(padX_) + ")";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        int h = in.height + 2 * padY_ - kh_ + 1, w = in.width + 2 * padX_ - kw_ + 1;
+        if ((in.channels != channels_) || (h <= 0) || (w <= 0))
+            return CCTensorShape{0, 0, 0};
+        return CCTensorShape{filters_, h, w};
+    }
+
+    int getScratchSize(const CCTensorShape &in) const override {
+        CCTensorShape out = getOutputShape(in);
+        return channels_ * kh_ * kw_ * out.height * out.width;
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        CCTensorShape o = getOutputShape(shape);
+        const int numPixels = o.height * o.width, depth = channels_ * kh_ * kw_;
+        const float *weights = params_.data(), *biases = weights + filters_ * depth;
+
+        // im2col, row k of the scratch holds tap k for every output pixel
+        for (int c = 0; c < channels_; c++) {
+            for (int i = 0; i < kh_; i++) {
+                for (int j = 0; j < kw_; j++) {
+                    float *col = scratch + ((c * kh_ + i) * kw_ + j) * numPixels;
+                    for (int y = 0; y < o.height; y++) {
+                        int sy = y + i - padY_;
+                        for (int x = 0; x < o.width; x++) {
+                            int sx = x + j - padX_;
+                            bool inside = (sy >= 0) && (sy < shape.height) && (sx >= 0) && (sx < shape.width);
+                            col[y * o.width + x] = inside ? in[(c * shape.height + sy) * shape.width + sx] : 0.0f;
+                        }
+                    }
+                }
+            }
+        }
+
+        for (int f = 0; f < filters_; f++) {
+            float *row = out + f * numPixels;
+            std::fill(row, row + numPixels, biases[f]);
+            for (int k = 0; k < depth; k++)
+                CCAxpy(row, scratch + k * numPixels, weights[f * depth + k], numPixels);
+        }
+    }
+
+    private:
+
+    int channels_;
+
+    int filters_;
+
+    int kh_;
+
+    int kw_;
+
+    int padY_;
+
+    int padX_;
+};
+
+class CCDenseLayer : public CCLayer {
+
+    public:
+
+    CCDenseLayer(int inputs, int outputs) : inputs_(inputs), outputs_(outputs) {
+        params_.assign(outputs * (inputs + 1), 0.0f);
+    }
+
+    std::string getDescription(void) const override {
+        return "dense(" + std::to_string(inputs_) + "," + std::to_string(outputs_) + ")";
+    }
+
+    // flattens whatever comes in
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        if (in.size() != inputs_)
+            return CCTensorShape{0, 0, 0};
+        return CCTensorShape{outputs_, 1, 1};
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        const float *weights = params_.data(), *biases = weights + outputs_ * inputs_;
+        for (int o = 0; o < outputs_; o++)
+            out[o] = biases[o] + CCDot(weights + o * inputs_, in, inputs_);
+    }
+
+    private:
+
+    int inputs_;
+
+    int outputs_;
+};
+
+class CCReLULayer : public CCLayer {
+
+    public:
+
+    std::string getDescription(void) const override {
+        return "relu";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        return in;
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        const int n = shape.size();
+        int i = 0;
+#if defined(__SSE2__)
+        __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, _mm_max_ps(_mm_loadu_ps(in + i), zero));
+#endif
+        for (; i < n; i++)
+            out[i] = std::max(in[i], 0.0f);
+    }
+};
+
+// non-overlapping size x size windows, partial windows are dropped
+class CCMaxPoolLayer : public CCLayer {
+
+    public:
+
+    CCMaxPoolLayer(int sizeY, int sizeX) : sizeY_(sizeY), sizeX_(sizeX) {}
+
+    std::string getDescription(void) const override {
+        return "maxpool(" + std::to_string(sizeY_) + "," + std::to_string(sizeX_) + ")";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        if ((in.height < sizeY_) || (in.width < sizeX_))
+            return CCTensorShape{0, 0, 0};
+        return CCTensorShape{in.channels, in.height / sizeY_, in.width / sizeX_};
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        CCTensorShape o = getOutputShape(shape);
+        for (int c = 0; c < o.channels; c++) {
+            const float *plane = in + c * shape.height * shape.width;
+            for (int y = 0; y < o.height; y++) {
+                for (int x = 0; x < o.width; x++) {
+                    float m = -FLT_MAX;
+                    for (int i = 0; i < sizeY_; i++)
+                        for (int j = 0; j < sizeX_; j++)
+                            m = std::max(m, plane[(y * sizeY_ + i) * shape.width + x * sizeX_ + j]);
+                    *out++ = m;
+                }
+            }
+        }
+    }
+
+    private:
+
+    int sizeY_;
+
+    int sizeX_;
+};
+
+class CCGlobalMaxPoolLayer : public CCLayer {
+
+    public:
+
+    std::string getDescription(void) const override {
+        return "globalmaxpool";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        return CCTensorShape{in.channels, 1, 1};
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        const int n = shape.height * shape.width;
+        for (int c = 0; c < shape.channels; c++)
+            out[c] = *std::max_element(in + c * n, in + (c + 1) * n);
+    }
+};
+
+class CCSigmoidLayer : public CCLayer {
+
+    public:
+
+    std::string getDescription(void) const override {
+        return "sigmoid";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        return in;
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        for (int i = 0; i < shape.size(); i++)
+            out[i] = 1.0f / (1.0f + expf(-in[i]));
+    }
+};
+
+class CCSoftmaxLayer : public CCLayer {
+
+    public:
+
+    std::string getDescription(void) const override {
+        return "softmax";
+    }
+
+    CCTensorShape getOutputShape(const CCTensorShape &in) const override {
+        return in;
+    }
+
+    void Forward(const float *in, const CCTensorShape &shape, float *out, float *scratch) const override {
+        const int n = shape.size();
+        float m = *std::max_element(in, in + n), sum = 0.0f;
+        for (int i = 0; i < n; i++)
+            sum += (out[i] = expf(in[i] - m));
+        for (int i = 0; i < n; i++)
+            out[i] /= sum;
+    }
+};
+
+class CCNeuralNetwork {
+
+    public:
+
+    CCNeuralNetwork() {}
+
+    virtual ~CCNeuralNetwork() {}
+
+    CCNeuralNetwork &addLayer(CCLayer *layer) {
+        layers_.emplace_back(layer);
+        compiled_ = false;
+        return *this;
+    }
+
+    CCNeuralNetwork &addConv1D(int channels, int filters, int kernelSize, bool samePadding) {
+        return addLayer(new CCConv2DLayer(channels, filters, 1, kernelSize, samePadding));
+    }
+
+    CCNeuralNetwork &addConv2D(int channels, int filters, int kernelSize, bool samePadding) {
+        return addLayer(new CCConv2DLayer(channels, filters, kernelSize, kernelSize, samePadding));
+    }
+
+    CCNeuralNetwork &addDense(int inputs, int outputs) {
+        return addLayer(new CCDenseLayer(inputs, outputs));
+    }
+
+    CCNeuralNetwork &addReLU(void) {
+        return addLayer(new CCReLULayer());
+    }
+
+    CCNeuralNetwork &addMaxPool(int sizeY, int sizeX) {
+        return addLayer(new CCMaxPoolLayer(sizeY, sizeX));
+    }
+
+    CCNeuralNetwork &addGlobalMaxPool(void) {
+        return addLayer(new CCGlobalMaxPoolLayer());
+    }
+
+    CCNeuralNetwork &addSigmoid(void) {
+        return addLayer(new CCSigmoidLayer());
+    }
+
+    CCNeuralNetwork &addSoftmax(void) {
+        return addLayer(new CCSoftmaxLayer());
+    }
+
+    int getNumLayers(void) const noexcept {
+        return layers_.size();
+    }
+
+    CCLayer &getLayer(int i) {
+        return *layers_[i];
+    }
+
+    const CCLayer &getLayer(int i) const {
+        return *layers_[i];
+    }
+
+    bool LoadWeights(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            goto error;
+
+        for (auto &l : layers_) {
+            std::vector<float> &p = l->getParameters();
+            if (!p.empty() && !in.read(reinterpret_cast<char *>(p.data()), p.size() * sizeof(float)))
+                goto error;
+        }
+        // nothing may be left over
+        if (in.peek() != std::char_traits<char>::eof())
+            goto error;
+        return true;
+
+        error:
+        CC_ERR("failed to load weights", path);
+        return false;
+    }
+
+    // checks the layer shapes and sizes the arena for maxBatch samples
+    bool Compile(const CCTensorShape &input, int maxBatch) {
+        size_t maxActivation = input.size(), maxScratch = 0;
+
+        shapes_.assign(1, input);
+        for (auto &l : layers_) {
+            CCTensorShape out = l->getOutputShape(shapes_.back());
+            if (out.size() <= 0) {
+                CC_ERR("layer shapes do not match");
+                compiled_ = false;
+                return false;
+            }
+            maxScratch = std::max(maxScratch, size_t(l->getScratchSize(shapes_.back())));
+            maxActivation = std::max(maxActivation, size_t(out.size()));
+            shapes_.push_back(out);
+        }
+
+        // two ping-pong activation blocks plus the per-sample scratch
+        maxBatch_ = std::max(maxBatch, 1);
+        std::vector<size_t> blocks {maxBatch_ * maxActivation, maxBatch_ * maxActivation, maxScratch};
+        arena_.Reserve(CCArena::getRequiredSize(blocks));
+        buffers_[0] = arena_.Allocate(blocks[0]);
+        buffers_[1] = arena_.Allocate(blocks[1]);
+        scratch_ = arena_.Allocate(blocks[2]);
+        compiled_ = true;
+        return true;
+    }
+
+    bool isCompiled(void) const noexcept {
+        return compiled_;
+    }
+
+    // shapes of a compiled network
+    const CCTensorShape &getInputShape(void) const {
+        return shapes_.front();
+    }
+
+    const CCTensorShape &getOutputShape(void) const {
+        return shapes_.back();
+    }
+
+    // batch samples back to back in, getOutputShape().size() floats per
+    // sample out; larger batches run in chunks of the compiled size and
+    // every layer runs over a whole chunk before the next one
+    bool Run(const float *input, int batch, float *output) {
+        if (!compiled_)
+            return false;
+
+        const int inSize = shapes_.front().size(), outSize = shapes_.back().size();
+        for (int first = 0; first < batch; first += maxBatch_) {
+            int n = std::min(maxBatch_, batch - first);
+            const float *src = input + first * inSize;
+            int cur = 0;
+
+            for (size_t l = 0; l < layers_.size(); l++) {
+                const int a = shapes_[l].size(), b = shapes_[l + 1].size();
+                float *dst = buffers_[cur];
+                for (int s = 0; s < n; s++)
+                    layers_[l]->Forward(src + s * a, shapes_[l], dst + s * b, scratch_);
+                src = dst;
+                cur ^= 1;
+            }
+            std::copy(src, src + n * outSize, output + first * outSize);
+        }
+        return true;
+    }
+
+    private:
+
+    std::vector<std::unique_ptr<CCLayer>> layers_;
+
+    std::vector<CCTensorShape> shapes_;
+
+    CCArena arena_;
+
+    float *buffers_[2] {nullptr, nullptr};
+
+    float *scratch_ {nullptr};
+
+    int maxBatch_ {1};
+
+    bool compiled_ {false};
+};
+#endif
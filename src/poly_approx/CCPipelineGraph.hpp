@@ -0,0 +1,427 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  PipelineGraph : runs processing stages in the order their data allows.
+ *  Every stage declares the buffers it reads and the one it writes, a
+ *  stage waits for the last earlier writer of each buffer it touches and,
+ *  before writing, for the earlier readers of the buffer. Independent
+ *  branches, e.g. moments and contour tracing of the same binary image,
+ *  run concurrently as tasks of the shared CCTaskScheduler.
+ *
+ *  Image stages work in place: a stage writing an image it does not read
+ *  gets its first image input moved over when it is the last consumer,
+ *  otherwise a copy. Buffers go back to a pool after their last consumer
+ *  and the pool outlives Run.
+ *
+ */
+
+#ifndef _CCPIPELINEGRAPH_HPP_
+#define _CCPIPELINEGRAPH_HPP_
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "CCLogger.hpp"
+#include "CCImageView.hpp"
+#include "CCTaskScheduler.hpp"
+#include "CCConnectedComponents.hpp"
+
+enum class CCBufferKind {
+    NONE = -1,
+    GRAY,
+    GRADIENT,
+    BINARY,
+    CONTOURS,   // image the tracer draws the contours into
+    LABELS,     // one int per pixel
+    NUM_KINDS,
+};
+
+#define CC_NUM_IMAGE_BUFFERS 4
+
+class CCPipelineGraph;
+
+// buffers of one run, images have the size of the processed view
+class CCPipelineFrame {
+
+    public:
+
+    int getWidth(void) const noexcept {
+        return width_;
+    }
+
+    int getHeight(void) const noexcept {
+        return height_;
+    }
+
+    int getNumChannels(void) const noexcept {
+        return numChannels_;
+    }
+
+    // empty view if the buffer does not exist (yet)
+    CCImageView getImage(CCBufferKind kind) const {
+        int k = static_cast<int>(kind);
+        if ((k < 0) || (k >= CC_NUM_IMAGE_BUFFERS) || !images_[k])
+            return CCImageView();
+        CCImageView view(images_[k]->data(), width_, height_, width_ * numChannels_, numChannels_);
+        view.setOrigin(originX_, originY_);
+        return view;
+    }
+
+    // the LABELS buffer, written once by the labelling stage
+    CCConnectedComponents &getComponents(void) noexcept {
+        return components_;
+    }
+
+    private:
+
+    friend class CCPipelineGraph;
+
+    int width_ {0};
+
+    int height_ {0};
+
+    int numChannels_ {0};
+
+    int originX_ {0};
+
+    int originY_ {0};
+
+    std::shared_ptr<std::vector<unsigned char>> images_[CC_NUM_IMAGE_BUFFERS];
+
+    CCConnectedComponents components_;
+};
+
+struct CCPipelineStage {
+
+    std::string name;
+
+    std::vector<CCBufferKind> inputs;
+
+    CCBufferKind output;
+
+    std::function<void(CCPipelineFrame &)> run;
+};
+
+class CCPipelineGraph {
+
+    public:
+
+    CCPipelineGraph() : scheduler_(CCTaskScheduler::getInstance()) {}
+
+    explicit CCPipelineGraph(CCTaskScheduler &scheduler) : scheduler_(scheduler) {}
+
+    virtual ~CCPipelineGraph() {}
+
+    // drops the stages, the buffer pool is kept
+    void Clear(void) {
+        stages_.clear();
+        compiled_ = false;
+    }
+
+    // output may also be an input (in place) or NONE; returns the index
+    int addStage(const std::string &name, const std::vector<CCBufferKind> &inputs,
+                 CCBufferKind output, std::function<void(CCPipelineFrame &)> run) {
+        stages_.push_back(CCPipelineStage{name, inputs, output, run});
+        compiled_ = false;
+        return stages_.size() - 1;
+    }
+
+    // 1 runs the stages on the caller in order, more hands independent
+    // ones to the task scheduler
+    void setNumThreads(int numThreads) {
+        numThreads_ = std::max(numThreads, 1);
+    }
+
+    int getNumThreads(void) const noexcept {
+        return numThreads_;
+    }
+
+    // the view fills the input image, the output image is copied back
+    void setInput(CCBufferKind kind) {
+        input_ = kind;
+        compiled_ = false;
+    }
+
+    void setOutput(CCBufferKind kind) {
+        output_ = kind;
+    }
+
+    int getNumStages(void) const noexcept {
+        return stages_.size();
+    }
+
+    // stages a stage waits for, valid after Run
+    const std::vector<int> &getDependencies(int stage) const {
+        return deps_[stage];
+    }
+
+    // image buffers ever allocated by the pool
+    int getNumAllocations(void) const noexcept {
+        return numAllocations_;
+    }
+
+    CCPipelineFrame &getFrame(void) noexcept {
+        return frame_;
+    }
+
+    bool Run(const CCImageView &view) {
+        if (view.empty() || !IsImage(input_) || (!compiled_ && !Compile()))
+            return false;
+
+        // whatever the previous run kept goes back to the pool
+        for (auto &b : frame_.images_)
+            Release(b);
+        frame_.width_ = view.getWidth();
+        frame_.height_ = view.getHeight();
+        frame_.numChannels_ = view.getNumChannels();
+        frame_.originX_ = view.getOriginX();
+        frame_.originY_ = view.getOriginY();
+        frame_.components_.Clear();
+
+        frame_.images_[Index(input_)] = Acquire();
+        CopyImage(view, frame_.getImage(input_));
+
+        remaining_ = references_;
+        waiting_.clear();
+        ready_.clear();
+        for (size_t i = 0; i < stages_.size(); i++)
+            waiting_.push_back(deps_[i].size());
+        if (!remaining_[Index(input_)])
+            ReleaseUnused(input_);
+
+        if (numThreads_ <= 1) {
+            for (size_t i = 0; i < stages_.size(); i++)
+                if (deps_[i].empty())
+                    ready_.push_back(i);
+            while (!ready_.empty()) {
+                int i = ready_.front();
+                ready_.pop_front();
+                Execute(nullptr, i);
+            }
+        } else {
+            CCTaskGroup group(scheduler_);
+            for (size_t i = 0; i < stages_.size(); i++)
+                if (deps_[i].empty())
+                    Launch(&group, i);
+            group.Wait();
+        }
+
+        if (IsImage(output_) && frame_.images_[Index(output_)])
+            CopyImage(frame_.getImage(output_), view);
+        return true;
+    }
+
+    private:
+
+    static bool IsImage(CCBufferKind kind) {
+        return (kind >= CCBufferKind::GRAY) && (static_cast<int>(kind) < CC_NUM_IMAGE_BUFFERS);
+    }
+
+    static int Index(CCBufferKind kind) {
+        return static_cast<int>(kind);
+    }
+
+    static void CopyImage(const CCImageView &src, const CCImageView &dst) {
+        for (int y = 0; y < src.getHeight(); y++)
+            memcpy(dst.getRow(y), src.getRow(y), src.getWidth() * src.getNumChannels());
+    }
+
+    // read after write, write after write and write after read
+    bool Compile(void) {
+        const int numKinds = static_cast<int>(CCBufferKind::NUM_KINDS);
+        std::vector<int> lastWriter(numKinds, -1);
+        std::vector<std::vector<int>> readers(numKinds);
+        std::vector<bool> present(numKinds, false);
+
+        present[Index(input_)] = true;
+        references_.assign(numKinds, 0);
+        deps_.assign(stages_.size(), std::vector<int>());
+        dependents_.assign(stages_.size(), std::vector<int>());
+
+        for (size_t i = 0; i < stages_.size(); i++) {
+            std::vector<int> &d = deps_[i];
+            for (auto k : stages_[i].inputs) {
+                if (!present[Index(k)]) {
+                    CC_ERR("stage reads a buffer nobody writes", stages_[i].name);
+                    return false;
+                }
+                if (lastWriter[Index(k)] >= 0)
+                    d.push_back(lastWriter[Index(k)]);
+                readers[Index(k)].push_back(i);
+                references_[Index(k)]++;
+            }
+            CCBufferKind out = stages_[i].output;
+            if (out != CCBufferKind::NONE) {
+                if (lastWriter[Index(out)] >= 0)
+                    d.push_back(lastWriter[Index(out)]);
+                for (int r : readers[Index(out)])
+                    if (r != int(i))
+                        d.push_back(r);
+                lastWriter[Index(out)] = i;
+                readers[Index(out)].clear();
+                present[Index(out)] = true;
+                if (std::find(stages_[i].inputs.begin(), stages_[i].inputs.end(), out) == stages_[i].inputs.end())
+                    references_[Index(out)]++;
+            }
+
+            std::sort(d.begin(), d.end());
+            d.erase(std::unique(d.begin(), d.end()), d.end());
+            for (int j : d)
+                dependents_[j].push_back(i);
+        }
+        compiled_ = true;
+        return true;
+    }
+
+    std::shared_ptr<std::vector<unsigned char>> Acquire(void) {
+        size_t size = frame_.width_ * frame_.height_ * frame_.numChannels_;
+        std::shared_ptr<std::vector<unsigned char>> b;
+        if (pool_.empty()) {
+            b = std::make_shared<std::vector<unsigned char>>();
+            numAllocations_++;
+        } else {
+            b = pool_.back();
+            pool_.pop_back();
+        }
+        b->resize(size);
+        return b;
+    }
+
+    void Release(std::shared_ptr<std::vector<unsigned char>> &b) {
+        if (b)
+            pool_.push_back(b);
+        b.reset();
+    }
+
+    void ReleaseUnused(CCBufferKind kind) {
+        if (IsImage(kind) && (kind != output_))
+            Release(frame_.images_[Index(kind)]);
+    }
+
+    // called with the lock held, gives an image output its buffer
+    void Prepare(const CCPipelineStage &s) {
+        CCBufferKind out = s.output;
+        if (!IsImage(out) || (std::find(s.inputs.begin(), s.inputs.end(), out) != s.inputs.end()))
+            return;
+
+        auto src = std::find_if(s.inputs.begin(), s.inputs.end(), IsImage);
+        std::shared_ptr<std::vector<unsigned char>> &dst = frame_.images_[Index(out)];
+        if (src == s.inputs.end()) {
+            if (!dst)
+                dst = Acquire();
+            return;
+        }
+
+        // earlier readers of the old contents are done
+        Release(dst);
+        if ((remaining_[Index(*src)] == 1) && (*src != output_)) {
+            dst = frame_.images_[Index(*src)];
+            frame_.images_[Index(*src)].reset();
+        } else {
+            dst = Acquire();
+            CopyImage(frame_.getImage(*src), frame_.getImage(out));
+        }
+    }
+
+    void Finish(const CCPipelineStage &s) {
+        for (auto k : s.inputs)
+            if (!--remaining_[Index(k)])
+                ReleaseUnused(k);
+        CCBufferKind out = s.output;
+        if ((out != CCBufferKind::NONE) &&
+            (std::find(s.inputs.begin(), s.inputs.end(), out) == s.inputs.end()))
+            if (!--remaining_[Index(out)])
+                ReleaseUnused(out);
+    }
+
+    // stages on the task scheduler, or queued for the caller without a group
+    void Launch(CCTaskGroup *group, int i) {
+        if (group)
+            group->Run([this, group, i]() { Execute(group, i); });
+        else
+            ready_.push_back(i);
+    }
+
+    void Execute(CCTaskGroup *group, int i) {
+        std::vector<int> ready;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            Prepare(stages_[i]);
+        }
+
+        stages_[i].run(frame_);
+
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            Finish(stages_[i]);
+            for (int j : dependents_[i])
+                if (!--waiting_[j])
+                    ready.push_back(j);
+        }
+        for (int j : ready)
+            Launch(group, j);
+    }
+
+    std::vector<CCPipelineStage> stages_;
+
+    std::vector<std::vector<int>> deps_;
+
+    std::vector<std::vector<int>> dependents_;
+
+    // stages touching each buffer, counted down while running
+    std::vector<int> references_;
+
+    std::vector<int> remaining_;
+
+    std::vector<int> waiting_;
+
+    // stages the caller runs next when there is one thread
+    std::deque<int> ready_;
+
+    CCTaskScheduler &scheduler_;
+
+    std::mutex lock_;
+
+    std::vector<std::shared_ptr<std::vector<unsigned char>>> pool_;
+
+    int numAllocations_ {0};
+
+    CCPipelineFrame frame_;
+
+    CCBufferKind input_ {CCBufferKind::GRAY};
+
+    CCBufferKind output_ {CCBufferKind::NONE};
+
+    int numThreads_ {1};
+
+    bool compiled_ {false};
+};
+#endif
@@ -0,0 +1,697 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *
+ *  Pixel Kernels : baseline, SSE4.1, AVX2 and AVX-512 versions of the row
+ *  kernels and the table for each level. Wider versions process 16 or 32
+ *  pixels per step and finish the row with the scalar loop, results are
+ *  bit exact across levels.
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CC_X86_DISPATCH
+#include <immintrin.h>
+#define CC_TARGET_SSE41  __attribute__((target("sse4.1")))
+#define CC_TARGET_AVX2   __attribute__((target("avx2")))
+#define CC_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+
+#include "CCPixelKernels.hpp"
+#include "CCSoebelFilter.hpp"
+
+//
+// scalar loops, shared by every level for the end of a row
+//
+
+static inline void GaussianRowScalar(const uint8_t *in, int x, int width, const uint16_t *q8,
+                                     int n, uint16_t *out) {
+    for (; x < width; x++) {
+        uint32_t acc = 0;
+        for (int j = 0; j < n; j++)
+            acc += q8[j] * in[x + j];
+        out[x] = std::min<uint32_t>(acc, 65535);
+    }
+}
+
+static inline void GaussianColumnScalar(const uint16_t *const *rows, const uint16_t *q16,
+                                        int n, int x, int width, uint8_t *out) {
+    for (; x < width; x++) {
+        uint32_t acc = 0;
+        for (int j = 0; j < n; j++) {
+            if (rows[j] != nullptr)
+                acc += (uint32_t(rows[j][x]) * q16[j]) >> 16;
+        }
+        out[x] = std::min<uint32_t>((std::min<uint32_t>(acc, 65535) + 128) >> 8, 255);
+    }
+}
+
+static inline void SobelGradientScalar(const uint8_t *p, const uint8_t *c, const uint8_t *n,
+                                       int x, int width, int16_t *gx, int16_t *gy) {
+    for (; x < width - 1; x++) {
+        gx[x] = p[x + 1] - p[x - 1] + 2 * (c[x + 1] - c[x - 1]) + n[x + 1] - n[x - 1];
+        gy[x] = n[x - 1] - p[x - 1] + 2 * (n[x] - p[x]) + n[x + 1] - p[x + 1];
+    }
+}
+
+static inline void SobelMagnitudeScalar(const int16_t *gx, const int16_t *gy, int x, int width,
+                                        CCSobelNorm norm, uint16_t *mag) {
+    for (; x < width - 1; x++) {
+        int dx = gx[x], dy = gy[x];
+        if (norm == CCSobelNorm::L1)
+            mag[x] = std::abs(dx) + std::abs(dy);
+        else
+            mag[x] = sqrtf(dx * dx + dy * dy);
+    }
+}
+
+static inline void ThresholdScalar(const uint8_t *in, int i, int n, uint8_t thresh,
+                                   uint8_t *out) {
+    for (; i < n; i++)
+        out[i] = (in[i] >= thresh) ? 255 : 0;
+}
+
+// (r + g + b) / 3 == ((r + g + b) * 21846) >> 16 for sums up to 765
+static inline void RgbToGrayScalar(const uint8_t *rgb, int i, int n, uint8_t *gray) {
+    for (; i < n; i++)
+        gray[i] = ((rgb[3 * i] + rgb[3 * i + 1] + rgb[3 * i + 2]) * 21846) >> 16;
+}
+
+static inline void MinRowsScalar(const uint8_t *const *rows, int m, int i, int n,
+                                 uint8_t *out) {
+    for (; i < n; i++) {
+        uint8_t v = rows[0][i];
+        for (int j = 1; j < m; j++)
+            v = std::min(v, rows[j][i]);
+        out[i] = v;
+    }
+}
+
+static inline uint32_t SadScalar(const uint8_t *a, const uint8_t *b, int i, int n, uint32_t sum) {
+    for (; i < n; i++)
+        sum += std::abs(a[i] - b[i]);
+    return sum;
+}
+
+//
+// baseline, the template argument is the tap count (0 for runtime)
+//
+
+template <int N>
+static void GaussianRowFixed(const uint8_t *in, int width, const uint16_t *q8, int taps,
+                             uint16_t *out) {
+    const int n = N ? N : taps;
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 <= width; x += 8) {
+        __m128i acc = zero;
+        for (int j = 0; j < n; j++) {
+            __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(in + x + j)), zero);
+            // 255 * 256 still fits the low 16 bits of the product
+            acc = _mm_adds_epu16(acc, _mm_mullo_epi16(p, _mm_set1_epi16(q8[j])));
+        }
+        _mm_storeu_si128((__m128i *)(out + x), acc);
+    }
+#endif
+    GaussianRowScalar(in, x, width, q8, n, out);
+}
+
+// Q8 in, rounded and saturated 8-bit out
+template <int N>
+static void GaussianColumnFixed(const uint16_t *const *rows, const uint16_t *q16, int taps,
+                                int width, uint8_t *out) {
+    const int n = N ? N : taps;
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i round = _mm_set1_epi16(128);
+    for (; x + 8 <= width; x += 8) {
+        __m128i acc = _mm_setzero_si128();
+        for (int j = 0; j < n; j++) {
+            if (rows[j] == nullptr)
+                continue;
+            __m128i h = _mm_loadu_si128((const __m128i *)(rows[j] + x));
+            acc = _mm_adds_epu16(acc, _mm_mulhi_epu16(h, _mm_set1_epi16(q16[j])));
+        }
+        acc = _mm_srli_epi16(_mm_adds_epu16(acc, round), 8);
+        _mm_storel_epi64((__m128i *)(out + x), _mm_packus_epi16(acc, acc));
+    }
+#endif
+    GaussianColumnScalar(rows, q16, n, x, width, out);
+}
+
+static void SobelRowGradient(const uint8_t *p, const uint8_t *c, const uint8_t *n,
+                             int width, int16_t *gx, int16_t *gy) {
+    int x = 1;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 < width; x += 8) {
+        __m128i pl = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p + x - 1)), zero);
+        __m128i pm = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p + x)), zero);
+        __m128i pr = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p + x + 1)), zero);
+        __m128i cl = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(c + x - 1)), zero);
+        __m128i cr = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(c + x + 1)), zero);
+        __m128i nl = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(n + x - 1)), zero);
+        __m128i nm = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(n + x)), zero);
+        __m128i nr = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(n + x + 1)), zero);
+
+        __m128i dx = _mm_add_epi16(_mm_sub_epi16(pr, pl), _mm_sub_epi16(nr, nl));
+        dx = _mm_add_epi16(dx, _mm_slli_epi16(_mm_sub_epi16(cr, cl), 1));
+        __m128i dy = _mm_add_epi16(_mm_sub_epi16(nl, pl), _mm_sub_epi16(nr, pr));
+        dy = _mm_add_epi16(dy, _mm_slli_epi16(_mm_sub_epi16(nm, pm), 1));
+
+        _mm_storeu_si128((__m128i *)(gx + x), dx);
+        _mm_storeu_si128((__m128i *)(gy + x), dy);
+    }
+#endif
+    SobelGradientScalar(p, c, n, x, width, gx, gy);
+}
+
+// saturated to 16 bits
+static void SobelRowMagnitude(const int16_t *gx, const int16_t *gy, int width,
+                              CCSobelNorm norm, uint16_t *mag) {
+    int x = 1;
+#if defined(__SSE2__)
+    if (norm == CCSobelNorm::L1) {
+        for (; x + 8 < width; x += 8) {
+            __m128i dx = _mm_loadu_si128((const __m128i *)(gx + x));
+            __m128i dy = _mm_loadu_si128((const __m128i *)(gy + x));
+            dx = _mm_max_epi16(dx, _mm_sub_epi16(_mm_setzero_si128(), dx));
+            dy = _mm_max_epi16(dy, _mm_sub_epi16(_mm_setzero_si128(), dy));
+            _mm_storeu_si128((__m128i *)(mag + x), _mm_add_epi16(dx, dy));
+        }
+    } else {
+        for (; x + 8 < width; x += 8) {
+            __m128i dx = _mm_loadu_si128((const __m128i *)(gx + x));
+            __m128i dy = _mm_loadu_si128((const __m128i *)(gy + x));
+            // gx^2 + gy^2 as 32-bit lanes via madd of interleaved pairs
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(dx, dy), _mm_unpacklo_epi16(dx, dy));
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(dx, dy), _mm_unpackhi_epi16(dx, dy));
+            lo = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(lo)));
+            hi = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(hi)));
+            // results are below 1448, signed pack does not saturate
+            _mm_storeu_si128((__m128i *)(mag + x), _mm_packs_epi32(lo, hi));
+        }
+    }
+#endif
+    SobelMagnitudeScalar(gx, gy, x, width, norm, mag);
+}
+
+static void ThresholdRow(const uint8_t *in, int n, uint8_t thresh, uint8_t *out) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i t = _mm_set1_epi8(static_cast<char>(thresh));
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        // v >= t exactly when max(v, t) == v
+        _mm_storeu_si128((__m128i *)(out + i), _mm_cmpeq_epi8(_mm_max_epu8(v, t), v));
+    }
+#endif
+    ThresholdScalar(in, i, n, thresh, out);
+}
+
+// SSE2 has no byte shuffle to split the channels
+static void RgbToGrayRow(const uint8_t *rgb, int n, uint8_t *gray) {
+    RgbToGrayScalar(rgb, 0, n, gray);
+}
+
+template <int N>
+static void MinRows(const uint8_t *const *rows, int taps, int n, uint8_t *out) {
+    const int m = N ? N : taps;
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)(rows[0] + i));
+        for (int j = 1; j < m; j++)
+            acc = _mm_min_epu8(acc, _mm_loadu_si128((const __m128i *)(rows[j] + i)));
+        _mm_storeu_si128((__m128i *)(out + i), acc);
+    }
+#endif
+    MinRowsScalar(rows, m, i, n, out);
+}
+
+static uint32_t SadRow(const uint8_t *a, const uint8_t *b, int n) {
+    uint32_t sum = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    return SadScalar(a, b, i, n, sum);
+}
+
+#if defined(CC_X86_DISPATCH)
+
+//
+// SSE4.1 (with SSSE3 byte shuffles)
+//
+
+// 16 RGB pixels in a, b, c split into one register per channel
+CC_TARGET_SSE41
+static inline void SplitRgb16(const uint8_t *rgb, __m128i &r, __m128i &g, __m128i &b) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(rgb));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(rgb + 16));
+    __m128i a2 = _mm_loadu_si128((const __m128i *)(rgb + 32));
+
+    r = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(a0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+    g = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(a0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+    b = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(a0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+CC_TARGET_SSE41
+static void RgbToGrayRowSSE41(const uint8_t *rgb, int n, uint8_t *gray) {
+    const __m128i third = _mm_set1_epi16(21846);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i r, g, b;
+        SplitRgb16(rgb + 3 * i, r, g, b);
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_cvtepu8_epi16(r), _mm_cvtepu8_epi16(g)),
+                                   _mm_cvtepu8_epi16(b));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(r, zero),
+                                                 _mm_unpackhi_epi8(g, zero)),
+                                   _mm_unpackhi_epi8(b, zero));
+        lo = _mm_mulhi_epu16(lo, third);
+        hi = _mm_mulhi_epu16(hi, third);
+        _mm_storeu_si128((__m128i *)(gray + i), _mm_packus_epi16(lo, hi));
+    }
+    RgbToGrayScalar(rgb, i, n, gray);
+}
+
+//
+// AVX2, 16 pixels per step for 16-bit intermediates, 32 for bytes
+//
+
+// 16 x 16-bit lanes to 16 bytes, lanes are already in [0, 255]
+CC_TARGET_AVX2
+static inline __m128i PackBytesAVX2(__m256i v) {
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08));
+}
+
+template <int N>
+CC_TARGET_AVX2
+static void GaussianRowFixedAVX2(const uint8_t *in, int width, const uint16_t *q8, int taps,
+                                 uint16_t *out) {
+    const int n = N ? N : taps;
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int j = 0; j < n; j++) {
+            __m256i p = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + x + j)));
+            acc = _mm256_adds_epu16(acc, _mm256_mullo_epi16(p, _mm256_set1_epi16(q8[j])));
+        }
+        _mm256_storeu_si256((__m256i *)(out + x), acc);
+    }
+    GaussianRowScalar(in, x, width, q8, n, out);
+}
+
+template <int N>
+CC_TARGET_AVX2
+static void GaussianColumnFixedAVX2(const uint16_t *const *rows, const uint16_t *q16, int taps,
+                                    int width, uint8_t *out) {
+    const int n = N ? N : taps;
+    const __m256i round = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int j = 0; j < n; j++) {
+            if (rows[j] == nullptr)
+                continue;
+            __m256i h = _mm256_loadu_si256((const __m256i *)(rows[j] + x));
+            acc = _mm256_adds_epu16(acc, _mm256_mulhi_epu16(h, _mm256_set1_epi16(q16[j])));
+        }
+        acc = _mm256_srli_epi16(_mm256_adds_epu16(acc, round), 8);
+        _mm_storeu_si128((__m128i *)(out + x), PackBytesAVX2(acc));
+    }
+    GaussianColumnScalar(rows, q16, n, x, width, out);
+}
+
+CC_TARGET_AVX2
+static void SobelRowGradientAVX2(const uint8_t *p, const uint8_t *c, const uint8_t *n,
+                                 int width, int16_t *gx, int16_t *gy) {
+    int x = 1;
+    for (; x + 16 < width; x += 16) {
+        __m256i pl = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + x - 1)));
+        __m256i pm = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + x)));
+        __m256i pr = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + x + 1)));
+        __m256i cl = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(c + x - 1)));
+        __m256i cr = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(c + x + 1)));
+        __m256i nl = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(n + x - 1)));
+        __m256i nm = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(n + x)));
+        __m256i nr = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(n + x + 1)));
+
+        __m256i dx = _mm256_add_epi16(_mm256_sub_epi16(pr, pl), _mm256_sub_epi16(nr, nl));
+        dx = _mm256_add_epi16(dx, _mm256_slli_epi16(_mm256_sub_epi16(cr, cl), 1));
+        __m256i dy = _mm256_add_epi16(_mm256_sub_epi16(nl, pl), _mm256_sub_epi16(nr, pr));
+        dy = _mm256_add_epi16(dy, _mm256_slli_epi16(_mm256_sub_epi16(nm, pm), 1));
+
+        _mm256_storeu_si256((__m256i *)(gx + x), dx);
+        _mm256_storeu_si256((__m256i *)(gy + x), dy);
+    }
+    SobelGradientScalar(p, c, n, x, width, gx, gy);
+}
+
+CC_TARGET_AVX2
+static void SobelRowMagnitudeAVX2(const int16_t *gx, const int16_t *gy, int width,
+                                  CCSobelNorm norm, uint16_t *mag) {
+    int x = 1;
+    for (; x + 16 < width; x += 16) {
+        __m256i dx = _mm256_loadu_si256((const __m256i *)(gx + x));
+        __m256i dy = _mm256_loadu_si256((const __m256i *)(gy + x));
+        __m256i m;
+        if (norm == CCSobelNorm::L1) {
+            m = _mm256_add_epi16(_mm256_abs_epi16(dx), _mm256_abs_epi16(dy));
+        } else {
+            // unpack and pack both work per 128-bit lane, the order survives
+            __m256i lo = _mm256_unpacklo_epi16(dx, dy), hi = _mm256_unpackhi_epi16(dx, dy);
+            lo = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(lo, lo))));
+            hi = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(hi, hi))));
+            m = _mm256_packs_epi32(lo, hi);
+        }
+        _mm256_storeu_si256((__m256i *)(mag + x), m);
+    }
+    SobelMagnitudeScalar(gx, gy, x, width, norm, mag);
+}
+
+CC_TARGET_AVX2
+static void ThresholdRowAVX2(const uint8_t *in, int n, uint8_t thresh, uint8_t *out) {
+    const __m256i t = _mm256_set1_epi8(static_cast<char>(thresh));
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_cmpeq_epi8(_mm256_max_epu8(v, t), v));
+    }
+    ThresholdScalar(in, i, n, thresh, out);
+}
+
+CC_TARGET_AVX2
+static void RgbToGrayRowAVX2(const uint8_t *rgb, int n, uint8_t *gray) {
+    const __m256i third = _mm256_set1_epi16(21846);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i r, g, b;
+        SplitRgb16(rgb + 3 * i, r, g, b);
+        __m256i s = _mm256_add_epi16(_mm256_add_epi16(_mm256_cvtepu8_epi16(r),
+                                                      _mm256_cvtepu8_epi16(g)),
+                                     _mm256_cvtepu8_epi16(b));
+        _mm_storeu_si128((__m128i *)(gray + i), PackBytesAVX2(_mm256_mulhi_epu16(s, third)));
+    }
+    RgbToGrayScalar(rgb, i, n, gray);
+}
+
+template <int N>
+CC_TARGET_AVX2
+static void MinRowsAVX2(const uint8_t *const *rows, int taps, int n, uint8_t *out) {
+    const int m = N ? N : taps;
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)(rows[0] + i));
+        for (int j = 1; j < m; j++)
+            acc = _mm256_min_epu8(acc, _mm256_loadu_si256((const __m256i *)(rows[j] + i)));
+        _mm256_storeu_si256((__m256i *)(out + i), acc);
+    }
+    MinRowsScalar(rows, m, i, n, out);
+}
+
+CC_TARGET_AVX2
+static uint32_t SadRowAVX2(const uint8_t *a, const uint8_t *b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+    }
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi64(sum, _mm_srli_si128(sum, 8));
+    return SadScalar(a, b, i, n, _mm_cvtsi128_si32(sum));
+}
+
+//
+// AVX-512 (F + BW), 32 pixels per step for 16-bit intermediates, 64 for bytes
+//
+
+// the unmasked conversions leave their pass-through operand undefined, which
+// GCC 12 flags as uninitialized, the zero-masked forms with every lane set
+// compute the same and pass zeros
+#define CC_MASK16 ((__mmask16) 0xFFFF)
+#define CC_MASK32 ((__mmask32) 0xFFFFFFFF)
+
+template <int N>
+CC_TARGET_AVX512
+static void GaussianRowFixedAVX512(const uint8_t *in, int width, const uint16_t *q8, int taps,
+                                   uint16_t *out) {
+    const int n = N ? N : taps;
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i acc = _mm512_setzero_si512();
+        for (int j = 0; j < n; j++) {
+            __m512i p = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(in + x + j)));
+            acc = _mm512_adds_epu16(acc, _mm512_mullo_epi16(p, _mm512_set1_epi16(q8[j])));
+        }
+        _mm512_storeu_si512((void *)(out + x), acc);
+    }
+    GaussianRowScalar(in, x, width, q8, n, out);
+}
+
+template <int N>
+CC_TARGET_AVX512
+static void GaussianColumnFixedAVX512(const uint16_t *const *rows, const uint16_t *q16, int taps,
+                                      int width, uint8_t *out) {
+    const int n = N ? N : taps;
+    const __m512i round = _mm512_set1_epi16(128);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i acc = _mm512_setzero_si512();
+        for (int j = 0; j < n; j++) {
+            if (rows[j] == nullptr)
+                continue;
+            __m512i h = _mm512_loadu_si512((const void *)(rows[j] + x));
+            acc = _mm512_adds_epu16(acc, _mm512_mulhi_epu16(h, _mm512_set1_epi16(q16[j])));
+        }
+        // at most 255 after the shift, truncation does not lose anything
+        acc = _mm512_srli_epi16(_mm512_adds_epu16(acc, round), 8);
+        _mm256_storeu_si256((__m256i *)(out + x), _mm512_maskz_cvtepi16_epi8(CC_MASK32, acc));
+    }
+    GaussianColumnScalar(rows, q16, n, x, width, out);
+}
+
+CC_TARGET_AVX512
+static void SobelRowGradientAVX512(const uint8_t *p, const uint8_t *c, const uint8_t *n,
+                                   int width, int16_t *gx, int16_t *gy) {
+    int x = 1;
+    for (; x + 32 < width; x += 32) {
+        __m512i pl = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p + x - 1)));
+        __m512i pm = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p + x)));
+        __m512i pr = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p + x + 1)));
+        __m512i cl = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(c + x - 1)));
+        __m512i cr = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(c + x + 1)));
+        __m512i nl = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(n + x - 1)));
+        __m512i nm = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(n + x)));
+        __m512i nr = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(n + x + 1)));
+
+        __m512i dx = _mm512_add_epi16(_mm512_sub_epi16(pr, pl), _mm512_sub_epi16(nr, nl));
+        dx = _mm512_add_epi16(dx, _mm512_slli_epi16(_mm512_sub_epi16(cr, cl), 1));
+        __m512i dy = _mm512_add_epi16(_mm512_sub_epi16(nl, pl), _mm512_sub_epi16(nr, pr));
+        dy = _mm512_add_epi16(dy, _mm512_slli_epi16(_mm512_sub_epi16(nm, pm), 1));
+
+        _mm512_storeu_si512((void *)(gx + x), dx);
+        _mm512_storeu_si512((void *)(gy + x), dy);
+    }
+    SobelGradientScalar(p, c, n, x, width, gx, gy);
+}
+
+CC_TARGET_AVX512
+static void SobelRowMagnitudeAVX512(const int16_t *gx, const int16_t *gy, int width,
+                                    CCSobelNorm norm, uint16_t *mag) {
+    int x = 1;
+    for (; x + 32 < width; x += 32) {
+        __m512i dx = _mm512_loadu_si512((const void *)(gx + x));
+        __m512i dy = _mm512_loadu_si512((const void *)(gy + x));
+        __m512i m;
+        if (norm == CCSobelNorm::L1) {
+            m = _mm512_add_epi16(_mm512_abs_epi16(dx), _mm512_abs_epi16(dy));
+        } else {
+            __m512i lo = _mm512_unpacklo_epi16(dx, dy), hi = _mm512_unpackhi_epi16(dx, dy);
+            lo = _mm512_maskz_cvttps_epi32(CC_MASK16, _mm512_maskz_sqrt_ps(CC_MASK16,
+                     _mm512_maskz_cvtepi32_ps(CC_MASK16, _mm512_madd_epi16(lo, lo))));
+            hi = _mm512_maskz_cvttps_epi32(CC_MASK16, _mm512_maskz_sqrt_ps(CC_MASK16,
+                     _mm512_maskz_cvtepi32_ps(CC_MASK16, _mm512_madd_epi16(hi, hi))));
+            m = _mm512_packs_epi32(lo, hi);
+        }
+        _mm512_storeu_si512((void *)(mag + x), m);
+    }
+    SobelMagnitudeScalar(gx, gy, x, width, norm, mag);
+}
+
+CC_TARGET_AVX512
+static void ThresholdRowAVX512(const uint8_t *in, int n, uint8_t thresh, uint8_t *out) {
+    const __m512i t = _mm512_set1_epi8(static_cast<char>(thresh));
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *)(in + i));
+        _mm512_storeu_si512((void *)(out + i), _mm512_movm_epi8(_mm512_cmpge_epu8_mask(v, t)));
+    }
+    ThresholdScalar(in, i, n, thresh, out);
+}
+
+CC_TARGET_AVX512
+static void RgbToGrayRowAVX512(const uint8_t *rgb, int n, uint8_t *gray) {
+    const __m512i third = _mm512_set1_epi16(21846);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m128i r0, g0, b0, r1, g1, b1;
+        SplitRgb16(rgb + 3 * i, r0, g0, b0);
+        SplitRgb16(rgb + 3 * i + 48, r1, g1, b1);
+        __m512i r = _mm512_cvtepu8_epi16(_mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1));
+        __m512i g = _mm512_cvtepu8_epi16(_mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1));
+        __m512i b = _mm512_cvtepu8_epi16(_mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1));
+        __m512i s = _mm512_add_epi16(_mm512_add_epi16(r, g), b);
+        __m512i v = _mm512_mulhi_epu16(s, third);
+        _mm256_storeu_si256((__m256i *)(gray + i), _mm512_maskz_cvtepi16_epi8(CC_MASK32, v));
+    }
+    RgbToGrayScalar(rgb, i, n, gray);
+}
+
+template <int N>
+CC_TARGET_AVX512
+static void MinRowsAVX512(const uint8_t *const *rows, int taps, int n, uint8_t *out) {
+    const int m = N ? N : taps;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i acc = _mm512_loadu_si512((const void *)(rows[0] + i));
+        for (int j = 1; j < m; j++)
+            acc = _mm512_min_epu8(acc, _mm512_loadu_si512((const void *)(rows[j] + i)));
+        _mm512_storeu_si512((void *)(out + i), acc);
+    }
+    MinRowsScalar(rows, m, i, n, out);
+}
+
+CC_TARGET_AVX512
+static uint32_t SadRowAVX512(const uint8_t *a, const uint8_t *b, int n) {
+    __m512i acc = _mm512_setzero_si512();
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i va = _mm512_loadu_si512((const void *)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+        acc = _mm512_add_epi64(acc, _mm512_sad_epu8(va, vb));
+    }
+    // the GCC 12 extract/reduce intrinsics trip -Wuninitialized, sum the lanes via memory
+    uint64_t lanes[8];
+    _mm512_storeu_si512((void *)lanes, acc);
+    uint64_t total = 0;
+    for (int k = 0; k < 8; k++)
+        total += lanes[k];
+    return SadScalar(a, b, i, n, static_cast<uint32_t>(total));
+}
+
+#undef CC_MASK16
+#undef CC_MASK32
+
+#endif // CC_X86_DISPATCH
+
+// generic entry everywhere, specializations for 3, 5, 7 and 9 taps
+#define CC_FIXED_TAPS_TABLE(fn) \
+    { fn<0>, fn<0>, fn<0>, fn<3>, fn<0>, fn<5>, fn<0>, fn<7>, fn<0>, fn<9> }
+
+static const CCPixelKernels kernelTables[] = {
+    {
+        CCCpuIsa::BASELINE,
+        CC_FIXED_TAPS_TABLE(GaussianRowFixed),
+        CC_FIXED_TAPS_TABLE(GaussianColumnFixed),
+        SobelRowGradient,
+        SobelRowMagnitude,
+        ThresholdRow,
+        RgbToGrayRow,
+        CC_FIXED_TAPS_TABLE(MinRows),
+        SadRow,
+    },
+#if defined(CC_X86_DISPATCH)
+    {
+        CCCpuIsa::SSE41,
+        CC_FIXED_TAPS_TABLE(GaussianRowFixed),
+        CC_FIXED_TAPS_TABLE(GaussianColumnFixed),
+        SobelRowGradient,
+        SobelRowMagnitude,
+        ThresholdRow,
+        RgbToGrayRowSSE41,
+        CC_FIXED_TAPS_TABLE(MinRows),
+        SadRow,
+    },
+    {
+        CCCpuIsa::AVX2,
+        CC_FIXED_TAPS_TABLE(GaussianRowFixedAVX2),
+        CC_FIXED_TAPS_TABLE(GaussianColumnFixedAVX2),
+        SobelRowGradientAVX2,
+        SobelRowMagnitudeAVX2,
+        ThresholdRowAVX2,
+        RgbToGrayRowAVX2,
+        CC_FIXED_TAPS_TABLE(MinRowsAVX2),
+        SadRowAVX2,
+    },
+    {
+        CCCpuIsa::AVX512,
+        CC_FIXED_TAPS_TABLE(GaussianRowFixedAVX512),
+        CC_FIXED_TAPS_TABLE(GaussianColumnFixedAVX512),
+        SobelRowGradientAVX512,
+        SobelRowMagnitudeAVX512,
+        ThresholdRowAVX512,
+        RgbToGrayRowAVX512,
+        CC_FIXED_TAPS_TABLE(MinRowsAVX512),
+        SadRowAVX512,
+    },
+#endif
+};
+
+const CCPixelKernels &GetPixelKernels(CCCpuIsa isa) {
+    int n = sizeof(kernelTables) / sizeof(kernelTables[0]);
+    return kernelTables[std::min(static_cast<int>(isa), n - 1)];
+}
+
+const CCPixelKernels &GetPixelKernels(void) {
+    return GetPixelKernels(CCCpuFeatures::getIsa());
+}
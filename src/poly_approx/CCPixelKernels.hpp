@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Pixel Kernels : row kernels shared by the filters, one table per
+ *  instruction set level. The baseline entries are built for the compiler's
+ *  target (SSE2 on x86-64), the others are compiled with function level
+ *  target attributes and only selected when CCCpuFeatures reports them.
+ *
+ */
+
+#ifndef _CCPIXELKERNELS_HPP_
+#define _CCPIXELKERNELS_HPP_
+
+#include <cstdint>
+
+#include "CCCpuFeatures.hpp"
+
+// defined in CCSoebelFilter.hpp
+enum class CCSobelNorm;
+
+// largest kernel size with a specialized (unrolled) entry
+#define CC_MAX_FIXED_TAPS 9
+
+// fixed-point Gaussian row pass, in is zero padded by taps - 1 samples
+typedef void (*CCGaussianRowFn)(const uint8_t *in, int width, const uint16_t *q8, int taps,
+                                uint16_t *out);
+
+// fixed-point Gaussian column pass, nullptr rows contribute nothing
+typedef void (*CCGaussianColumnFn)(const uint16_t *const *rows, const uint16_t *q16, int taps,
+                                   int width, uint8_t *out);
+
+// gx and gy for pixels [1, width - 1) of the row between p and n
+typedef void (*CCSobelGradientFn)(const uint8_t *p, const uint8_t *c, const uint8_t *n,
+                                  int width, int16_t *gx, int16_t *gy);
+
+// magnitude of pixels [1, width - 1)
+typedef void (*CCSobelMagnitudeFn)(const int16_t *gx, const int16_t *gy, int width,
+                                   CCSobelNorm norm, uint16_t *mag);
+
+// out[i] = (in[i] >= thresh) ? 255 : 0
+typedef void (*CCThresholdFn)(const uint8_t *in, int n, uint8_t thresh, uint8_t *out);
+
+// n interleaved RGB pixels to (r + g + b) / 3, truncated
+typedef void (*CCRgbToGrayFn)(const uint8_t *rgb, int n, uint8_t *gray);
+
+// out[i] = min over rows[0..taps) of rows[j][i]
+typedef void (*CCMinRowsFn)(const uint8_t *const *rows, int taps, int n, uint8_t *out);
+
+// sum over [0, n) of |a[i] - b[i]|
+typedef uint32_t (*CCSadFn)(const uint8_t *a, const uint8_t *b, int n);
+
+struct CCPixelKernels {
+
+    CCCpuIsa isa;
+
+    // indexed by tap count, 0 and sizes without a specialization hold the
+    // generic kernel
+    CCGaussianRowFn gaussianRow[CC_MAX_FIXED_TAPS + 1];
+
+    CCGaussianColumnFn gaussianColumn[CC_MAX_FIXED_TAPS + 1];
+
+    CCSobelGradientFn sobelGradient;
+
+    CCSobelMagnitudeFn sobelMagnitude;
+
+    CCThresholdFn threshold;
+
+    CCRgbToGrayFn rgbToGray;
+
+    CCMinRowsFn minRows[CC_MAX_FIXED_TAPS + 1];
+
+    CCSadFn sad;
+};
+
+// table for CCCpuFeatures::getIsa()
+const CCPixelKernels &GetPixelKernels(void);
+
+// table for a given level, which must not exceed the detected one
+const CCPixelKernels &GetPixelKernels(CCCpuIsa isa);
+#endif
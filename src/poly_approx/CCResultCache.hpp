@@ -0,0 +1,335 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  ResultCache : Results of processed images kept on disk, so reruns over
+ *  the same images with the same settings skip decoding and processing.
+ *  An entry is keyed on the XXH64 of the file bytes combined with the hash
+ *  of the processor configuration (CCImageProcessor::getConfigHash) and
+ *  holds the classification, the approximated polygons and the moment
+ *  features in a small binary file named after the key.
+ *
+ *  Entry layout, host byte order:
+ *      "CCRC", u32 version, u64 key
+ *      u32 n, i32 labels[n], f32 confidence[n]
+ *      u32 polygons, per polygon u32 m, i32 xy[2m]
+ *      u32 rows, u32 cols, f32 features[rows * cols]
+ *      u64 XXH64 of everything above
+ *
+ */
+
+#ifndef _CCRESULTCACHE_HPP_
+#define _CCRESULTCACHE_HPP_
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#include "CCHash.hpp"
+#include "CCLogger.hpp"
+#include "CCImageReader.hpp"
+#include "CCImageProcessor.hpp"
+
+#define CC_RESULT_CACHE_MAGIC "CCRC"
+
+#define CC_RESULT_CACHE_VERSION 1
+
+struct CCCachedResult {
+
+    CCClassification classification;
+
+    std::vector<std::vector<Pixel<int>>> polygons;  // approximated contours
+
+    std::vector<float> features;    // CC_NUM_MOMENTS per component
+
+    void Clear(void) {
+        classification.Clear();
+        polygons.clear();
+        features.clear();
+    }
+};
+
+class CCResultCache {
+
+    public:
+
+    // entries live in directory, which is created if needed
+    CCResultCache(const std::string &directory) : directory_(directory) {
+        mkdir(directory_.c_str(), 0755);
+    }
+
+    virtual ~CCResultCache() {}
+
+    const std::string &getDirectory(void) const {
+        return directory_;
+    }
+
+    static uint64_t getKey(uint64_t contentHash, uint64_t configHash) {
+        uint64_t words[2] = {contentHash, configHash};
+        return CCHash64(words, sizeof(words));
+    }
+
+    std::string getEntryPath(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.ccr", static_cast<unsigned long long>(key));
+        return directory_ + name;
+    }
+
+    // key of the image file for the configuration, false if the file
+    // cannot be read
+    bool getKey(const std::string &path, uint64_t configHash, uint64_t &key) const {
+        uint64_t hash;
+        if (!CCHashFile(path, hash))
+            return false;
+        key = getKey(hash, configHash);
+        return true;
+    }
+
+    // the result stored under key, false if there is none or the entry is
+    // damaged
+    bool Load(uint64_t key, CCCachedResult &result) const {
+        std::vector<unsigned char> bytes;
+
+        result.Clear();
+        if (!CCReadFile(getEntryPath(key), bytes))
+            return false;
+        if (Decode(bytes, key, result))
+            return true;
+        CC_ERR("damaged cache entry", getEntryPath(key));
+        return false;
+    }
+
+    // written next to the entry and renamed, readers never see half of it
+    bool Store(uint64_t key, const CCCachedResult &result) {
+        std::vector<unsigned char> bytes;
+        std::string path = getEntryPath(key);
+        std::string tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(tmpId_++);
+
+        Encode(key, result, bytes);
+        {
+            std::ofstream out(tmp, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+            if (!out)
+                goto error;
+        }
+        if (rename(tmp.c_str(), path.c_str()))
+            goto error;
+        return true;
+
+        error:
+        CC_ERR("failed to store cache entry", path);
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // the entry layout, also used to send results elsewhere
+    static void Encode(uint64_t key, const CCCachedResult &result, std::vector<unsigned char> &bytes) {
+        const CCClassification &c = result.classification;
+        const uint32_t cols = CC_NUM_MOMENTS;
+
+        bytes.assign(CC_RESULT_CACHE_MAGIC, CC_RESULT_CACHE_MAGIC + 4);
+        Put(bytes, uint32_t(CC_RESULT_CACHE_VERSION));
+        Put(bytes, key);
+        Put(bytes, uint32_t(c.labels.size()));
+        for (int l : c.labels)
+            Put(bytes, int32_t(l));
+        for (float f : c.confidence)
+            Put(bytes, f);
+        Put(bytes, uint32_t(result.polygons.size()));
+        for (auto &polygon : result.polygons) {
+            Put(bytes, uint32_t(polygon.size()));
+            for (auto &p : polygon) {
+                Put(bytes, int32_t(p.getX()));
+                Put(bytes, int32_t(p.getY()));
+            }
+        }
+        Put(bytes, uint32_t(result.features.size() / cols));
+        Put(bytes, cols);
+        for (float f : result.features)
+            Put(bytes, f);
+        Put(bytes, CCHash64(bytes.data(), bytes.size()));
+    }
+
+    // false if bytes are not a complete, intact encoding for key
+    static bool Decode(const std::vector<unsigned char> &bytes, uint64_t key, CCCachedResult &result) {
+        size_t pos = 4, size;
+        uint32_t version, n, rows, cols;
+        uint64_t stored, checksum;
+
+        result.Clear();
+        if ((bytes.size() < 4 + sizeof(checksum)) || memcmp(bytes.data(), CC_RESULT_CACHE_MAGIC, 4))
+            goto error;
+        size = bytes.size() - sizeof(checksum);
+        memcpy(&checksum, &bytes[size], sizeof(checksum));
+        if (checksum != CCHash64(bytes.data(), size))
+            goto error;
+
+        if (!Get(bytes, size, pos, version) || (version != CC_RESULT_CACHE_VERSION) ||
+            !Get(bytes, size, pos, stored) || (stored != key) || !Get(bytes, size, pos, n) ||
+            (n > (size - pos) / (sizeof(int32_t) + sizeof(float))))
+            goto error;
+        {
+            std::vector<int32_t> labels(n);
+            std::vector<float> confidence(n);
+            if (!GetArray(bytes, size, pos, labels) || !GetArray(bytes, size, pos, confidence))
+                goto error;
+            for (uint32_t i = 0; i < n; i++)
+                result.classification.Add(labels[i], confidence[i]);
+        }
+
+        if (!Get(bytes, size, pos, n))
+            goto error;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t m;
+            if (!Get(bytes, size, pos, m) || (m > (size - pos) / (2 * sizeof(int32_t))))
+                goto error;
+            std::vector<int32_t> xy(2 * m);
+            if (!GetArray(bytes, size, pos, xy))
+                goto error;
+            result.polygons.emplace_back();
+            for (uint32_t j = 0; j < m; j++)
+                result.polygons.back().push_back(Pixel<int>(xy[2 * j], xy[2 * j + 1]));
+        }
+
+        if (!Get(bytes, size, pos, rows) || !Get(bytes, size, pos, cols) ||
+            (cols && (rows > (size - pos) / sizeof(float) / cols)))
+            goto error;
+        result.features.resize(rows * cols);
+        if (!GetArray(bytes, size, pos, result.features) || (pos != size))
+            goto error;
+        return true;
+
+        error:
+        result.Clear();
+        return false;
+    }
+
+    // what a Run of processor leaves behind: classification, polygons of
+    // the contour stage and moment rows
+    static void Collect(CCImageProcessor &processor, CCCachedResult &result) {
+        result.Clear();
+        processor.Classify(result.classification);
+        if (processor.getFeatureExtractor()) {
+            for (auto &contour : processor.getFeatureExtractor()->GetFeatures()) {
+                result.polygons.emplace_back(contour.boundaryPixels.begin(),
+                                             contour.boundaryPixels.end());
+            }
+        }
+        if (processor.getMoments())
+            result.features = processor.getMoments()->getFeatures();
+    }
+
+    // processes the image file with a processor from makeProcessor unless
+    // the file was processed with the same settings before, in which case
+    // it is neither decoded nor processed
+    bool Process(const std::string &path, const std::function<CCImageProcessor(void)> &makeProcessor,
+                 CCCachedResult &result, bool *hit = nullptr) {
+        CCImageProcessor processor = makeProcessor();
+        CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+        CCImageReader gray;
+        uint64_t key;
+        bool ok = false;
+
+        if (hit)
+            *hit = false;
+        if (!getKey(path, processor.getConfigHash(), key))
+            goto error;
+        if (Load(key, result)) {
+            numHits_++;
+            if (hit)
+                *hit = true;
+            return true;
+        }
+        numMisses_++;
+
+        if (!rgb.Load())
+            goto error;
+        gray = rgb.ConvertRGB2GRAY(ok);
+        rgb.Destroy();
+        if (!ok)
+            goto error;
+        processor.Run(gray);
+        Collect(processor, result);
+        Store(key, result);
+        return true;
+
+        error:
+        CC_ERR("failed to load", path);
+        return false;
+    }
+
+    size_t getNumHits(void) const {
+        return numHits_;
+    }
+
+    size_t getNumMisses(void) const {
+        return numMisses_;
+    }
+
+    private:
+
+    template<class T>
+    static void Put(std::vector<unsigned char> &bytes, T v) {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(&v);
+        bytes.insert(bytes.end(), p, p + sizeof(v));
+    }
+
+    template<class T>
+    static bool Get(const std::vector<unsigned char> &bytes, size_t size, size_t &pos, T &v) {
+        if (size - pos < sizeof(v))
+            return false;
+        memcpy(&v, &bytes[pos], sizeof(v));
+        pos += sizeof(v);
+        return true;
+    }
+
+    template<class T>
+    static bool GetArray(const std::vector<unsigned char> &bytes, size_t size, size_t &pos,
+                         std::vector<T> &v) {
+        if ((size - pos) / sizeof(T) < v.size())
+            return false;
+        if (!v.empty())
+            memcpy(v.data(), &bytes[pos], v.size() * sizeof(T));
+        pos += v.size() * sizeof(T);
+        return true;
+    }
+
+    std::string directory_;
+
+    std::atomic<size_t> numHits_ {0};
+
+    std::atomic<size_t> numMisses_ {0};
+
+    std::atomic<unsigned> tmpId_ {0};
+};
+
+#endif
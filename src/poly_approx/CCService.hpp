@@ -0,0 +1,847 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Service : Long running processing service. Clients connect over a Unix
+ *  domain socket and send jobs, an image file or a POSIX shared memory
+ *  object with raw pixels plus a pipeline spec. Each job is answered with
+ *  the result as JSON or in the binary layout of CCResultCache.
+ *
+ *  Processors built for a spec are kept warm in a pool between jobs,
+ *  together with their graph buffers and a pixel buffer for shared memory
+ *  jobs. One thread accepts connections and reads requests, every job is
+ *  a task of the shared scheduler; a connection gets its next request
+ *  read once the answer to the previous one is written.
+ *
+ *  Every message is a frame: u32 size in host order, then size bytes. A
+ *  request holds "key value" lines:
+ *      spec gaussian(5,5,2);soebel(3,3,1);threshold(60);contours(1)
+ *      format json | binary
+ *      path images/circles/drawing(1).png
+ *      shm /name width height channels
+ *  A binary response starts with a status byte, 0 followed by the result
+ *  encoding or 1 followed by the error message.
+ *
+ */
+
+#ifndef _CCSERVICE_HPP_
+#define _CCSERVICE_HPP_
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <map>
+#include <list>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "CCLogger.hpp"
+#include "CCImageReader.hpp"
+#include "CCImageProcessor.hpp"
+#include "CCPixelKernels.hpp"
+#include "CCTaskScheduler.hpp"
+#include "CCResultCache.hpp"
+
+// largest frame either side accepts
+#define CC_SERVICE_MAX_FRAME (64 << 20)
+
+// largest width and height of a shared memory image
+#define CC_SERVICE_MAX_SIDE (1 << 14)
+
+// specs with idle processors in the pool, and idle processors per spec
+#define CC_SERVICE_MAX_SPECS 64
+
+#define CC_SERVICE_MAX_IDLE 4
+
+enum class CCServiceFormat {
+    JSON,
+    BINARY,
+};
+
+struct CCServiceRequest {
+
+    std::string spec;       // stages, see CCPipelineSpec
+
+    std::string path;       // PNG image, or
+
+    std::string shm;        // shared memory object of width x height x
+                            // numChannels pixels (1 gray, 3 RGB)
+    int width {0};
+
+    int height {0};
+
+    int numChannels {0};
+
+    CCServiceFormat format {CCServiceFormat::JSON};
+
+    std::string Encode(void) const {
+        std::ostringstream out;
+        out << "spec " << spec << "\n";
+        out << "format " << ((format == CCServiceFormat::JSON) ? "json" : "binary") << "\n";
+        if (!path.empty())
+            out << "path " << path << "\n";
+        if (!shm.empty())
+            out << "shm " << shm << " " << width << " " << height << " " << numChannels << "\n";
+        return out.str();
+    }
+
+    bool Decode(const std::string &text) {
+        std::istringstream in(text);
+        std::string line;
+
+        *this = CCServiceRequest();
+        while (std::getline(in, line)) {
+            size_t space = line.find(' ');
+            std::string key = line.substr(0, space);
+            std::string value = (space == std::string::npos) ? std::string() : line.substr(space + 1);
+
+            if (key == "spec") {
+                spec = value;
+            } else if (key == "path") {
+                path = value;
+            } else if (key == "format") {
+                if (value == "json")
+                    format = CCServiceFormat::JSON;
+                else if (value == "binary")
+                    format = CCServiceFormat::BINARY;
+                else
+                    return false;
+            } else if (key == "shm") {
+                std::istringstream fields(value);
+                if (!(fields >> shm >> width >> height >> numChannels))
+                    return false;
+            } else if (!key.empty()) {
+                return false;
+            }
+        }
+        return path.empty() != shm.empty();
+    }
+};
+
+// "name(args);name(args);..." with the names of the builder stages
+class CCPipelineSpec {
+
+    public:
+
+    static bool Parse(const std::string &spec, CCImageProcessorBuilder &builder) {
+        std::istringstream in(spec);
+        std::string token;
+
+        while (std::getline(in, token, ';')) {
+            std::string name, args;
+            std::vector<float> v;
+            size_t open;
+
+            token = Trim(token);
+            if (token.empty())
+                continue;
+            open = token.find('(');
+            if (open == std::string::npos) {
+                name = token;
+            } else {
+                if (token.back() != ')')
+                    return false;
+                name = Trim(token.substr(0, open));
+                args = token.substr(open + 1, token.size() - open - 2);
+            }
+
+            // the model path is the only argument that is not a number
+            if (name == "classifier") {
+                builder.addFeatureClassifier(Trim(args));
+                continue;
+            }
+            if (!ParseNumbers(args, v) || !Add(name, v, builder))
+                return false;
+        }
+        return true;
+    }
+
+    private:
+
+    static bool Add(const std::string &name, const std::vector<float> &v,
+                    CCImageProcessorBuilder &builder) {
+        const size_t n = v.size();
+        auto i = [&v](size_t k) { return static_cast<int>(v[k]); };
+
+        if ((name == "gaussian") && (n == 3))
+            builder.addGaussianFilter(i(0), i(1), v[2]);
+        else if ((name == "gaussian") && (n == 4) && (i(3) >= 0) && (i(3) <= int(CCGaussianMode::RECURSIVE)))
+            builder.addGaussianFilter(i(0), i(1), v[2], CCGaussianMode(i(3)));
+        else if ((name == "box") && (n == 2))
+            builder.addBoxFilter(i(0), i(1));
+        else if ((name == "median") && (n == 2))
+            builder.addMedianFilter(i(0), i(1));
+        else if ((name == "soebel") && (n == 3))
+            builder.addSoebelFilter(i(0), i(1), v[2]);
+        else if ((name == "soebel") && (n == 4) && (i(3) >= 0) && (i(3) <= int(CCSobelNorm::L1)))
+            builder.addSoebelFilter(i(0), i(1), v[2], CCSobelNorm(i(3)));
+        else if ((name == "canny") && (n == 2))
+            builder.addCannyFilter(i(0), i(1));
+        else if ((name == "erosion") && (n == 3))
+            builder.addMorphFilter(i(0), i(1), i(2));
+        else if ((name == "threshold") && (n == 1))
+            builder.addThresholding(i(0));
+        else if ((name == "watershed") && (n == 2))
+            builder.addWatershedSplit(v[0], i(1));
+        else if ((name == "contours") && (n == 1))
+            builder.addFeatureExtractor(i(0));
+        else if ((name == "moments") && (n == 0))
+            builder.addMoments();
+        else if ((name == "roi") && (n == 4))
+            builder.addRegionOfInterest(i(0), i(1), i(2), i(3));
+        else if ((name == "pyramid") && (n == 2))
+            builder.addPyramid(i(0), i(1));
+        else
+            return false;
+        return true;
+    }
+
+    static bool ParseNumbers(const std::string &args, std::vector<float> &v) {
+        std::istringstream in(args);
+        std::string field;
+
+        while (std::getline(in, field, ',')) {
+            char *end;
+            field = Trim(field);
+            v.push_back(strtof(field.c_str(), &end));
+            if (field.empty() || *end)
+                return false;
+        }
+        return true;
+    }
+
+    static std::string Trim(const std::string &s) {
+        size_t b = s.find_first_not_of(" \t"), e = s.find_last_not_of(" \t");
+        return (b == std::string::npos) ? std::string() : s.substr(b, e - b + 1);
+    }
+};
+
+// whole frames over a stream socket, false on errors and end of stream
+static inline bool CCWriteFrame(int fd, const void *data, uint32_t size) {
+    const char *p = static_cast<const char *>(data);
+    size_t left = sizeof(size) + size, done = 0;
+    std::vector<char> frame(left);
+
+    memcpy(frame.data(), &size, sizeof(size));
+    if (size)
+        memcpy(frame.data() + sizeof(size), p, size);
+    while (done < left) {
+        ssize_t n = send(fd, frame.data() + done, left - done, MSG_NOSIGNAL);
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+static inline bool CCReadFull(int fd, void *data, size_t size) {
+    char *p = static_cast<char *>(data);
+    while (size) {
+        ssize_t n = recv(fd, p, size, 0);
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static inline bool CCReadFrame(int fd, std::vector<unsigned char> &data) {
+    uint32_t size;
+    if (!CCReadFull(fd, &size, sizeof(size)) || (size > CC_SERVICE_MAX_FRAME))
+        return false;
+    data.resize(size);
+    return !size || CCReadFull(fd, data.data(), size);
+}
+
+class CCService {
+
+    public:
+
+    // maxJobs jobs run at a time, 0 for one per scheduler thread
+    CCService(const std::string &socketPath, int maxJobs = 0) :
+        socketPath_(socketPath),
+        maxJobs_(maxJobs > 0 ? maxJobs : CCTaskScheduler::getInstance().getNumThreads()) {}
+
+    CCService(const CCService &) = delete;
+
+    CCService& operator=(const CCService &) = delete;
+
+    virtual ~CCService() {
+        Stop();
+    }
+
+    // jobs on image files are looked up there first
+    void setResultCache(std::shared_ptr<CCResultCache> pCache) {
+        pCache_ = pCache;
+    }
+
+    // binds the socket and starts serving; a stale socket is replaced,
+    // one a running service still listens on is left alone
+    bool Start(void) {
+        struct sockaddr_un addr;
+        struct stat st;
+        int probe;
+
+        if (listenFd_ >= 0)
+            return true;
+        if (socketPath_.size() >= sizeof(addr.sun_path))
+            goto error;
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, socketPath_.c_str(), socketPath_.size());
+        if (!lstat(socketPath_.c_str(), &st)) {
+            if (!S_ISSOCK(st.st_mode)) {
+                CC_ERR("not a socket", socketPath_);
+                return false;
+            }
+            probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            if ((probe >= 0) && !connect(probe, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))) {
+                close(probe);
+                CC_ERR("socket is in use", socketPath_);
+                return false;
+            }
+            if (probe >= 0)
+                close(probe);
+            unlink(socketPath_.c_str());
+        }
+
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((listenFd_ < 0) ||
+            bind(listenFd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) ||
+            listen(listenFd_, 16) ||
+            (fcntl(listenFd_, F_SETFL, O_NONBLOCK) < 0) ||
+            pipe(wakeFds_) ||
+            (fcntl(wakeFds_[0], F_SETFL, O_NONBLOCK) < 0) ||
+            (fcntl(wakeFds_[1], F_SETFL, O_NONBLOCK) < 0))
+            goto error;
+
+        stopping_ = false;
+        loop_ = std::thread([this]() { Loop(); });
+        CC_INFO("service listening on", socketPath_);
+        return true;
+
+        error:
+        CC_ERR("failed to listen on", socketPath_, strerror(errno));
+        if (listenFd_ >= 0)
+            close(listenFd_);
+        for (int &fd : wakeFds_) {
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+        listenFd_ = -1;
+        return false;
+    }
+
+    // drops the connections, finishes the running jobs and stops
+    void Stop(void) {
+        if (listenFd_ < 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (auto &c : connections_)
+                shutdown(c.fd, SHUT_RDWR);
+        }
+        Wake();
+        loop_.join();
+        jobs_.Wait();
+
+        for (auto &c : connections_)
+            close(c.fd);
+        connections_.clear();
+        close(listenFd_);
+        listenFd_ = -1;
+        unlink(socketPath_.c_str());
+        for (int &fd : wakeFds_) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    // what a job does with a request, response is the payload of the frame
+    void Process(const CCServiceRequest &request, std::vector<unsigned char> &response) {
+        CCCachedResult result;
+        std::string error;
+
+        numJobs_++;
+        if (Run(request, result, error))
+            Respond(request.format, result, response);
+        else
+            RespondError(request.format, error, response);
+    }
+
+    size_t getNumJobs(void) const {
+        return numJobs_;
+    }
+
+    // processors built so far, in use or idle in the pool
+    size_t getNumProcessors(void) const {
+        return numProcessors_;
+    }
+
+    static void Respond(CCServiceFormat format, const CCCachedResult &result,
+                        std::vector<unsigned char> &response) {
+        if (format == CCServiceFormat::BINARY) {
+            CCResultCache::Encode(0, result, response);
+            response.insert(response.begin(), 0);
+            return;
+        }
+
+        const CCClassification &c = result.classification;
+        std::ostringstream out;
+        out << "{\"ok\":true,\"labels\":[";
+        for (size_t i = 0; i < c.labels.size(); i++)
+            out << (i ? "," : "") << c.labels[i];
+        out << "],\"confidence\":[";
+        for (size_t i = 0; i < c.confidence.size(); i++)
+            out << (i ? "," : "") << Number(c.confidence[i]);
+        out << "],\"counts\":[";
+        for (size_t i = 0; i < c.counts.size(); i++)
+            out << (i ? "," : "") << c.counts[i];
+        out << "],\"polygons\":[";
+        for (size_t i = 0; i < result.polygons.size(); i++) {
+            out << (i ? "," : "") << "[";
+            size_t j = 0;
+            for (auto &p : result.polygons[i])
+                out << (j++ ? "," : "") << "[" << p.getX() << "," << p.getY() << "]";
+            out << "]";
+        }
+        out << "],\"features\":{\"cols\":" << CC_NUM_MOMENTS
+            << ",\"rows\":" << result.features.size() / CC_NUM_MOMENTS << ",\"data\":[";
+        for (size_t i = 0; i < result.features.size(); i++)
+            out << (i ? "," : "") << Number(result.features[i]);
+        out << "]}}";
+        std::string json = out.str();
+        response.assign(json.begin(), json.end());
+    }
+
+    static void RespondError(CCServiceFormat format, const std::string &error,
+                             std::vector<unsigned char> &response) {
+        std::string text;
+
+        if (format == CCServiceFormat::BINARY) {
+            response.assign(1, 1);
+            response.insert(response.end(), error.begin(), error.end());
+            return;
+        }
+        text = "{\"ok\":false,\"error\":\"";
+        for (char ch : error) {
+            if ((ch == '"') || (ch == '\\'))
+                text += '\\';
+            if (static_cast<unsigned char>(ch) >= 0x20)
+                text += ch;
+        }
+        text += "\"}";
+        response.assign(text.begin(), text.end());
+    }
+
+    private:
+
+    // a processor for one spec with its scratch pixels
+    struct Warm {
+        CCImageProcessor processor;
+        std::vector<unsigned char> pixels;
+    };
+
+    struct Connection {
+        int fd;
+        bool busy;      // a job answers its last request
+        bool closed;    // the client left or the answer could not be sent
+        std::vector<unsigned char> frame;   // bytes read so far
+    };
+
+    // accepts and reads requests; only a scheduler without workers has
+    // its jobs run here, otherwise the loop stays on the sockets
+    void Loop(void) {
+        CCTaskScheduler &scheduler = CCTaskScheduler::getInstance();
+        const bool helps = (scheduler.getNumThreads() == 1);
+        std::vector<struct pollfd> fds;
+        std::vector<Connection *> polled;
+        bool started;
+        int before;
+
+        for (;;) {
+            while (helps && scheduler.RunOne())
+                ;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_)
+                    return;
+                fds.assign({pollfd{wakeFds_[0], POLLIN, 0}, pollfd{listenFd_, POLLIN, 0}});
+                polled.clear();
+                before = numRunning_;
+                for (auto c = connections_.begin(); c != connections_.end(); ) {
+                    if (!c->busy && c->closed) {
+                        close(c->fd);
+                        c = connections_.erase(c);
+                        continue;
+                    }
+                    if (!c->busy && !Dispatch(*c)) {
+                        fds.push_back(pollfd{c->fd, POLLIN, 0});
+                        polled.push_back(&*c);
+                    }
+                    ++c;
+                }
+                started = numRunning_ > before;
+            }
+            // the jobs just started have nobody else to run them
+            if (started && helps)
+                continue;
+
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                CC_ERR("service poll failed", strerror(errno));
+                return;
+            }
+            if (fds[0].revents) {
+                char drain[64];
+                while (read(wakeFds_[0], drain, sizeof(drain)) > 0)
+                    ;
+            }
+            if (fds[1].revents) {
+                int fd = accept(listenFd_, nullptr, nullptr);
+                if (fd >= 0) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    connections_.push_back(Connection{fd, false, false, std::vector<unsigned char>()});
+                }
+            }
+            for (size_t i = 0; i < polled.size(); i++) {
+                if (fds[i + 2].revents && !Receive(*polled[i])) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    polled[i]->closed = true;
+                }
+            }
+        }
+    }
+
+    // what the socket has for the connection, false once it is to be closed
+    bool Receive(Connection &c) {
+        unsigned char buffer[4096];
+        uint32_t size;
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+        if (n < 0)
+            return (errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        if (n == 0)
+            return false;
+        c.frame.insert(c.frame.end(), buffer, buffer + n);
+        if (c.frame.size() < sizeof(size))
+            return true;
+        memcpy(&size, c.frame.data(), sizeof(size));
+        return size <= CC_SERVICE_MAX_FRAME;
+    }
+
+    // called with the lock held, starts the job of a whole request read
+    // from c; false if the request is not complete yet
+    bool Dispatch(Connection &c) {
+        uint32_t size;
+
+        if (c.frame.size() < sizeof(size))
+            return false;
+        memcpy(&size, c.frame.data(), sizeof(size));
+        if (c.frame.size() < sizeof(size) + size)
+            return false;
+        // the next job to finish wakes the loop
+        if (numRunning_ >= maxJobs_)
+            return true;
+
+        auto first = c.frame.begin() + sizeof(size), last = first + size;
+        std::string text(first, last);
+        Connection *connection = &c;
+        c.frame.erase(c.frame.begin(), last);
+        c.busy = true;
+        numRunning_++;
+        jobs_.Run([this, connection, text]() { Serve(*connection, text); });
+        return true;
+    }
+
+    // one job, answered on the connection of its request
+    void Serve(Connection &connection, const std::string &text) {
+        CCServiceRequest request;
+        std::vector<unsigned char> response;
+        bool sent;
+
+        if (request.Decode(text))
+            Process(request, response);
+        else
+            RespondError(CCServiceFormat::JSON, "bad request", response);
+        sent = CCWriteFrame(connection.fd, response.data(), response.size());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connection.busy = false;
+            connection.closed = connection.closed || !sent;
+            numRunning_--;
+        }
+        Wake();
+    }
+
+    void Wake(void) {
+        char one = 1;
+        if (write(wakeFds_[1], &one, 1) < 0) {
+            // a full pipe already wakes the loop
+        }
+    }
+
+    bool Run(const CCServiceRequest &request, CCCachedResult &result, std::string &error) {
+        std::unique_ptr<Warm> warm = Acquire(request.spec);
+        bool ok = false;
+
+        if (!warm) {
+            error = "bad pipeline spec";
+            return false;
+        }
+        if (warm->processor.getFeatureExtractor())
+            warm->processor.getFeatureExtractor()->Clear();
+        if (!request.path.empty())
+            ok = RunFile(*warm, request.path, result, error);
+        else
+            ok = RunSharedMemory(*warm, request, result, error);
+        Release(request.spec, std::move(warm));
+        return ok;
+    }
+
+    bool RunFile(Warm &warm, const std::string &path, CCCachedResult &result, std::string &error) {
+        CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+        CCImageReader gray;
+        std::shared_ptr<CCResultCache> pCache(pCache_);
+        uint64_t key = 0;
+        bool ok = false;
+
+        if (pCache && pCache->getKey(path, warm.processor.getConfigHash(), key) &&
+            pCache->Load(key, result))
+            return true;
+
+        if (!rgb.Load())
+            goto error;
+        gray = rgb.ConvertRGB2GRAY(ok);
+        rgb.Destroy();
+        if (!ok)
+            goto error;
+        warm.processor.Run(gray);
+        CCResultCache::Collect(warm.processor, result);
+        if (pCache && key)
+            pCache->Store(key, result);
+        return true;
+
+        error:
+        error = "failed to load " + path;
+        return false;
+    }
+
+    // the pixels are copied (and RGB converted) into the scratch buffer of
+    // the processor, the client keeps its object untouched
+    bool RunSharedMemory(Warm &warm, const CCServiceRequest &request, CCCachedResult &result,
+                         std::string &error) {
+        const size_t n = size_t(std::max(request.width, 0)) * size_t(std::max(request.height, 0));
+        const size_t size = n * size_t(std::max(request.numChannels, 0));
+        struct stat st;
+        void *p = MAP_FAILED;
+        int fd = -1;
+
+        // bounded sides keep n an int for the pixel kernels
+        if ((request.width <= 0) || (request.height <= 0) ||
+            (request.width > CC_SERVICE_MAX_SIDE) || (request.height > CC_SERVICE_MAX_SIDE) ||
+            ((request.numChannels != 1) && (request.numChannels != 3)))
+            goto error;
+        fd = shm_open(request.shm.c_str(), O_RDONLY, 0);
+        if ((fd < 0) || fstat(fd, &st) || (size_t(st.st_size) < size))
+            goto error;
+        p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            goto error;
+
+        warm.pixels.resize(n);
+        if (request.numChannels == 1)
+            memcpy(warm.pixels.data(), p, n);
+        else
+            GetPixelKernels().rgbToGray(static_cast<const uint8_t *>(p), int(n), warm.pixels.data());
+        munmap(p, size);
+        close(fd);
+
+        warm.processor.Run(CCImageView(warm.pixels.data(), request.width, request.height,
+                                       request.width, 1), CC_STAGES_ALL);
+        CCResultCache::Collect(warm.processor, result);
+        return true;
+
+        error:
+        error = "bad shared memory object " + request.shm;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    // an idle processor for spec, built if there is none; specs that do
+    // not parse never get into the pool
+    std::unique_ptr<Warm> Acquire(const std::string &spec) {
+        CCImageProcessorBuilder builder;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            auto idle = pool_.find(spec);
+            if (idle != pool_.end()) {
+                std::unique_ptr<Warm> warm = std::move(idle->second.back());
+                idle->second.pop_back();
+                if (idle->second.empty())
+                    pool_.erase(idle);
+                return warm;
+            }
+        }
+        if (!CCPipelineSpec::Parse(spec, builder))
+            return nullptr;
+        numProcessors_++;
+        return std::unique_ptr<Warm>(new Warm{builder.build(), std::vector<unsigned char>()});
+    }
+
+    // keeps the processor idle unless the pool is full, a new spec pushes
+    // out the idle processors of another one
+    void Release(const std::string &spec, std::unique_ptr<Warm> warm) {
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        auto idle = pool_.find(spec);
+        if (idle == pool_.end()) {
+            if (pool_.size() >= CC_SERVICE_MAX_SPECS) {
+                numProcessors_ -= pool_.begin()->second.size();
+                pool_.erase(pool_.begin());
+            }
+            idle = pool_.insert(std::make_pair(spec, std::vector<std::unique_ptr<Warm>>())).first;
+        }
+        if (idle->second.size() >= CC_SERVICE_MAX_IDLE) {
+            numProcessors_--;
+            return;
+        }
+        idle->second.push_back(std::move(warm));
+    }
+
+    static std::string Number(float f) {
+        char buffer[32];
+        if (!std::isfinite(f))
+            return "null";
+        snprintf(buffer, sizeof(buffer), "%.9g", f);
+        return buffer;
+    }
+
+    std::string socketPath_;
+
+    int maxJobs_;
+
+    int listenFd_ {-1};
+
+    int wakeFds_[2] {-1, -1};   // written to wake the loop from poll
+
+    std::shared_ptr<CCResultCache> pCache_;
+
+    std::thread loop_;
+
+    std::list<Connection> connections_;
+
+    int numRunning_ {0};
+
+    bool stopping_ {false};
+
+    std::mutex mutex_;
+
+    CCTaskGroup jobs_;
+
+    std::mutex poolMutex_;
+
+    std::map<std::string, std::vector<std::unique_ptr<Warm>>> pool_;
+
+    std::atomic<size_t> numJobs_ {0};
+
+    std::atomic<size_t> numProcessors_ {0};
+};
+
+// blocking client, one request at a time
+class CCServiceClient {
+
+    public:
+
+    CCServiceClient() {}
+
+    CCServiceClient(const CCServiceClient &) = delete;
+
+    CCServiceClient& operator=(const CCServiceClient &) = delete;
+
+    ~CCServiceClient() {
+        Close();
+    }
+
+    bool Connect(const std::string &socketPath) {
+        struct sockaddr_un addr;
+
+        Close();
+        if (socketPath.size() >= sizeof(addr.sun_path))
+            return false;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+        fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((fd_ >= 0) && !connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)))
+            return true;
+        Close();
+        return false;
+    }
+
+    void Close(void) {
+        if (fd_ >= 0)
+            close(fd_);
+        fd_ = -1;
+    }
+
+    // response is the payload of the answer frame
+    bool Call(const CCServiceRequest &request, std::vector<unsigned char> &response) {
+        std::string text = request.Encode();
+        return (fd_ >= 0) && CCWriteFrame(fd_, text.data(), text.size()) && CCReadFrame(fd_, response);
+    }
+
+    private:
+
+    int fd_ {-1};
+};
+
+#endif
@@ -25,14 +25,77 @@
  *
  *  Soebel Filter Class
  *
+ *  Interior pixels are computed row by row without branches (gradient and
+ *  magnitude kernels from CCPixelKernels), the one pixel frame is cleared
+ *  in a separate pass.
+ *
  */
 
 #ifndef _CCSOEBELFILTER_HPP_
 #define _CCSOEBELFILTER_HPP_
 
 #include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "CCDerivativeFilter.hpp"
 #include "CCImageReader.hpp"
+#include "CCPixelKernels.hpp"
+
+// gradient magnitude norm
+enum class CCSobelNorm {
+
+    L2, // sqrt(gx^2 + gy^2)
+
+    L1, // |gx| + |gy|, no square root
+};
+
+// quantized gradient direction (angle modulo 180 degrees)
+enum CCSobelDirection {
+
+    SOBEL_DIR_0   = 0, // horizontal gradient, vertical edge
+
+    SOBEL_DIR_45  = 1,
+
+    SOBEL_DIR_90  = 2, // vertical gradient, horizontal edge
+
+    SOBEL_DIR_135 = 3,
+};
+
+// 8-bit saturation of pixels [1, width - 1)
+static void SobelRowSaturate(const uint16_t *mag, int width, uint8_t *dst) {
+    int x = 1;
+#if defined(__SSE2__)
+    for (; x + 8 < width; x += 8) {
+        __m128i m = _mm_loadu_si128((const __m128i *)(mag + x));
+        // magnitudes are positive 16-bit lanes, packus clamps them to 255
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(m, m));
+    }
+#endif
+    for (; x < width - 1; x++)
+        dst[x] = std::min<int>(mag[x], 255);
+}
+
+// direction bins of pixels [1, width - 1), tan(22.5) and tan(67.5) in Q15
+static void SobelRowDirection(const int16_t *gx, const int16_t *gy, int width, uint8_t *dir) {
+    for (int x = 1; x < width - 1; x++) {
+        int ax = std::abs(gx[x]), ay = std::abs(gy[x]);
+        int d;
+        if ((ay << 15) <= 13573 * ax)
+            d = SOBEL_DIR_0;
+        else if ((ay << 15) >= 79109 * ax)
+            d = SOBEL_DIR_90;
+        else
+            d = ((gx[x] ^ gy[x]) >= 0) ? SOBEL_DIR_45 : SOBEL_DIR_135;
+        dir[x] = d;
+    }
+}
 
 class CCSoebelFilter : public CCImageDerivativeFilter {
 
@@ -41,96 +104,101 @@ class CCSoebelFilter : public CCImageDerivativeFilter {
     CCSoebelFilter() : CCImageDerivativeFilter(3, 3, 1.0) {
     }
 
-    CCSoebelFilter(int dX, int dY, float var) : CCImageDerivativeFilter(dX, dY, var) {
+    CCSoebelFilter(int dX, int dY, float var, CCSobelNorm norm = CCSobelNorm::L2) :
+        CCImageDerivativeFilter(dX, dY, var), norm_(norm) {
     }
 
     CCSoebelFilter(const CCSoebelFilter &dv) : CCImageDerivativeFilter(dv) {
         variance = dv.variance;
+        norm_ = dv.norm_;
     }
 
     CCSoebelFilter& operator=(const CCSoebelFilter &dv) {
         CCImageDerivativeFilter::operator=(dv);
+        norm_ = dv.norm_;
         return *this;
     }
 
     virtual ~CCSoebelFilter() {
     }
 
-    virtual void Run(CCImageReader &img) {
+    CCSobelNorm getNorm(void) const noexcept {
+        return norm_;
+    }
+
+    // magnitude and (optionally) direction planes, width * height elements
+    // each; the one pixel frame is set to zero
+    void Gradient(const CCImageView &img, uint16_t *mag, uint8_t *dir) {
+        const CCPixelKernels &kernels = GetPixelKernels();
+        int width  = img.getWidth();
+        int height = img.getHeight();
+        std::vector<int16_t> gx(width), gy(width);
+
+        ClearFrame(mag, width, height);
+        if (dir)
+            ClearFrame(dir, width, height);
+        if ((width < 3) || (height < 3))
+            return;
+
+        for (int y = 1; y < height - 1; y++) {
+            kernels.sobelGradient(img.getRow(y - 1), img.getRow(y), img.getRow(y + 1),
+                                  width, gx.data(), gy.data());
+            kernels.sobelMagnitude(gx.data(), gy.data(), width, norm_, mag + y * width);
+            if (dir)
+                SobelRowDirection(gx.data(), gy.data(), width, dir + y * width);
+        }
+    }
+
+    // in place 8-bit magnitude, only three source rows are kept aside
+    virtual void Run(const CCImageView &img) {
+        const CCPixelKernels &kernels = GetPixelKernels();
         int width  = img.getWidth();
         int height = img.getHeight();
-        int numChannel = img.getNumChannels();
-        uint8_t *imgData = img.getDataBlob();
-        uint8_t *imgDst = new uint8_t[width * height * numChannel];
 
-        //dbg_printf ("width :%d height :%d numChannels :%d\n",
-        //    width, height, numChannel);
+        if ((width >= 3) && (height >= 3)) {
+            std::vector<uint8_t> rows(3 * width);
+            std::vector<int16_t> gx(width), gy(width);
+            std::vector<uint16_t> mag(width);
+            uint8_t *prev = &rows[0], *curr = &rows[width], *next = &rows[2 * width];
+
+            memcpy(prev, img.getRow(0), width);
+            memcpy(curr, img.getRow(1), width);
+            for (int y = 1; y < height - 1; y++) {
+                memcpy(next, img.getRow(y + 1), width);
+                kernels.sobelGradient(prev, curr, next, width, gx.data(), gy.data());
+                kernels.sobelMagnitude(gx.data(), gy.data(), width, norm_, mag.data());
+                SobelRowSaturate(mag.data(), width, img.getRow(y));
+                std::swap(prev, curr);
+                std::swap(curr, next);
+            }
+        }
 
+        // border pass
         for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-
-                int a11 = -1, a12 = -1, a13 = -1;
-                int a21 = -1, a22 = -1, a23 = -1;
-                int a31 = -1, a32 = -1, a33 = -1;
-
-                int boundary = 0;
-        
-                // y - boundary cases
-                if (y - 1 < 0) {
-                    a11 = a12 = a13 = 0;
-                    boundary = 1;
-                }
-
-                if (y + 1 >= height) {
-                    a31 = a32 = a33 = 0;
-                    boundary = 1;
-                }
-
-                // x - boundary cases
-                if (x - 1 < 0) {
-                    a11 = a21 = a31 = 0;
-                    boundary = 1;
-                }
-
-                if (x + 1 >= width) {
-                    a13 = a23 = a33 = 0;
-                    boundary = 1;
-                }
-
-                if (a11 < 0)
-                    a11 = imgData[(y - 1) * width + x - 1];
-                if (a12 < 0)
-                    a12 = imgData[(y - 1) * width + x];
-                if (a13 < 0)
-                    a13 = imgData[(y - 1) * width + x + 1];
-                if (a21 < 0)
-                    a21 = imgData[y * width + x - 1];
-                if (a23 < 0)
-                    a23 = imgData[y * width + x + 1];
-                if (a31 < 0)
-                    a31 = imgData[(y + 1) * width + x - 1];
-                if (a32 < 0)
-                    a32 = imgData[(y + 1) * width + x];
-                if (a33 < 0)
-                    a33 = imgData[(y + 1) * width + x + 1];
-
-                int gx = a13 - a11 + 2*(a23 - a21) + a33 - a31;
-                int gy = a31 - a11 + 2*(a32 - a12) + a33 - a13;
-
-                if (boundary)
-                    a22 = 0;
-                else
-                    a22 = sqrtf(gx*gx + gy*gy);
-
-                imgDst[y * width + x] = a22;
-                //dbg_printf("(%d, %d) :%d %d \n", y, x, gx, gy);
-                //dbg_printf("(%d, %d) :a11=%d a12=%d a13=%d a21=%d a22=%d a23=%d a31=%d a32=%d a33=%d\n",
-                //    y, x, a11, a12, a13, a21, a22, a23, a31, a32, a33);
+            uint8_t *row = img.getRow(y);
+            if ((y == 0) || (y == height - 1)) {
+                memset(row, 0, width);
+            } else {
+                row[0] = 0;
+                row[width - 1] = 0;
             }
         }
+    }
+
+    private:
 
-        memcpy(imgData, imgDst, width * height * numChannel);
-        delete imgDst;
+    template<class T>
+    static void ClearFrame(T *plane, int width, int height) {
+        for (int y = 0; y < height; y++) {
+            if ((y == 0) || (y == height - 1)) {
+                memset(plane + y * width, 0, width * sizeof(T));
+            } else {
+                plane[y * width] = 0;
+                plane[y * width + width - 1] = 0;
+            }
+        }
     }
+
+    CCSobelNorm norm_ {CCSobelNorm::L2};
 };
 #endif
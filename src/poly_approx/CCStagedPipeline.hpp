@@ -0,0 +1,280 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  StagedPipeline : decode -> filter -> classify -> save over a list of
+ *  image files. Every step has its own workers and hands images on
+ *  through bounded lock-free queues, so PNG decoding and encoding overlap
+ *  with the filters instead of adding to them. A full queue stalls the
+ *  step feeding it, which bounds the images in flight.
+ *
+ *  Every image of a step is a task of the shared scheduler, started once
+ *  its input is popped from the queue, so no task ever blocks on a queue
+ *  and the steps share the scheduler's threads. An output the next queue
+ *  has no cell for is held back until it has, the step meanwhile starts
+ *  no further images.
+ *
+ */
+
+#ifndef _CCSTAGEDPIPELINE_HPP_
+#define _CCSTAGEDPIPELINE_HPP_
+
+#include <deque>
+#include <mutex>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "CCImageReader.hpp"
+#include "CCImageProcessor.hpp"
+#include "CCBoundedQueue.hpp"
+#include "CCTaskScheduler.hpp"
+#include "CCResultCache.hpp"
+
+enum class CCPipelineStep {
+    DECODE,     // CCImageReader::Load and conversion to gray
+    FILTER,     // CC_STAGES_FILTERS of a fresh processor
+    CLASSIFY,   // CC_STAGES_FEATURES and Classify
+    SAVE,       // the processed image, if an output directory is set
+    NUM_STEPS,
+};
+
+struct CCPipelineResult {
+
+    std::string path;
+
+    bool ok;    // decoded and processed
+
+    bool saved;
+
+    bool cached;    // taken from the result cache, neither decoded nor saved
+
+    CCClassification classification;
+};
+
+class CCStagedPipeline {
+
+    public:
+
+    // every image gets a processor of its own from makeProcessor, the
+    // stages keep per image state; pyramids are not used here
+    CCStagedPipeline(std::function<CCImageProcessor(void)> makeProcessor, size_t queueDepth = 4) :
+        makeProcessor_(makeProcessor), queueDepth_(queueDepth ? queueDepth : 1) {
+        for (auto &n : numWorkers_)
+            n = 1;
+    }
+
+    virtual ~CCStagedPipeline() {}
+
+    // images a step works on at once
+    void setNumWorkers(CCPipelineStep step, int numWorkers) {
+        numWorkers_[static_cast<int>(step)] = std::max(numWorkers, 1);
+    }
+
+    int getNumWorkers(CCPipelineStep step) const {
+        return numWorkers_[static_cast<int>(step)];
+    }
+
+    // processed images are written there under their own file name
+    void setOutputDirectory(const std::string &dir) {
+        outputDir_ = dir;
+    }
+
+    // images processed with the same settings before are looked up
+    // instead of decoded, new results are added to the cache
+    void setResultCache(std::shared_ptr<CCResultCache> pCache) {
+        pCache_ = pCache;
+    }
+
+    // one result per path, in the order of paths
+    std::vector<CCPipelineResult> Run(const std::vector<std::string> &paths) {
+        const int numSteps = static_cast<int>(CCPipelineStep::NUM_STEPS);
+        std::unique_ptr<CCBoundedQueue<Item *>> queues[numSteps - 1];
+        std::shared_ptr<CCResultCache> pCache(pCache_);
+        const uint64_t configHash = makeProcessor_().getConfigHash();
+        std::mutex lock;
+        int running[numSteps] = {0};
+        std::deque<Item *> held[numSteps - 1];
+        size_t next = 0;
+        CCTaskGroup group;
+
+        results_.assign(paths.size(), CCPipelineResult{std::string(), false, false, false, CCClassification()});
+        for (size_t i = 0; i < paths.size(); i++)
+            results_[i].path = paths[i];
+        for (int s = 0; s < numSteps - 1; s++)
+            queues[s].reset(new CCBoundedQueue<Item *>(queueDepth_));
+
+        auto decode = [&](Item *item) {
+            size_t i = item->index;
+            item->hasKey = pCache && pCache->getKey(paths[i], configHash, item->key);
+            if (item->hasKey && Lookup(*pCache, item->key, results_[i]))
+                item->ok = false;
+            else
+                item->ok = Decode(paths[i], item->image);
+        };
+
+        auto filter = [&](Item *item) {
+            if (item->ok) {
+                item->processor.reset(new CCImageProcessor(makeProcessor_()));
+                item->processor->Run(item->image, item->processor->getRegionOfInterest(item->image),
+                                     CC_STAGES_FILTERS);
+            }
+        };
+
+        auto classify = [&](Item *item) {
+            if (item->ok) {
+                CCImageProcessor &proc = *item->processor;
+                proc.Run(item->image, proc.getRegionOfInterest(item->image), CC_STAGES_FEATURES);
+                if (item->hasKey) {
+                    CCCachedResult cached;
+                    CCResultCache::Collect(proc, cached);
+                    pCache->Store(item->key, cached);
+                    results_[item->index].classification = cached.classification;
+                } else {
+                    proc.Classify(results_[item->index].classification);
+                }
+                results_[item->index].ok = true;
+            }
+        };
+
+        auto save = [&](Item *item) {
+            if (item->ok && !outputDir_.empty())
+                results_[item->index].saved = Save(results_[item->index].path, item->image);
+            item->image.Destroy();
+        };
+
+        std::function<void(Item *)> steps[numSteps] = {decode, filter, classify, save};
+        std::function<void(void)> schedule;
+
+        // a task never waits: its item was popped when it was started, an
+        // output the next queue has no cell for is held back
+        auto task = [&](int s, Item *item) {
+            steps[s](item);
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (s == numSteps - 1)
+                delete item;
+            else if (!held[s].empty() || !queues[s]->TryPush(item))
+                held[s].push_back(item);
+            running[s]--;
+            schedule();
+        };
+
+        // called with the lock held, later steps first so the queues drain;
+        // a step with held back output starts nothing new
+        schedule = [&]() {
+            for (int s = numSteps - 1; s >= 0; s--) {
+                if (s < numSteps - 1) {
+                    while (!held[s].empty() && queues[s]->TryPush(held[s].front()))
+                        held[s].pop_front();
+                    if (!held[s].empty())
+                        continue;
+                }
+                while (running[s] < numWorkers_[s]) {
+                    Item *item = nullptr;
+                    if (s > 0) {
+                        if (!queues[s - 1]->TryPop(item))
+                            break;
+                    } else if (next < paths.size()) {
+                        item = new Item();
+                        item->index = next++;
+                    } else {
+                        break;
+                    }
+                    running[s]++;
+                    group.Run([&task, s, item]() { task(s, item); });
+                }
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            schedule();
+        }
+        group.Wait();
+        return results_;
+    }
+
+    private:
+
+    struct Item {
+        int index;
+        bool ok;
+        bool hasKey;
+        uint64_t key;
+        CCImageReader image;
+        std::unique_ptr<CCImageProcessor> processor;
+    };
+
+    static bool Lookup(const CCResultCache &cache, uint64_t key, CCPipelineResult &result) {
+        CCCachedResult cached;
+        if (!cache.Load(key, cached))
+            return false;
+        result.ok = result.cached = true;
+        result.classification = cached.classification;
+        return true;
+    }
+
+    static bool Decode(const std::string &path, CCImageReader &gray) {
+        CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+        bool ok = false;
+
+        if (!rgb.Load())
+            goto error;
+        gray = rgb.ConvertRGB2GRAY(ok);
+        rgb.Destroy();
+        if (!ok)
+            goto error;
+        return true;
+
+        error:
+        CC_ERR("failed to load", path);
+        return false;
+    }
+
+    bool Save(const std::string &path, CCImageReader &img) {
+        size_t slash = path.rfind('/');
+        std::string name = outputDir_ + "/" + ((slash == std::string::npos) ? path : path.substr(slash + 1));
+        img.setFilename(name.c_str());
+        if (img.Save())
+            return true;
+        CC_ERR("failed to save image", name);
+        return false;
+    }
+
+    std::function<CCImageProcessor(void)> makeProcessor_;
+
+    size_t queueDepth_;
+
+    int numWorkers_[static_cast<int>(CCPipelineStep::NUM_STEPS)];
+
+    std::string outputDir_;
+
+    std::shared_ptr<CCResultCache> pCache_;
+
+    std::vector<CCPipelineResult> results_;
+};
+#endif
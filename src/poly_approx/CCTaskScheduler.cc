@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  TaskScheduler : work stealing runtime, see CCTaskScheduler.hpp.
+ *
+ */
+
+#include <cstdlib>
+#include <algorithm>
+
+#include "CCTaskScheduler.hpp"
+
+thread_local CCTaskScheduler *CCTaskScheduler::current_ = nullptr;
+
+thread_local int CCTaskScheduler::index_ = -1;
+
+CCTaskGroup::CCTaskGroup() : scheduler_(CCTaskScheduler::getInstance()) {}
+
+CCTaskGroup::CCTaskGroup(CCTaskScheduler &scheduler) : scheduler_(scheduler) {}
+
+CCTaskGroup::~CCTaskGroup() {
+    Wait();
+}
+
+void CCTaskGroup::Run(std::function<void()> task) {
+    pending_++;
+    scheduler_.Push(CCTaskScheduler::Task{std::move(task), this});
+}
+
+void CCTaskGroup::Wait(void) {
+    while (pending_.load() > 0) {
+        if (scheduler_.RunOne())
+            continue;
+
+        // the rest runs on other threads, sleep until it is done or there is more to steal
+        std::unique_lock<std::mutex> lock(scheduler_.sleepLock_);
+        scheduler_.wakeup_.wait(lock, [this] {
+            return (pending_.load() == 0) || (scheduler_.numQueued_.load() > 0);
+        });
+    }
+}
+
+CCTaskScheduler::CCTaskScheduler(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+
+    // the thread waiting on a group is the last of numThreads
+    for (int i = 0; i < numThreads; i++)
+        queues_.emplace_back(new WorkQueue());
+    for (int i = 0; i < numThreads - 1; i++)
+        workers_.push_back(std::thread(&CCTaskScheduler::Worker, this, i));
+}
+
+CCTaskScheduler::~CCTaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepLock_);
+        stop_ = true;
+    }
+    wakeup_.notify_all();
+    for (auto &t : workers_)
+        t.join();
+    // nothing left if there were no workers
+    while (RunOne())
+        ;
+}
+
+CCTaskScheduler &CCTaskScheduler::getInstance(void) {
+    static CCTaskScheduler instance(getenv("CC_NUM_THREADS") ? atoi(getenv("CC_NUM_THREADS")) : 0);
+    return instance;
+}
+
+int CCTaskScheduler::getNumThreads(void) const noexcept {
+    return workers_.size() + 1;
+}
+
+void CCTaskScheduler::ParallelFor(int begin, int end, int grain,
+                                  const std::function<void(int, int)> &body) {
+    if (begin >= end)
+        return;
+    grain = std::max(grain, 1);
+    if ((end - begin <= grain) || workers_.empty()) {
+        for (int first = begin; first < end; first += grain)
+            body(first, std::min(first + grain, end));
+        return;
+    }
+
+    CCTaskGroup group(*this);
+    Split(group, begin, end, grain, body);
+    group.Wait();
+}
+
+void CCTaskScheduler::Split(CCTaskGroup &group, int begin, int end, int grain,
+                            const std::function<void(int, int)> &body) {
+    // keep the first half, the second one is up for stealing
+    while (end - begin > grain) {
+        int mid = begin + (end - begin) / 2;
+        group.Run([&group, mid, end, grain, &body]() { Split(group, mid, end, grain, body); });
+        end = mid;
+    }
+    body(begin, end);
+}
+
+bool CCTaskScheduler::RunOne(void) {
+    Task task;
+    if (!Pop(task))
+        return false;
+
+    task.fn();
+    // the group may be gone once pending_ is 0, only the scheduler is touched after
+    if (--task.group->pending_ == 0) {
+        std::lock_guard<std::mutex> lock(sleepLock_);
+        wakeup_.notify_all();
+    }
+    return true;
+}
+
+void CCTaskScheduler::Push(Task &&task) {
+    // workers keep their own tasks, everybody else goes through the shared queue
+    int q = (current_ == this) ? index_ : queues_.size() - 1;
+    {
+        std::lock_guard<std::mutex> lock(queues_[q]->lock);
+        queues_[q]->tasks.push_back(std::move(task));
+    }
+    // under the sleep lock, a thread about to wait sees the task or the wakeup
+    std::lock_guard<std::mutex> lock(sleepLock_);
+    numQueued_++;
+    wakeup_.notify_one();
+}
+
+bool CCTaskScheduler::Pop(Task &task) {
+    const int n = queues_.size();
+    int self = (current_ == this) ? index_ : n - 1;
+
+    if (numQueued_.load() == 0)
+        return false;
+
+    // newest own task first, it is the one most likely still in cache
+    {
+        std::lock_guard<std::mutex> lock(queues_[self]->lock);
+        if (!queues_[self]->tasks.empty()) {
+            task = std::move(queues_[self]->tasks.back());
+            queues_[self]->tasks.pop_back();
+            numQueued_--;
+            return true;
+        }
+    }
+
+    // then the oldest task of another queue, the largest piece of work
+    for (int i = 1; i < n; i++) {
+        WorkQueue &victim = *queues_[(self + i) % n];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            numQueued_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CCTaskScheduler::Worker(int index) {
+    current_ = this;
+    index_ = index;
+
+    for (;;) {
+        if (RunOne())
+            continue;
+        if (stop_ && (numQueued_.load() == 0))
+            return;
+
+        std::unique_lock<std::mutex> lock(sleepLock_);
+        wakeup_.wait(lock, [this] { return stop_ || (numQueued_.load() > 0); });
+    }
+}
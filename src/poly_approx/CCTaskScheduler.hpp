@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  TaskScheduler : work stealing runtime shared by every level of
+ *  parallelism, images of a data set, tiles of an image and stages of the
+ *  pipeline graph. Each worker owns a deque, runs its own tasks newest
+ *  first and steals the oldest task of another deque when it runs dry.
+ *  Threads that wait for a task group run queued tasks meanwhile, so
+ *  nested parallel loops never add threads beyond the pool.
+ *
+ *  The shared instance uses the hardware concurrency unless the
+ *  CC_NUM_THREADS environment variable asks for another count.
+ *
+ */
+
+#ifndef _CCTASKSCHEDULER_HPP_
+#define _CCTASKSCHEDULER_HPP_
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// pixels per tile of the per-pixel stages, smaller images stay on one thread
+#define CC_TILE_PIXELS (1 << 16)
+
+class CCTaskScheduler;
+
+// tasks spawned together, Wait() returns once all of them have run
+class CCTaskGroup {
+
+    public:
+
+    // on the shared scheduler
+    CCTaskGroup();
+
+    explicit CCTaskGroup(CCTaskScheduler &scheduler);
+
+    CCTaskGroup(const CCTaskGroup &) = delete;
+
+    CCTaskGroup& operator=(const CCTaskGroup &) = delete;
+
+    ~CCTaskGroup();
+
+    void Run(std::function<void()> task);
+
+    // runs queued tasks of any group until this one is done, sleeps
+    // while the last ones run elsewhere
+    void Wait(void);
+
+    private:
+
+    friend class CCTaskScheduler;
+
+    CCTaskScheduler &scheduler_;
+
+    std::atomic<int> pending_ {0};
+};
+
+class CCTaskScheduler {
+
+    public:
+
+    // numThreads counts the caller, 0 picks the hardware concurrency
+    explicit CCTaskScheduler(int numThreads = 0);
+
+    CCTaskScheduler(const CCTaskScheduler &) = delete;
+
+    CCTaskScheduler& operator=(const CCTaskScheduler &) = delete;
+
+    // queued tasks are run before the workers stop
+    ~CCTaskScheduler();
+
+    static CCTaskScheduler &getInstance(void);
+
+    // workers plus the thread that waits
+    int getNumThreads(void) const noexcept;
+
+    // body(first, last) over [begin, end) in chunks of at most grain
+    // items, halves are spawned recursively so idle threads can steal
+    void ParallelFor(int begin, int end, int grain, const std::function<void(int, int)> &body);
+
+    // runs one queued task on the calling thread, false if none was found
+    bool RunOne(void);
+
+    private:
+
+    friend class CCTaskGroup;
+
+    struct Task {
+        std::function<void()> fn;
+        CCTaskGroup *group;
+    };
+
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void Push(Task &&task);
+
+    bool Pop(Task &task);
+
+    void Worker(int index);
+
+    static void Split(CCTaskGroup &group, int begin, int end, int grain,
+                      const std::function<void(int, int)> &body);
+
+    // one per worker, the last one takes tasks from other threads
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+
+    std::vector<std::thread> workers_;
+
+    std::atomic<int> numQueued_ {0};
+
+    std::atomic<bool> stop_ {false};
+
+    std::mutex sleepLock_;
+
+    std::condition_variable wakeup_;
+
+    // scheduler and queue of the calling worker thread
+    static thread_local CCTaskScheduler *current_;
+
+    static thread_local int index_;
+};
+
+#endif
@@ -30,6 +30,8 @@
 #include "CCPixel.hpp"
 #include "CCPixelUtils.hpp"
 #include "CCImageReader.hpp"
+#include "CCPixelKernels.hpp"
+#include "CCTaskScheduler.hpp"
 
 class CCThresholding {
 
@@ -41,24 +43,24 @@ class CCThresholding {
 
     virtual ~CCThresholding() {}
 
-    void Run(CCImageReader &img) {
-        byte *src;
-        int height, width;//, numChannels;
+    // bands of rows are tiles for the task scheduler
+    void Run(const CCImageView &img) {
+        const CCPixelKernels &kernels = GetPixelKernels();
+        const int threshold = dist_threshold_;
+        int height = img.getHeight();
+        int width  = img.getWidth();
 
-        src    = img.getDataBlob();
-        height = img.getHeight();
-        width  = img.getWidth();
-
-        for (int i = 0; i < height; i++) {
-            for (int j = 0; j < width; j++) {
-                Pixel<int> pixel(j, i);
-                int index = pixel.getY() * width + pixel.getX();
-                if ((byte) src[index] >= dist_threshold_)
-                   src[index] = 255;
+        CCTaskScheduler::getInstance().ParallelFor(0, height, CC_TILE_PIXELS / std::max(width, 1),
+            [&img, &kernels, threshold, width](int first, int last) {
+            for (int i = first; i < last; i++) {
+                byte *row = img.getRow(i);
+                // thresholds outside the 8-bit range select none or all pixels
+                if (threshold > 255)
+                    memset(row, 0, width);
                 else
-                   src[index] = 0;
+                    kernels.threshold(row, width, std::max(threshold, 0), row);
             }
-        }
+        });
     }
 
     private:
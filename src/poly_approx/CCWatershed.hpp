@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ *  Watershed : splits touching blobs of a binary image. Markers are the
+ *  plateaus of the distance transform that dominate a (2r + 1)^2 window,
+ *  regions grow from them over the foreground in order of decreasing
+ *  distance. Foreground pixels next to a different region are cleared, so
+ *  every region ends up as its own 8-connected component for the tracer.
+ *
+ */
+
+#ifndef _CCWATERSHED_HPP_
+#define _CCWATERSHED_HPP_
+
+#include <queue>
+#include <tuple>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "CCImageView.hpp"
+#include "CCDistanceTransform.hpp"
+#include "CCConnectedComponents.hpp"
+
+// max over a window of 2 * radius + 1 samples spaced by step, clipped at the ends
+static void SlidingMax1D(const float *in, int n, int step, int radius, float *out) {
+    for (int i = 0; i < n; i++) {
+        float m = in[i * step];
+        for (int j = std::max(i - radius, 0); j <= std::min(i + radius, n - 1); j++)
+            m = std::max(m, in[j * step]);
+        out[i * step] = m;
+    }
+}
+
+class CCWatershed {
+
+    public:
+
+    CCWatershed() {}
+
+    // peaks closer than minPeak to the background do not seed a region
+    CCWatershed(float minPeak, int radius) : minPeak_(minPeak), radius_(radius) {}
+
+    virtual ~CCWatershed() {}
+
+    // in place on a binary view, returns the number of regions
+    int Run(const CCImageView &img) {
+        width_  = img.getWidth();
+        height_ = img.getHeight();
+        labels_.assign(width_ * height_, 0);
+        numRegions_ = 0;
+        if (img.empty())
+            return 0;
+
+        dt_.Run(img);
+        numRegions_ = FindMarkers(img);
+        Flood(img);
+        Split(img);
+        return numRegions_;
+    }
+
+    int getNumRegions(void) const noexcept {
+        return numRegions_;
+    }
+
+    // region per pixel, 0 for background, cleared boundaries and foreground
+    // no marker reached
+    const std::vector<int> &getLabels(void) const noexcept {
+        return labels_;
+    }
+
+    const std::vector<float> &getDistance(void) const noexcept {
+        return dt_.getDistance();
+    }
+
+    private:
+
+    int FindMarkers(const CCImageView &img) {
+        const std::vector<float> &dist = dt_.getDistance();
+        std::vector<float> tmp(width_ * height_), peak(width_ * height_);
+        std::vector<uint8_t> seed(width_ * height_, 0);
+        CCConnectedComponents plateaus;
+
+        for (int y = 0; y < height_; y++)
+            SlidingMax1D(&dist[y * width_], width_, 1, radius_, &tmp[y * width_]);
+        for (int x = 0; x < width_; x++)
+            SlidingMax1D(&tmp[x], height_, width_, radius_, &peak[x]);
+
+        for (int i = 0; i < width_ * height_; i++)
+            seed[i] = ((dist[i] > 0) && (dist[i] >= minPeak_) && (dist[i] >= peak[i])) ? 255 : 0;
+
+        // a plateau of equal maxima is one marker
+        int n = plateaus.Run(CCImageView(seed.data(), width_, height_, width_, 1));
+        labels_ = plateaus.getLabels();
+        return n;
+    }
+
+    // every foreground pixel takes the region of the neighbour that reached
+    // it first, deeper pixels are taken before shallower ones
+    void Flood(const CCImageView &img) {
+        const std::vector<float> &dist = dt_.getDistance();
+        // distance, insertion order (FIFO among ties), pixel
+        typedef std::tuple<float, long, int> Entry;
+        std::priority_queue<Entry> queue;
+        long order = 0;
+
+        for (int i = 0; i < width_ * height_; i++) {
+            if (labels_[i])
+                queue.push(Entry(dist[i], --order, i));
+        }
+
+        while (!queue.empty()) {
+            int i = std::get<2>(queue.top());
+            int x = i % width_, y = i / width_;
+            queue.pop();
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = x + dx, ny = y + dy;
+                    if ((nx < 0) || (ny < 0) || (nx >= width_) || (ny >= height_))
+                        continue;
+                    int j = ny * width_ + nx;
+                    if (labels_[j] || !img.getRow(ny)[nx])
+                        continue;
+                    labels_[j] = labels_[i];
+                    queue.push(Entry(dist[j], --order, j));
+                }
+            }
+        }
+    }
+
+    // clearing the earlier pixel of every 8-adjacent pair with different
+    // regions leaves no two regions touching
+    void Split(const CCImageView &img) {
+        static const int fwd[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+        for (int y = 0; y < height_; y++) {
+            uint8_t *row = img.getRow(y);
+            for (int x = 0; x < width_; x++) {
+                int l = labels_[y * width_ + x];
+                if (!l)
+                    continue;
+                for (auto &d : fwd) {
+                    int nx = x + d[0], ny = y + d[1];
+                    if ((nx < 0) || (nx >= width_) || (ny >= height_))
+                        continue;
+                    int m = labels_[ny * width_ + nx];
+                    if (m && (m != l)) {
+                        row[x] = 0;
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (int y = 0; y < height_; y++)
+            for (int x = 0; x < width_; x++)
+                if (!img.getRow(y)[x])
+                    labels_[y * width_ + x] = 0;
+    }
+
+    float minPeak_ {2.0f};
+
+    int radius_ {3};
+
+    int width_ {0};
+
+    int height_ {0};
+
+    int numRegions_ {0};
+
+    CCDistanceTransform dt_;
+
+    std::vector<int> labels_;
+};
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright <2019> Saptarshi Sen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Processing service daemon and a one-shot client for it
+ *
+ *   ccservice <socket> [jobs] [cache directory]
+ *       serve jobs until SIGINT or SIGTERM
+ *
+ *   ccservice -c <socket> <spec> <image> [json|binary]
+ *       send one job, the response goes to stdout
+ */
+
+#include <signal.h>
+
+#include <set>
+#include <stack>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "CCLogger.hpp"
+#include "CCService.hpp"
+
+//
+// Logger
+std::mutex CCLog::nanny_;
+//
+std::ofstream* CCLog::ostreamp_ = nullptr;
+//
+std::string CCLog::filename_;
+//
+CC_LOGLEVEL CCLog::level_ = CC_LOG_INFO;
+//
+bool CCConsoleLog::canLog = true;
+
+static int usage(void) {
+    std::cerr << "usage: ccservice <socket> [jobs] [cache directory]" << std::endl;
+    std::cerr << "       ccservice -c <socket> <spec> <image> [json|binary]" << std::endl;
+    return 2;
+}
+
+static int client(int argc, char **argv) {
+    CCServiceClient client;
+    CCServiceRequest request;
+    std::vector<unsigned char> response;
+
+    if ((argc < 5) || (argc > 6))
+        return usage();
+    request.spec = argv[3];
+    request.path = argv[4];
+    if (argc == 6)
+        request.format = (std::string(argv[5]) == "binary") ? CCServiceFormat::BINARY : CCServiceFormat::JSON;
+
+    if (!client.Connect(argv[2]) || !client.Call(request, response)) {
+        std::cerr << "ccservice: no response from " << argv[2] << std::endl;
+        return 1;
+    }
+    fwrite(response.data(), 1, response.size(), stdout);
+    if (request.format == CCServiceFormat::JSON)
+        std::cout << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    sigset_t signals;
+    int sig;
+
+    if (argc < 2)
+        return usage();
+    if (std::string(argv[1]) == "-c")
+        return client(argc, argv);
+
+    // the threads started below inherit the mask, only sigwait sees these
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    CCLog::Initialize(CC_LOGFILE);
+    CCService service(argv[1], (argc > 2) ? atoi(argv[2]) : 0);
+    if (argc > 3)
+        service.setResultCache(std::make_shared<CCResultCache>(argv[3]));
+    if (!service.Start())
+        return 1;
+
+    sigwait(&signals, &sig);
+    CC_INFO("service stopping after jobs:", service.getNumJobs());
+    service.Stop();
+    CCLog::Shutdown();
+    return 0;
+}
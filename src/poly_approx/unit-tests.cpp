@@ -22,20 +22,36 @@
  * Unit-Tests for classes
  */
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <set>
 #include <stack>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <cassert>
+#include <fstream>
+#include <sstream>
 #include <iostream>
 
 #include "CCUUid.hpp"
 #include "CCLogger.hpp"
 #include "CCDataSet.hpp"
 #include "CCImageReader.hpp"
+#include "CCImageWriter.hpp"
 #include "CCImageProcessor.hpp"
 #include "CCDominatingPoints.hpp"
 #include "CCConvexHull.hpp"
 #include "CCErosionFilter.hpp"
+#include "CCCpuFeatures.hpp"
+#include "CCTaskScheduler.hpp"
+#include "CCStagedPipeline.hpp"
+#include "CCFrameSource.hpp"
+#include "CCIncrementalProcessor.hpp"
+#include "CCResultCache.hpp"
+#include "CCService.hpp"
 
 #define MAX_UUIDS 100UL
 
@@ -60,6 +76,9 @@
 
 #define TEST_IMAGE_PNG "images/circles/drawing(10).png"
 
+// written by export_model() in LogRegression-HuMoments.py from hu_moments.csv
+#define HU_MODEL_FILE "../ml/classification/hu_moments_model.csv"
+
 //
 // Logger
 std::mutex CCLog::nanny_;
@@ -72,6 +91,22 @@ CC_LOGLEVEL CCLog::level_ = CC_LOG_DEBUG;
 //
 bool CCConsoleLog::canLog = true;
 
+// black gray-scale image with filled white rectangles
+static CCImageReader MakeGrayImage(int width, int height, const std::vector<CCRect> &rects) {
+    CCImageReader img;
+    unsigned char *data = (unsigned char *) calloc(width * height, 1);
+    for (auto &r : rects)
+        for (int y = r.y; y < r.y + r.height; y++)
+            memset(data + y * width + r.x, 255, r.width);
+    img.setWidth(width);
+    img.setHeight(height);
+    img.setNumChannels(1);
+    img.setColorChannels(CCColorChannels::GRAY);
+    img.setFormat(CCImageSourceType::PNG);
+    img.setDataBlob(data);
+    return img;
+}
+
 int uuid_dup_test(void) {
     std::set<std::string> uuid_strings;
 
@@ -109,6 +144,58 @@ int img_convert_RGB2GRAY_test(void) {
     return 0;
 }
 
+int img_clone_move_test(void) {
+    CCImageReader im(TEST_IMAGE_PNG, CCImageSourceType::PNG, CCColorChannels::RGB);
+    assert(im.Load());
+    CCImageReader im2 = im.clone();
+    assert(im2.getDataBlob() != im.getDataBlob());
+    assert(memcmp(im2.getDataBlob(), im.getDataBlob(),
+                  im.getSize() * im.getNumChannels()) == 0);
+    unsigned char *blob = im2.getDataBlob();
+    CCImageReader im3(std::move(im2));
+    assert(im3.getDataBlob() == blob);
+    assert(im2.getDataBlob() == nullptr);
+    CCImageView view = im3.getView(2, 3, 10, 10);
+    assert(view.getWidth() == 10 && view.getHeight() == 10);
+    assert(view.getStride() == im3.getWidth() * im3.getNumChannels());
+    assert(view.getRow(0) == blob + 3 * view.getStride() + 2 * im3.getNumChannels());
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int img_async_writer_test(void) {
+    bool ok;
+    const int numImages = 6;
+    CCImageReader im(TEST_IMAGE_PNG, CCImageSourceType::PNG, CCColorChannels::RGB);
+    assert(im.Load());
+    CCImageReader imGray = im.ConvertRGB2GRAY(ok);
+    assert(ok);
+    {
+        // single slot queue exercises backpressure
+        CCImageWriter writer(2, 1, CCImageSourceType::PGM);
+        for (int i = 0; i < numImages; i++) {
+            CCImageReader imCopy = imGray.clone();
+            std::string name = "writer_test_" + std::to_string(i) + ".png";
+            imCopy.setFilename(name.c_str());
+            assert(writer.Submit(std::move(imCopy)));
+        }
+        writer.Flush();
+        assert(writer.getNumWritten() == numImages);
+        assert(writer.getNumFailed() == 0);
+    }
+    for (int i = 0; i < numImages; i++) {
+        std::string name = "writer_test_" + std::to_string(i) + ".pgm";
+        CCImageReader imBack(name.c_str(), CCImageSourceType::PGM);
+        assert(imBack.Load());
+        assert(imBack.getWidth() == imGray.getWidth());
+        assert(imBack.getNumChannels() == 1);
+        assert(memcmp(imBack.getDataBlob(), imGray.getDataBlob(), imGray.getSize()) == 0);
+        remove(name.c_str());
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
 int dataset_file_load_test(void) {
     CCDataSet dataSet(TEST_IMAGE_PNG, CCDataSourceType::IMG);
     assert(dataSet.LoadFile());
@@ -131,6 +218,29 @@ int dataset_dir_load_test(void) {
     return 0;
 }
 
+int dataset_dir_parallel_load_test(void) {
+    CCDataSet dataSet(TEST_IMAGE_DIR, CCDataSourceType::IMG);
+    dataSet.setNumThreads(4);
+    assert(dataSet.LoadDirectory());
+    assert(dataSet.getFailedItems().empty());
+    std::string prev;
+    for (auto i : dataSet.dataItems_) {
+        CCImageReader *im = dynamic_cast<CCImageReader*>(i);
+        assert(im->getDataBlob() != nullptr);
+        assert(prev < std::string(im->getFilename()));
+        prev = im->getFilename();
+    }
+    dataSet.Destroy();
+
+    // sub-directories and scripts are reported, not fatal
+    CCDataSet mixedSet("images/", CCDataSourceType::IMG);
+    assert(mixedSet.LoadDirectory());
+    assert(!mixedSet.getFailedItems().empty());
+    mixedSet.Destroy();
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
 int image_processor_test001(void) {
     CCImageProcessor imProcessor;
     CCImageProcessorBuilder imBuilder;
@@ -201,8 +311,1597 @@ int image_processor_test003(int matchValue) {
     return 0;
 }
 
+int image_processor_roi_test(void) {
+    CCImageProcessor imProcessor;
+    CCImageProcessorBuilder imBuilder;
+    CCImageReader imReal(TEST_IMAGE_PNG, CCImageSourceType::PNG, CCColorChannels::RGB), imGray;
+    bool ok;
+
+    assert(imReal.Load());
+    imGray = imReal.ConvertRGB2GRAY(ok);
+    assert(ok);
+    CCImageReader imOrig = imGray.clone();
+    int roiX = 4, roiY = 2, roiW = imGray.getWidth() / 2, roiH = imGray.getHeight() - 4;
+    imProcessor = imBuilder.addGaussianFilter(5, 5, 2.0)
+                           .addSoebelFilter(3, 3, 1)
+                           .addThresholding(60)
+                           .addFeatureExtractor(1)
+                           .addRegionOfInterest(roiX, roiY, roiW, roiH)
+                           .build();
+    imProcessor.Run(imGray);
+    // pixels outside the region are untouched
+    for (int y = 0; y < imGray.getHeight(); y++) {
+        for (int x = 0; x < imGray.getWidth(); x++) {
+            if ((x >= roiX) && (x < roiX + roiW) && (y >= roiY) && (y < roiY + roiH))
+                continue;
+            int index = y * imGray.getWidth() + x;
+            assert(imGray.getDataBlob()[index] == imOrig.getDataBlob()[index]);
+        }
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int image_pyramid_test(void) {
+    CCImagePyramid pyramid;
+    CCImageReader img = MakeGrayImage(101, 64, {CCRect{0, 0, 101, 64}});
+    assert(pyramid.Build(img.getView(), 4));
+    assert(pyramid.getNumLevels() == 4);
+    assert(pyramid.getLevel(1).getWidth() == 51 && pyramid.getLevel(1).getHeight() == 32);
+    assert(pyramid.getLevel(3).getWidth() == 13 && pyramid.getLevel(3).getHeight() == 8);
+    // binomial kernel is normalized, a flat image stays flat
+    const CCImageView &top = pyramid.getLevel(3);
+    for (int y = 0; y < top.getHeight(); y++)
+        for (int x = 0; x < top.getWidth(); x++)
+            assert(top.getRow(y)[x] == 255);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int image_processor_coarse_to_fine_test(void) {
+    CCImageProcessor imProcessor;
+    CCImageProcessorBuilder imBuilder;
+    CCRect a{10, 12, 20, 20}, b{80, 70, 24, 30};
+    CCImageReader img = MakeGrayImage(128, 128, {a, b});
+
+    imProcessor = imBuilder.addGaussianFilter(5, 5, 2.0)
+                           .addSoebelFilter(3, 3, 1)
+                           .addThresholding(60)
+                           .addFeatureExtractor(1)
+                           .addPyramid(3, 6)
+                           .build();
+    imProcessor.Run(img);
+    auto regions = imProcessor.getCandidateRegions();
+    assert(regions.size() == 2);
+    // each candidate encloses exactly one of the squares
+    for (auto &r : regions) {
+        auto encloses = [&r](const CCRect &q) {
+            return (r.x <= q.x) && (r.y <= q.y) && (r.x + r.width >= q.x + q.width) &&
+                   (r.y + r.height >= q.y + q.height);
+        };
+        assert(encloses(a) != encloses(b));
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int sobel_filter_test(void) {
+    Prng<int> prng;
+    const int width = 45, height = 23;
+    CCImageReader img = MakeGrayImage(width, height, {});
+    for (int i = 0; i < width * height; i++)
+        img.getDataBlob()[i] = prng.next_random() % 256;
+
+    for (auto norm : {CCSobelNorm::L2, CCSobelNorm::L1}) {
+        CCImageReader out = img.clone();
+        CCSoebelFilter sobel(3, 3, 1.0, norm);
+        std::vector<uint16_t> mag(width * height);
+        std::vector<uint8_t> dir(width * height);
+        sobel.Gradient(img.getView(), mag.data(), dir.data());
+        sobel.Run(out.getView());
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int ref = 0;
+                if ((x > 0) && (y > 0) && (x < width - 1) && (y < height - 1)) {
+                    auto p = [&img, width](int xx, int yy) {
+                        return (int) img.getDataBlob()[yy * width + xx];
+                    };
+                    int gx = p(x+1, y-1) - p(x-1, y-1) + 2 * (p(x+1, y) - p(x-1, y)) +
+                             p(x+1, y+1) - p(x-1, y+1);
+                    int gy = p(x-1, y+1) - p(x-1, y-1) + 2 * (p(x, y+1) - p(x, y-1)) +
+                             p(x+1, y+1) - p(x+1, y-1);
+                    ref = (norm == CCSobelNorm::L1) ? std::abs(gx) + std::abs(gy) :
+                          (int) sqrtf(gx * gx + gy * gy);
+                }
+                assert(mag[y * width + x] == ref);
+                assert(out.getDataBlob()[y * width + x] == std::min(ref, 255));
+            }
+        }
+    }
+
+    // vertical step edge: horizontal gradient
+    CCImageReader step = MakeGrayImage(20, 10, {CCRect{10, 0, 10, 10}});
+    CCSoebelFilter sobel;
+    std::vector<uint16_t> mag(200);
+    std::vector<uint8_t> dir(200);
+    sobel.Gradient(step.getView(), mag.data(), dir.data());
+    assert(mag[5 * 20 + 10] > 0 && dir[5 * 20 + 10] == SOBEL_DIR_0);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int canny_filter_test(void) {
+    CCRect square{12, 10, 30, 24};
+    CCImageReader img = MakeGrayImage(64, 48, {square});
+    CCImageReader thick = img.clone();
+    CCCannyFilter canny(40, 100);
+    CCSoebelFilter sobel;
+    CCThresholding thresh(60);
+    int numCanny = 0, numThick = 0;
+
+    canny.Run(img.getView());
+    sobel.Run(thick.getView());
+    thresh.Run(thick.getView());
+    for (int i = 0; i < img.getSize(); i++) {
+        assert((img.getDataBlob()[i] == 0) || (img.getDataBlob()[i] == 255));
+        numCanny += img.getDataBlob()[i] ? 1 : 0;
+        numThick += thick.getDataBlob()[i] ? 1 : 0;
+    }
+    // one pixel wide closed outline of the square
+    int perimeter = 2 * (square.width + square.height);
+    assert(numCanny >= perimeter - 8 && numCanny <= perimeter + 8);
+    assert(numCanny < numThick);
+    for (int y = square.y + 2; y < square.y + square.height - 2; y++) {
+        int numRow = 0;
+        for (int x = 0; x < img.getWidth(); x++)
+            numRow += img.getDataBlob()[y * img.getWidth() + x] ? 1 : 0;
+        assert(numRow == 2);
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int recursive_gaussian_test(void) {
+    const int width = 61, height = 47;
+    const float sigma = 3.0;
+    CCImageReader img = MakeGrayImage(width, height, {CCRect{20, 15, 20, 17}});
+    CCGaussianFilter gauss(0, 0, sigma, CCGaussianMode::RECURSIVE);
+    std::vector<float> ref(width * height, 0), tmp(width * height, 0);
+    int radius = 4 * sigma;
+
+    // reference: normalized sampled kernel, replicated borders
+    std::vector<float> kernel(2 * radius + 1);
+    float sum = 0;
+    for (int i = -radius; i <= radius; i++)
+        sum += kernel[i + radius] = expf(-(i * i) / (2 * sigma * sigma));
+    for (auto &k : kernel)
+        k /= sum;
+    auto clampi = [](int v, int n) { return std::min(std::max(v, 0), n - 1); };
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            for (int i = -radius; i <= radius; i++)
+                tmp[y * width + x] += kernel[i + radius] *
+                    img.getDataBlob()[y * width + clampi(x + i, width)];
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            for (int i = -radius; i <= radius; i++)
+                ref[y * width + x] += kernel[i + radius] * tmp[clampi(y + i, height) * width + x];
+
+    // the IIR approximation stays within 3% of the sampled kernel
+    gauss.Run(img.getView());
+    for (int i = 0; i < width * height; i++)
+        assert(std::abs(img.getDataBlob()[i] - ref[i]) <= 8.0f);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int fixed_point_gaussian_test(void) {
+    Prng<int> prng;
+    const int width = 53, height = 29;
+    CCImageReader img = MakeGrayImage(width, height, {});
+    for (int i = 0; i < width * height; i++)
+        img.getDataBlob()[i] = prng.next_random() % 256;
+
+    // square and non-square kernels, the columns take the dimY taps
+    const std::pair<int, int> dims[] = {{3, 3}, {5, 5}, {7, 7}, {3, 7}, {7, 3}};
+    for (auto dim : dims) {
+        for (float sigma : {0.6f, 1.0f, 2.0f}) {
+            CCImageReader imFloat = img.clone(), imFixed = img.clone();
+            CCGaussianFilter gFloat(dim.first, dim.second, sigma, CCGaussianMode::KERNEL);
+            CCGaussianFilter gFixed(dim.first, dim.second, sigma, CCGaussianMode::FIXED_POINT);
+            gFloat.Run(imFloat.getView());
+            gFixed.Run(imFixed.getView());
+            for (int i = 0; i < width * height; i++)
+                assert(std::abs(imFloat.getDataBlob()[i] - imFixed.getDataBlob()[i]) <= 2);
+        }
+    }
+
+    // an impulse spreads over the seven rows centred on it
+    CCImageReader dot = MakeGrayImage(16, 16, {CCRect{8, 8, 1, 1}});
+    CCGaussianFilter gTall(3, 7, 2.0f, CCGaussianMode::FIXED_POINT);
+    gTall.Run(dot.getView());
+    for (int y = 0; y < 16; y++)
+        assert((dot.getDataBlob()[y * 16 + 8] != 0) == ((y >= 5) && (y <= 11)));
+    assert(dot.getDataBlob()[8 * 16 + 8] > dot.getDataBlob()[7 * 16 + 8]);
+    assert(dot.getDataBlob()[7 * 16 + 8] == dot.getDataBlob()[9 * 16 + 8]);
+
+    // kernels summing above one saturate instead of wrapping
+    CCImageReader white = MakeGrayImage(16, 16, {CCRect{0, 0, 16, 16}});
+    CCGaussianFilter gSharp(3, 3, 0.3f, CCGaussianMode::FIXED_POINT);
+    gSharp.Run(white.getView());
+    assert(white.getDataBlob()[8 * 16 + 8] >= 250);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int convolution_engine_test(void) {
+    Prng<int> prng;
+    const int width = 37, height = 23;
+    CCImageReader img = MakeGrayImage(width, height, {});
+    for (int i = 0; i < width * height; i++)
+        img.getDataBlob()[i] = prng.next_random() % 256;
+
+    // direct 2D correlation over mapped border samples
+    auto reference = [&](const std::vector<float> &k, int kw, int kh, CCBorderMode mode) {
+        std::vector<uint8_t> out(width * height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float acc = 0;
+                for (int j = 0; j < kh; j++) {
+                    for (int i = 0; i < kw; i++) {
+                        int sx = BorderIndex(x + i - kw / 2, width, mode);
+                        int sy = BorderIndex(y + j - kh / 2, height, mode);
+                        if ((sx >= 0) && (sy >= 0))
+                            acc += k[j * kw + i] * img.getDataBlob()[sy * width + sx];
+                    }
+                }
+                out[y * width + x] = std::min(std::max(acc, 0.0f), 255.0f) + 0.5f;
+            }
+        }
+        return out;
+    };
+
+    std::vector<float> box(5 * 3, 1.0f / 15);
+    std::vector<float> sep {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    for (auto &k : sep)
+        k /= 16;
+    std::vector<float> laplace {0, -1, 0, -1, 4, -1, 0, -1, 0};
+    std::vector<float> tall(7, 1.0f / 8);
+    tall[3] = 2.0f / 8;
+
+    struct Case {
+        std::vector<float> &k;
+        int kw, kh;
+        CCConvolutionBackend backend;
+    } cases[] = {
+        {box, 5, 3, CCConvolutionBackend::RUNNING_SUM},
+        {sep, 3, 3, CCConvolutionBackend::SEPARABLE},
+        {laplace, 3, 3, CCConvolutionBackend::DIRECT},
+        {tall, 1, 7, CCConvolutionBackend::SEPARABLE},
+    };
+
+    for (auto &c : cases) {
+        for (auto mode : {CCBorderMode::ZERO, CCBorderMode::REPLICATE, CCBorderMode::REFLECT}) {
+            CCConvolutionEngine engine(c.k, c.kw, c.kh, mode);
+            assert(engine.getBackend() == c.backend);
+            std::vector<uint8_t> ref = reference(c.k, c.kw, c.kh, mode);
+            // every backend agrees with the direct sum
+            for (auto b : {c.backend, CCConvolutionBackend::DIRECT}) {
+                CCImageReader out = img.clone();
+                assert(engine.setBackend(b));
+                engine.Run(out.getView());
+                for (int i = 0; i < width * height; i++)
+                    assert(std::abs(out.getDataBlob()[i] - ref[i]) <= 1);
+            }
+        }
+    }
+
+    // backends the kernel does not allow are rejected
+    CCConvolutionEngine engine(laplace, 3, 3);
+    assert(!engine.isSeparable() && !engine.isBox());
+    assert(!engine.setBackend(CCConvolutionBackend::SEPARABLE));
+    assert(!engine.setKernel(laplace, 3, 2));
+
+    // the Gaussian KERNEL mode is bit exact with its former float loops: a
+    // zero padded row pass, then a column pass truncated to 8 bits
+    CCImageReader blurred = img.clone();
+    CCGaussianFilter gauss(5, 5, 2.0f);
+    gauss.Run(blurred.getView());
+    std::vector<float> rows(width * height);
+    float *taps = CreateGaussianKernel(5, 2.0f);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float acc = 0;
+            for (int j = 0, k = x - 2; j < 5; j++, k++)
+                if ((k >= 0) && (k < width))
+                    acc += taps[j] * float(img.getDataBlob()[y * width + k]);
+            rows[y * width + x] = acc;
+        }
+    }
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            float acc = 0;
+            for (int j = 0, k = y - 2; j < 5; j++, k++)
+                if ((k >= 0) && (k < height))
+                    acc += taps[j] * rows[k * width + x];
+            assert(blurred.getDataBlob()[y * width + x] ==
+                   static_cast<uint8_t>(std::min(std::max(acc, 0.0f), 255.0f)));
+        }
+    }
+    delete[] taps;
+
+    // a box filter on a region leaves the rest of the image alone
+    CCImageReader flat = MakeGrayImage(20, 20, {CCRect{0, 0, 10, 20}});
+    CCBoxFilter boxFilter(3, 3);
+    boxFilter.Run(flat.getView(5, 5, 10, 10));
+    assert(flat.getDataBlob()[5 * 20 + 9] == 170);
+    assert(flat.getDataBlob()[5 * 20 + 10] == 85);
+    assert(flat.getDataBlob()[4 * 20 + 9] == 255);
+
+    // the median removes isolated impulses and keeps edges
+    CCImageReader noisy = MakeGrayImage(16, 16, {CCRect{0, 0, 8, 16}});
+    noisy.getDataBlob()[3 * 16 + 3] = 0;
+    noisy.getDataBlob()[10 * 16 + 12] = 255;
+    CCMedianFilter median(3, 3);
+    median.Run(noisy.getView());
+    for (int y = 0; y < 16; y++)
+        for (int x = 0; x < 16; x++)
+            assert(noisy.getDataBlob()[y * 16 + x] == ((x < 8) ? 255 : 0));
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int median_filter_test(void) {
+    Prng<int> prng;
+    const int width = 41, height = 19;
+
+    for (int nc : {1, 3}) {
+        std::vector<uint8_t> src(width * height * nc);
+        for (auto &v : src) {
+            // salt and pepper over a smooth ramp
+            int r = prng.next_random() % 16;
+            v = (r == 0) ? 0 : (r == 1) ? 255 : (&v - &src[0]) % 200;
+        }
+
+        for (auto dims : {std::make_pair(3, 3), std::make_pair(5, 5),
+                          std::make_pair(3, 7), std::make_pair(9, 1)}) {
+            int kw = dims.first, kh = dims.second;
+            for (auto mode : {CCBorderMode::ZERO, CCBorderMode::REPLICATE,
+                              CCBorderMode::REFLECT}) {
+                std::vector<uint8_t> dst(src);
+                CCImageView view(dst.data(), width, height, width * nc, nc);
+                CCMedianFilter median(kw, kh, mode);
+                median.Run(view);
+
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) {
+                        for (int c = 0; c < nc; c++) {
+                            std::vector<uint8_t> w;
+                            for (int j = -kh / 2; j <= kh / 2; j++) {
+                                for (int i = -kw / 2; i <= kw / 2; i++) {
+                                    int sx = BorderIndex(x + i, width, mode);
+                                    int sy = BorderIndex(y + j, height, mode);
+                                    w.push_back(((sx < 0) || (sy < 0)) ? 0 :
+                                                src[(sy * width + sx) * nc + c]);
+                                }
+                            }
+                            std::nth_element(w.begin(), w.begin() + w.size() / 2, w.end());
+                            assert(dst[(y * width + x) * nc + c] == w[w.size() / 2]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // as a pipeline stage the median runs ahead of thresholding
+    CCImageReader img = MakeGrayImage(32, 32, {CCRect{8, 8, 16, 16}});
+    for (int i = 0; i < 32 * 32; i += 37)
+        img.getDataBlob()[i] = 255 - img.getDataBlob()[i];
+    CCImageProcessorBuilder builder;
+    CCImageProcessor proc = builder.addMedianFilter(3, 3).addThresholding(128).build();
+    proc.Run(img);
+    for (int y = 0; y < 32; y++)
+        for (int x = 0; x < 32; x++)
+            // a 3x3 median clips the square's corner pixels
+            if (((x != 8) && (x != 23)) || ((y != 8) && (y != 23)))
+                assert(img.getDataBlob()[y * 32 + x] ==
+                       (((x >= 8) && (x < 24) && (y >= 8) && (y < 24)) ? 255 : 0));
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int specialized_kernels_test(void) {
+    Prng<int> prng;
+    const int width = 45, height = 31;
+    CCImageReader img = MakeGrayImage(width, height, {});
+    for (int i = 0; i < width * height; i++)
+        img.getDataBlob()[i] = prng.next_random() % 256;
+
+    for (int dim : {3, 5, 7, 9, 11}) {
+        std::unique_ptr<CCGaussianFilter> fixed(
+            CreateGaussianFilter(dim, dim, 1.5f, CCGaussianMode::FIXED_POINT));
+        CCGaussianFilter generic(dim, dim, 1.5f, CCGaussianMode::FIXED_POINT);
+        bool specialized = dynamic_cast<CCGaussianFilterN<5>*>(fixed.get()) ||
+                           dynamic_cast<CCGaussianFilterN<3>*>(fixed.get()) ||
+                           dynamic_cast<CCGaussianFilterN<7>*>(fixed.get()) ||
+                           dynamic_cast<CCGaussianFilterN<9>*>(fixed.get());
+        assert(specialized == (dim <= 9));
+
+        // unrolled and runtime loops are bit exact
+        CCImageReader a = img.clone(), b = img.clone();
+        fixed->Run(a.getView());
+        generic.Run(b.getView());
+        assert(memcmp(a.getDataBlob(), b.getDataBlob(), width * height) == 0);
+    }
+
+    for (auto dims : {std::make_pair(3, 3), std::make_pair(5, 5), std::make_pair(7, 7),
+                      std::make_pair(9, 9), std::make_pair(3, 5)}) {
+        int m = dims.first, n = dims.second;
+        const int thresh = 40;
+        std::unique_ptr<CCErosionFilter> erosion(CreateErosionFilter(m, n, thresh));
+        CCImageReader out = img.clone();
+        erosion->Run(out.getView());
+
+        // window fully inside and every pixel at or above the threshold
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                bool set = (y - m / 2 >= 0) && (y + m / 2 < height) &&
+                           (x - n / 2 >= 0) && (x + n / 2 < width);
+                for (int i = y - m / 2; set && i <= y + m / 2; i++)
+                    for (int j = x - n / 2; set && j <= x + n / 2; j++)
+                        set = img.getDataBlob()[i * width + j] >= thresh;
+                assert(out.getDataBlob()[y * width + x] == (set ? 255 : 0));
+            }
+        }
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int cpu_dispatch_test(void) {
+    Prng<int> prng;
+    const int width = 157, height = 23;
+    CCImageReader rgb = MakeGrayImage(width, 3 * height, {});
+    for (int i = 0; i < width * height * 3; i++)
+        rgb.getDataBlob()[i] = prng.next_random() % 256;
+    // reinterpret the random bytes as an RGB image of width x height
+    rgb.setHeight(height);
+    rgb.setNumChannels(3);
+    rgb.setColorChannels(CCColorChannels::RGB);
+
+    // every stage that goes through the kernel table, in one image
+    auto runAll = [&](void) {
+        bool ok;
+        std::vector<uint8_t> out;
+        CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+        assert(ok);
+        out.insert(out.end(), gray.getDataBlob(), gray.getDataBlob() + width * height);
+        for (int dim : {3, 7, 11}) {
+            CCImageReader g = gray.clone();
+            std::unique_ptr<CCGaussianFilter> gauss(
+                CreateGaussianFilter(dim, dim, 1.2f, CCGaussianMode::FIXED_POINT));
+            gauss->Run(g.getView());
+            out.insert(out.end(), g.getDataBlob(), g.getDataBlob() + width * height);
+        }
+        for (auto norm : {CCSobelNorm::L1, CCSobelNorm::L2}) {
+            CCImageReader g = gray.clone();
+            CCSoebelFilter sobel(3, 3, 1, norm);
+            sobel.Run(g.getView());
+            out.insert(out.end(), g.getDataBlob(), g.getDataBlob() + width * height);
+        }
+        for (int m : {3, 4, 5}) {
+            CCImageReader g = gray.clone();
+            std::unique_ptr<CCErosionFilter> erosion(CreateErosionFilter(m | 1, m, 60));
+            erosion->Run(g.getView());
+            out.insert(out.end(), g.getDataBlob(), g.getDataBlob() + width * height);
+        }
+        CCImageReader g = gray.clone();
+        CCThresholding thresh(100);
+        thresh.Run(g.getView());
+        out.insert(out.end(), g.getDataBlob(), g.getDataBlob() + width * height);
+        for (int y = 0; y < height; y++) {
+            uint32_t sad = GetPixelKernels().sad(gray.getDataBlob() + y * width,
+                                                 g.getDataBlob() + y * width, width);
+            out.insert(out.end(), (const uint8_t *)&sad, (const uint8_t *)&sad + sizeof(sad));
+        }
+        return out;
+    };
+
+    CCCpuIsa detected = CCCpuFeatures::getDetectedIsa();
+    assert(CCCpuFeatures::setForcedIsa(CCCpuIsa::BASELINE) == CCCpuIsa::BASELINE);
+    assert(GetPixelKernels().isa == CCCpuIsa::BASELINE);
+    std::vector<uint8_t> ref = runAll();
+
+    // the (r + g + b) / 3 truncation of the original conversion
+    for (int i = 0; i < width * height; i++) {
+        const uint8_t *p = rgb.getDataBlob() + 3 * i;
+        assert(ref[i] == int((p[0] + p[1] + p[2]) / 3.0));
+    }
+
+    // every level the CPU supports gives the same bytes
+    for (int i = 1; i <= static_cast<int>(detected); i++) {
+        CCCpuIsa isa = static_cast<CCCpuIsa>(i);
+        assert(CCCpuFeatures::setForcedIsa(isa) == isa);
+        assert(GetPixelKernels().isa == isa);
+        assert(runAll() == ref);
+    }
+
+    // a level above the detected one is clamped
+    assert(CCCpuFeatures::setForcedIsa(CCCpuIsa::AVX512) == detected);
+    CCCpuFeatures::clearForcedIsa();
+    assert(CCCpuFeatures::getIsa() == detected);
+
+    CCCpuIsa parsed;
+    assert(CCCpuFeatures::parseIsaName("avx2", parsed) && (parsed == CCCpuIsa::AVX2));
+    assert(!CCCpuFeatures::parseIsaName("neon", parsed));
+    std::cout << __func__ << ":" << CCCpuFeatures::getIsaName(detected) << ":" << "pass" << std::endl;
+    return 0;
+}
+
+int distance_transform_test(void) {
+    Prng<int> prng;
+    const int width = 40, height = 27;
+    CCImageReader img = MakeGrayImage(width, height, {CCRect{0, 0, width, height}});
+    std::vector<std::pair<int, int>> background;
+    for (int i = 0; i < 12; i++) {
+        int x = prng.next_random() % width, y = prng.next_random() % height;
+        img.getDataBlob()[y * width + x] = 0;
+        background.push_back(std::make_pair(x, y));
+    }
+
+    CCDistanceTransform dt;
+    dt.Run(img.getView());
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int best = width * width + height * height;
+            for (auto &b : background)
+                best = std::min(best, (x - b.first) * (x - b.first) + (y - b.second) * (y - b.second));
+            assert(std::abs(dt.getDistance()[y * width + x] - sqrtf(best)) < 1e-3f);
+        }
+    }
+
+    // no background at all
+    CCImageReader full = MakeGrayImage(8, 8, {CCRect{0, 0, 8, 8}});
+    dt.Run(full.getView());
+    assert(dt.getDistance()[27] == CC_EDT_INF);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+// filled discs, overlapping ones touch through a neck
+static CCImageReader MakeDiscImage(int width, int height, const std::vector<CCRect> &discs) {
+    CCImageReader img = MakeGrayImage(width, height, {});
+    for (auto &d : discs)
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                if ((x - d.x) * (x - d.x) + (y - d.y) * (y - d.y) <= d.width * d.width)
+                    img.getDataBlob()[y * width + x] = 255;
+    return img;
+}
+
+int watershed_split_test(void) {
+    // disc centers and radii in x, y and width
+    std::vector<CCRect> discs {{14, 16, 9, 0}, {30, 16, 9, 0}, {50, 40, 7, 0}};
+    CCImageReader img = MakeDiscImage(64, 56, discs);
+    CCConnectedComponents cc;
+    assert(cc.Run(img.getView()) == 2);
+
+    CCWatershed watershed(2.0f, 3);
+    assert(watershed.Run(img.getView()) == 3);
+    assert(cc.Run(img.getView()) == 3);
+    // each region holds the center of its disc
+    for (auto &d : discs)
+        assert(watershed.getLabels()[d.y * 64 + d.x] > 0);
+    assert(watershed.getLabels()[16 * 64 + 14] != watershed.getLabels()[16 * 64 + 30]);
+
+    // as a pipeline stage, the tracer sees one component per disc
+    for (bool split : {false, true}) {
+        CCImageReader im = MakeDiscImage(64, 56, discs);
+        CCImageProcessorBuilder builder;
+        builder.addThresholding(128);
+        if (split)
+            builder.addWatershedSplit(2.0f, 3);
+        CCImageProcessor proc = builder.build();
+        proc.Run(im);
+        assert(cc.Run(im.getView()) == (split ? 3 : 2));
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int moments_test(void) {
+    Prng<int> prng;
+    const int width = 37, height = 23, numLabels = 5;
+    std::vector<int> labels(width * height);
+    for (auto &l : labels)
+        l = prng.next_random() % (numLabels + 1);
+
+    CCMoments moments;
+    assert(moments.Run(labels, width, height, numLabels) == numLabels);
+    assert(moments.getFeatures().size() == numLabels * CC_NUM_MOMENTS);
+
+    // brute force raw and central moments, orders 0..3
+    const int orders[][2] {{0, 0}, {1, 0}, {0, 1}, {2, 0}, {1, 1}, {0, 2}, {3, 0}, {2, 1}, {1, 2}, {0, 3}};
+    for (int l = 1; l <= numLabels; l++) {
+        const float *row = moments.getRow(l - 1);
+        double xc = row[MOM_M10] / row[MOM_M00], yc = row[MOM_M01] / row[MOM_M00];
+        for (int k = 0; k < CC_NUM_RAW_MOMENTS; k++) {
+            double raw = 0, central = 0;
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++)
+                    if (labels[y * width + x] == l) {
+                        raw += pow(x, orders[k][0]) * pow(y, orders[k][1]);
+                        central += pow(x - xc, orders[k][0]) * pow(y - yc, orders[k][1]);
+                    }
+            assert(std::fabs(row[k] - raw) <= 1e-5 * std::fabs(raw) + 1e-3);
+            if (k >= MOM_M20)
+                assert(std::fabs(row[MOM_MU20 + k - MOM_M20] - central) <= 1e-3 * std::fabs(raw) + 1e-2);
+        }
+    }
+
+    // Hu moments do not change under translation, a 90 degree turn and scale
+    CCImageReader img = MakeGrayImage(96, 64, {CCRect{3, 4, 10, 20}, CCRect{40, 30, 20, 10}, CCRect{70, 2, 20, 40}});
+    assert(moments.Run(img.getView()) == 3);
+    // labels follow the scan order, the scaled rectangle comes first
+    for (int i = MOM_HU1; i < CC_NUM_MOMENTS; i++) {
+        assert(std::fabs(moments.getRow(1)[i] - moments.getRow(2)[i]) < 1e-6);
+        assert(std::fabs(moments.getRow(1)[i] - moments.getRow(0)[i]) < 1e-2 * moments.getRow(1)[MOM_HU1]);
+    }
+    // a disc is close to 1 / (2 pi) with the other invariants near zero
+    CCImageReader disc = MakeDiscImage(64, 64, {CCRect{32, 30, 20, 0}});
+    assert(moments.Run(disc.getView()) == 1);
+    assert(std::fabs(moments.getRow(0)[MOM_HU1] - 1 / (2 * M_PI)) < 1e-3);
+    assert(moments.getRow(0)[MOM_HU2] < 1e-6);
+    float logHu[CC_NUM_HU_MOMENTS];
+    CCMoments::LogScaleHu(moments.getRow(0) + MOM_HU1, logHu);
+    assert(std::fabs(logHu[0] + log10(moments.getRow(0)[MOM_HU1])) < 1e-5);
+
+    // as a pipeline stage, one row per blob of the thresholded image
+    CCImageReader im = MakeGrayImage(64, 48, {CCRect{2, 2, 10, 10}, CCRect{30, 20, 12, 8}});
+    CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(128).addMoments().build();
+    proc.Run(im);
+    assert(proc.getMoments()->getNumRows() == 2);
+    assert(proc.getMoments()->getRow(1)[MOM_M00] == 96);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int feature_classifier_test(void) {
+    Prng<int> prng;
+    const int numFeatures = 5, rows = 9;
+    std::vector<float> weights(3 * numFeatures), x(rows * 8);
+    for (auto &w : weights)
+        w = (prng.next_random() % 200 - 100) / 50.0f;
+    for (auto &v : x)
+        v = (prng.next_random() % 200 - 100) / 100.0f;
+
+    CCFeatureClassifier model;
+    assert(!model.setModel({1, 2, 3}, {0.5f, -0.25f}, weights, numFeatures));
+    assert(model.setModel({1, 2, 3}, {0.5f, -0.25f, 0.0f}, weights, numFeatures));
+
+    // batched scores against the scalar sigmoid, rows are 8 floats apart
+    std::vector<float> scores(rows * 3);
+    std::vector<int> predicted(rows);
+    model.Score(x.data(), rows, 8, scores.data());
+    model.Predict(x.data(), rows, 8, predicted.data());
+    for (int r = 0; r < rows; r++) {
+        int best = 0;
+        for (int c = 0; c < 3; c++) {
+            float z = (c == 0) ? 0.5f : ((c == 1) ? -0.25f : 0.0f);
+            for (int i = 0; i < numFeatures; i++)
+                z += weights[c * numFeatures + i] * x[r * 8 + i];
+            assert(std::fabs(scores[r * 3 + c] - 1.0f / (1.0f + expf(-z))) < 1e-5f);
+            if (scores[r * 3 + c] > scores[r * 3 + best])
+                best = c;
+        }
+        assert(predicted[r] == best + 1);
+    }
+
+    // CSV and binary files load the same model
+    const char *csv = "feature_model_test.csv", *bin = "feature_model_test.bin";
+    {
+        std::ofstream out(csv);
+        out << "# label,bias,w1..w7 over log-scaled Hu moments" << std::endl;
+        out << "1,78.8,-100,0,0,0,0,0,0" << std::endl;
+        out << "2,-78.8,100,0,0,0,0,0,0" << std::endl;
+    }
+    CCFeatureClassifier loaded, reloaded;
+    assert(loaded.Load(csv) && (loaded.getNumClasses() == 2) && (loaded.getNumFeatures() == 7));
+    assert(loaded.SaveBinary(bin) && reloaded.Load(bin));
+    assert(reloaded.getLabels() == loaded.getLabels());
+    assert(!reloaded.Load("does_not_exist.csv"));
+
+    // a disc and a square told apart by their first Hu moment
+    CCImageReader im = MakeDiscImage(80, 48, {CCRect{20, 22, 14, 0}});
+    for (int y = 10; y < 36; y++)
+        memset(im.getDataBlob() + y * 80 + 45, 255, 26);
+    CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(128).addFeatureClassifier(csv).build();
+    proc.Run(im);
+    assert(proc.getMoments()->getNumRows() == 2);
+    assert(proc.Classify(im, {2, 1}));
+    assert(!proc.Classify(im, {1, 1}));
+
+    // with a pyramid the rows of every candidate region are kept
+    CCImageProcessor coarse = CCImageProcessorBuilder().addPyramid(2, 4)
+                                                       .addThresholding(128)
+                                                       .addFeatureClassifier(csv)
+                                                       .build();
+    coarse.Run(im);
+    assert(coarse.getCandidateRegions().size() == 2);
+    assert(coarse.getMoments()->getNumRows() == 2);
+    assert(coarse.Classify(im, {2, 1}));
+    remove(csv);
+    remove(bin);
+
+    // the trained model on the inverted shape images it was trained on, whose
+    // foreground is every non-zero pixel as with cv2.moments(binaryImage)
+    const char *shapes[] = {"circle", "square", "star", "triangle"};
+    const float circle0[] = {0.7978647f, 4.8613381f, 6.9774662f, 10.048658f};
+    CCFeatureClassifier trained;
+    assert(trained.Load(HU_MODEL_FILE) && (trained.getNumClasses() == 4));
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < 5; i++) {
+            std::string path = std::string("images/shapes/") + shapes[c] + "/" + std::to_string(i) + ".png";
+            CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+            bool ok;
+            assert(rgb.Load());
+            CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+            assert(ok);
+            for (int k = 0; k < gray.getSize(); k++)
+                gray.getDataBlob()[k] = 255 - gray.getDataBlob()[k];
+            CCImageProcessor shape = CCImageProcessorBuilder().addThresholding(1)
+                                                              .addFeatureClassifier(HU_MODEL_FILE)
+                                                              .build();
+            shape.Run(gray);
+            // same scale as the hu_moments.csv row of the sample
+            if ((c == 0) && (i == 0)) {
+                std::vector<float> hu;
+                shape.getMoments()->getLogHu(hu);
+                for (int k = 0; k < 4; k++)
+                    assert(std::fabs(hu[k] - circle0[k]) < 1e-4f);
+            }
+            assert(shape.Classify(gray, {c + 1}));
+        }
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int cnn_inference_test(void) {
+    Prng<int> prng;
+    auto random = [&prng](std::vector<float> &v) {
+        for (auto &x : v)
+            x = (prng.next_random() % 200 - 100) / 100.0f;
+    };
+
+    // im2col convolution against the direct sum, same and valid padding
+    for (bool same : {true, false}) {
+        const CCTensorShape in {2, 7, 9};
+        CCNeuralNetwork net;
+        net.addConv2D(2, 3, 3, same);
+        random(net.getLayer(0).getParameters());
+        assert(net.Compile(in, 1));
+        const CCTensorShape out = net.getOutputShape();
+        assert(out == (same ? CCTensorShape{3, 7, 9} : CCTensorShape{3, 5, 7}));
+
+        std::vector<float> x(in.size()), y(out.size());
+        random(x);
+        assert(net.Run(x.data(), 1, y.data()));
+        const float *w = net.getLayer(0).getParameters().data();
+        const int pad = same ? 1 : 0;
+        for (int f = 0; f < 3; f++)
+            for (int oy = 0; oy < out.height; oy++)
+                for (int ox = 0; ox < out.width; ox++) {
+                    float sum = w[3 * 2 * 9 + f];
+                    for (int c = 0; c < 2; c++)
+                        for (int i = 0; i < 3; i++)
+                            for (int j = 0; j < 3; j++) {
+                                int sy = oy + i - pad, sx = ox + j - pad;
+                                if ((sy >= 0) && (sy < in.height) && (sx >= 0) && (sx < in.width))
+                                    sum += w[((f * 2 + c) * 3 + i) * 3 + j] * x[(c * in.height + sy) * in.width + sx];
+                            }
+                    assert(std::fabs(y[(f * out.height + oy) * out.width + ox] - sum) < 1e-4f);
+                }
+    }
+
+    // conv1d stack as in cnn1d.py, batches larger than the arena run in chunks
+    const int batch = 5;
+    CCNeuralNetwork net;
+    net.addConv1D(4, 6, 3, false).addReLU().addGlobalMaxPool().addDense(6, 3).addSoftmax();
+    for (int l = 0; l < net.getNumLayers(); l++)
+        random(net.getLayer(l).getParameters());
+    assert(!net.Compile(CCTensorShape{3, 1, 12}, 2));
+    assert(net.Compile(CCTensorShape{4, 1, 12}, 2));
+    std::vector<float> x(batch * 48), y(batch * 3), one(3);
+    random(x);
+    assert(net.Run(x.data(), batch, y.data()));
+    for (int s = 0; s < batch; s++) {
+        assert(net.Run(&x[s * 48], 1, one.data()));
+        assert(std::fabs(one[0] + one[1] + one[2] - 1.0f) < 1e-5f);
+        for (int c = 0; c < 3; c++)
+            assert(one[c] == y[s * 3 + c]);
+    }
+
+    // weights round trip through a raw float file
+    const char *weights = "cnn_weights_test.bin";
+    {
+        std::ofstream out(weights, std::ios::binary);
+        for (int l = 0; l < net.getNumLayers(); l++) {
+            auto &p = net.getLayer(l).getParameters();
+            out.write(reinterpret_cast<const char *>(p.data()), p.size() * sizeof(float));
+        }
+    }
+    CCNeuralNetwork copy;
+    copy.addConv1D(4, 6, 3, false).addReLU().addGlobalMaxPool().addDense(6, 3).addSoftmax();
+    assert(copy.LoadWeights(weights) && copy.Compile(CCTensorShape{4, 1, 12}, batch));
+    std::vector<float> z(batch * 3);
+    assert(copy.Run(x.data(), batch, z.data()) && (z == y));
+    CCNeuralNetwork small;
+    small.addDense(6, 3);
+    assert(!small.LoadWeights(weights));
+    remove(weights);
+
+    // component crops: a square fills the corner of its crop, a disc does not
+    auto pNet = std::make_shared<CCNeuralNetwork>();
+    pNet->addDense(16 * 16, 2).addSoftmax();
+    std::vector<float> &p = pNet->getLayer(0).getParameters();
+    p[256] = 10.0f;
+    p[2 * 256 + 1] = -5.0f;
+    assert(pNet->Compile(CCTensorShape{1, 16, 16}, 4));
+    CCImageReader im = MakeDiscImage(80, 48, {CCRect{20, 22, 14, 0}});
+    for (int y = 10; y < 36; y++)
+        memset(im.getDataBlob() + y * 80 + 45, 255, 26);
+    CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(128).addCnnClassifier(pNet, {1, 2}).build();
+
+    // networks that are not compiled are refused rather than run
+    auto pRaw = std::make_shared<CCNeuralNetwork>();
+    pRaw->addDense(16 * 16, 2).addSoftmax();
+    assert(!pRaw->isCompiled() && pNet->isCompiled());
+    CCCnnClassifier raw(pRaw, {1, 2});
+    assert((raw.Run(im.getView()) == 0) && raw.getLabels().empty());
+    CCImageProcessor refused = CCImageProcessorBuilder().addThresholding(128).addCnnClassifier(pRaw, {1, 2}).build();
+    assert(refused.getConfigHash() == CCImageProcessorBuilder().addThresholding(128).build().getConfigHash());
+
+    // the config follows the weights up to build(), the geometry and the input shape
+    auto describe = [](std::shared_ptr<CCNeuralNetwork> pNetwork) {
+        return CCImageProcessorBuilder().addCnnClassifier(pNetwork, {1, 2}).build().getConfigHash();
+    };
+    auto makePooled = [](int pool, int size) {
+        auto pNetwork = std::make_shared<CCNeuralNetwork>();
+        pNetwork->addMaxPool(pool, pool).addDense((size / pool) * (size / pool), 2).addSoftmax();
+        assert(pNetwork->Compile(CCTensorShape{1, size, size}, 1));
+        return pNetwork;
+    };
+    CCImageProcessorBuilder later;
+    later.addCnnClassifier(pNet, {1, 2});
+    const uint64_t before = later.build().getConfigHash();
+    p[0] += 1.0f;
+    assert(later.build().getConfigHash() != before);
+    p[0] -= 1.0f;
+    assert(later.build().getConfigHash() == before);
+    assert(describe(makePooled(2, 16)) != describe(makePooled(4, 32)));
+    assert(describe(makePooled(2, 16)) != describe(makePooled(2, 17)));
+    assert(describe(makePooled(2, 16)) == describe(makePooled(2, 16)));
+    assert(CCImageProcessorBuilder().addThresholding(128).getConfig() == "threshold=(128);");
+    assert(CCImageProcessorBuilder().addGaussianFilter(3, 3, 0.1).build().getConfigHash() !=
+           CCImageProcessorBuilder().addGaussianFilter(3, 3, 0.1000001).build().getConfigHash());
+
+    proc.Run(im);
+    assert(proc.Classify(im, {2, 1}));
+    assert(!proc.Classify(im, {2, 2}));
+    CCImageProcessor coarse = CCImageProcessorBuilder().addPyramid(2, 4)
+                                                       .addThresholding(128)
+                                                       .addCnnClassifier(pNet, {1, 2})
+                                                       .build();
+    coarse.Run(im);
+    assert(coarse.getCandidateRegions().size() == 2);
+    assert(coarse.Classify(im, {2, 1}));
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int classification_batch_test(void) {
+    std::vector<CCContourDescriptor> batch {{2, 0, 0, 1, 1}, {4, 0, 0, 99, 99}, {3, 5, 5, 9, 9},
+                                            {4, 20, 20, 29, 29}, {6, 40, 40, 49, 49}};
+    CCClassification result;
+    CCImageClassifier::ClassifyVertices(batch.data(), batch.size(), result);
+    assert((result.labels == std::vector<int>{CC_LABEL_NONE, CC_LABEL_NONE, 3, 4, 6}));
+    assert((result.getCount(3) == 1) && (result.getCount(4) == 1) && (result.getCount(6) == 1));
+    assert((result.getNumClassified() == 3) && (result.confidence[1] == 0.0f));
+    assert(result.Matches({4, 3}) && result.Matches({}));
+    assert(!result.Matches({4, 4}) && !result.Matches({5}) && !result.Matches({-1}));
+    CCImageClassifier::ClassifyVertices(batch.data(), batch.size(), result, false);
+    assert(result.Matches({4, 4, 3, 6}));
+    CCImageClassifier::ClassifyVertices(batch.data(), 1, result);
+    assert(!result.Matches({}));
+
+    // contours are printed only when diagnostics are enabled
+    CCImageReader imReal(TEST_IMAGE_PNG, CCImageSourceType::PNG, CCColorChannels::RGB), imGray;
+    bool ok;
+    assert(imReal.Load());
+    imGray = imReal.ConvertRGB2GRAY(ok);
+    assert(ok);
+    CCImageProcessor proc = CCImageProcessorBuilder().addGaussianFilter(5, 5, 2.0)
+                                                     .addSoebelFilter(3, 3, 1)
+                                                     .addThresholding(60)
+                                                     .addFeatureExtractor(1)
+                                                     .build();
+    proc.Run(imGray);
+    for (bool diagnostics : {false, true}) {
+        std::stringstream captured;
+        std::streambuf *old = std::cout.rdbuf(captured.rdbuf());
+        proc.setDiagnostics(diagnostics);
+        proc.Classify(result);
+        std::cout.rdbuf(old);
+        assert((captured.str().find('[') != std::string::npos) == diagnostics);
+    }
+    assert(result.getNumClassified() > 0);
+    assert(imGray.Destroy());
+    assert(imReal.Destroy());
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int pipeline_graph_test(void) {
+    CCImageReader img = MakeGrayImage(32, 24, {CCRect{4, 4, 8, 8}, CCRect{18, 6, 10, 12}});
+    std::atomic<int> arrived {0};
+    std::atomic<bool> overlapped {false};
+    // both branches wait for each other, they only get through side by side
+    auto meet = [&arrived, &overlapped](void) {
+        arrived++;
+        for (int i = 0; (i < 2000) && (arrived < 2); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (arrived >= 2)
+            overlapped = true;
+    };
+
+    // the branches need a second thread to meet, whatever the shared scheduler has
+    CCTaskScheduler scheduler(3);
+    CCPipelineGraph graph(scheduler);
+    int sum = 0, numLabels = 0;
+    graph.addStage("invert", {CCBufferKind::GRAY}, CCBufferKind::GRAY, [](CCPipelineFrame &f) {
+        CCImageView v = f.getImage(CCBufferKind::GRAY);
+        for (int y = 0; y < v.getHeight(); y++)
+            for (int x = 0; x < v.getWidth(); x++)
+                v.getRow(y)[x] = 255 - v.getRow(y)[x];
+    });
+    graph.addStage("binary", {CCBufferKind::GRAY}, CCBufferKind::BINARY, [](CCPipelineFrame &f) {
+        CCThresholding(128).Run(f.getImage(CCBufferKind::BINARY));
+    });
+    graph.addStage("sum", {CCBufferKind::BINARY}, CCBufferKind::NONE, [&](CCPipelineFrame &f) {
+        meet();
+        CCImageView v = f.getImage(CCBufferKind::BINARY);
+        for (int y = 0; y < v.getHeight(); y++)
+            for (int x = 0; x < v.getWidth(); x++)
+                sum += v.getRow(y)[x] ? 1 : 0;
+    });
+    graph.addStage("labels", {CCBufferKind::BINARY}, CCBufferKind::LABELS, [&](CCPipelineFrame &f) {
+        meet();
+        f.getComponents().Run(f.getImage(CCBufferKind::BINARY));
+    });
+    graph.addStage("count", {CCBufferKind::LABELS}, CCBufferKind::NONE, [&](CCPipelineFrame &f) {
+        numLabels = f.getComponents().getComponents().size();
+    });
+    graph.setNumThreads(3);
+    graph.setOutput(CCBufferKind::BINARY);
+    assert(graph.Run(img.getView()));
+    assert(overlapped);
+    assert((graph.getDependencies(1) == std::vector<int>{0}));
+    assert((graph.getDependencies(2) == std::vector<int>{1}));
+    assert((graph.getDependencies(3) == std::vector<int>{1}));
+    assert((graph.getDependencies(4) == std::vector<int>{3}));
+    // the background became the foreground, one component around the holes
+    assert((sum == 32 * 24 - 64 - 120) && (numLabels == 1));
+    assert(img.getDataBlob()[0] == 255 && img.getDataBlob()[5 * 32 + 5] == 0);
+
+    // the gray buffer moved on to the binary image, later runs reuse it
+    assert(graph.getNumAllocations() == 1);
+    graph.setNumThreads(1);
+    arrived = 2;
+    assert(graph.Run(img.getView()) && (graph.getNumAllocations() == 1));
+
+    // a second reader of the source makes the binary stage copy
+    graph.addStage("gray log", {CCBufferKind::GRAY}, CCBufferKind::NONE, [](CCPipelineFrame &f) {});
+    assert(graph.Run(img.getView()) && (graph.getNumAllocations() == 2));
+    assert((graph.getDependencies(5) == std::vector<int>{0}));
+
+    CCPipelineGraph broken;
+    broken.addStage("reads labels", {CCBufferKind::LABELS}, CCBufferKind::NONE, [](CCPipelineFrame &f) {});
+    assert(!broken.Run(img.getView()));
+
+    // the processor gives the same result on one and on several threads
+    std::vector<unsigned char> pixels[2];
+    std::vector<float> moments[2];
+    for (int threads : {1, 4}) {
+        CCImageReader im = MakeGrayImage(64, 48, {CCRect{2, 2, 10, 10}, CCRect{30, 20, 12, 8}});
+        CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(128)
+                                                         .addMoments()
+                                                         .addFeatureExtractor(1)
+                                                         .addConcurrency(threads)
+                                                         .build();
+        proc.Run(im);
+        pixels[threads > 1].assign(im.getDataBlob(), im.getDataBlob() + im.getSize());
+        moments[threads > 1] = proc.getMoments()->getFeatures();
+    }
+    assert((pixels[0] == pixels[1]) && (moments[0] == moments[1]) && (moments[0].size() == 2 * CC_NUM_MOMENTS));
+
+    // threshold, edge log, labels, moments, contours: the moments read the one labelling
+    CCImageReader im = MakeGrayImage(64, 48, {CCRect{2, 2, 10, 10}, CCRect{30, 20, 12, 8}});
+    CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(128)
+                                                     .addMoments()
+                                                     .addFeatureExtractor(1)
+                                                     .build();
+    CCPipelineGraph staged;
+    proc.BuildGraph(im, staged);
+    assert(staged.Run(im.getView()) && (staged.getNumStages() == 5));
+    assert((staged.getDependencies(2) == std::vector<int>{0}));
+    assert((staged.getDependencies(3) == std::vector<int>{2}));
+    assert(staged.getFrame().getComponents().getComponents().size() == 2);
+    assert(proc.getMoments()->getFeatures() == moments[0]);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int task_scheduler_test(void) {
+    for (int numThreads : {1, 4}) {
+        CCTaskScheduler scheduler(numThreads);
+        assert(scheduler.getNumThreads() == numThreads);
+
+        // every index exactly once
+        const int n = 10000;
+        std::vector<std::atomic<int>> hits(n);
+        for (auto &h : hits)
+            h = 0;
+        scheduler.ParallelFor(0, n, 7, [&hits](int first, int last) {
+            assert(last - first <= 7);
+            for (int i = first; i < last; i++)
+                hits[i]++;
+        });
+        for (auto &h : hits)
+            assert(h == 1);
+
+        // nested loops share the pool instead of adding threads
+        std::mutex lock;
+        std::set<std::thread::id> threads;
+        std::atomic<long> sum {0};
+        scheduler.ParallelFor(0, 8, 1, [&](int first, int last) {
+            for (int i = first; i < last; i++) {
+                scheduler.ParallelFor(0, 1000, 16, [&](int a, int b) {
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        threads.insert(std::this_thread::get_id());
+                    }
+                    for (int j = a; j < b; j++)
+                        sum += j;
+                });
+            }
+        });
+        assert(sum == 8L * 999 * 1000 / 2);
+        assert(int(threads.size()) <= numThreads);
+
+        // one long task next to many short ones
+        std::atomic<int> done {0};
+        {
+            CCTaskGroup group(scheduler);
+            group.Run([&done]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                done++;
+            });
+            for (int i = 0; i < 100; i++)
+                group.Run([&done]() { done++; });
+            group.Wait();
+            assert(done == 101);
+            // groups can be reused and spawn from inside their tasks
+            group.Run([&group, &done]() { group.Run([&done]() { done++; }); });
+        }
+        assert(done == 102);
+        assert(!scheduler.RunOne());
+    }
+    assert(CCTaskScheduler::getInstance().getNumThreads() >= 1);
+    std::cout << __func__ << ":" << CCTaskScheduler::getInstance().getNumThreads() << ":" << "pass" << std::endl;
+    return 0;
+}
+
+int bounded_queue_test(void) {
+    CCBoundedQueue<int> small(3);
+    int v = 0;
+    assert(small.getCapacity() == 4);
+    for (int i = 0; i < 4; i++)
+        assert(small.TryPush(i));
+    assert(!small.TryPush(v));
+    assert(small.TryPop(v) && (v == 0));
+
+    // several producers and consumers, every item arrives exactly once
+    const int numProducers = 4, numItems = 20000;
+    CCBoundedQueue<int> queue(8);
+    std::atomic<long> sum {0};
+    std::atomic<int> count {0}, producing {numProducers};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < numProducers; p++)
+        threads.push_back(std::thread([&queue, &producing, p]() {
+            for (int i = 0; i < numItems; i++)
+                assert(queue.Push(p * numItems + i));
+            if (--producing == 0)
+                queue.Close();
+        }));
+    for (int c = 0; c < 3; c++)
+        threads.push_back(std::thread([&queue, &sum, &count]() {
+            int item;
+            while (queue.Pop(item)) {
+                sum += item;
+                count++;
+            }
+        }));
+    for (auto &t : threads)
+        t.join();
+    const long n = long(numProducers) * numItems;
+    assert((count == n) && (sum == n * (n - 1) / 2));
+    assert(!queue.Push(1) && !queue.Pop(v));
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int staged_pipeline_test(void) {
+    std::vector<std::string> paths;
+    for (int i = 1; i <= 8; i++)
+        paths.push_back(std::string(TEST_IMAGE_DIR) + "drawing(" + std::to_string(i) + ").png");
+    paths.push_back("does_not_exist.png");
+
+    auto makeProcessor = [](void) {
+        return CCImageProcessorBuilder().addGaussianFilter(5, 5, 2.0)
+                                        .addSoebelFilter(3, 3, 1)
+                                        .addThresholding(60)
+                                        .addFeatureExtractor(1)
+                                        .build();
+    };
+
+    const std::string dir = "staged_pipeline_test";
+    mkdir(dir.c_str(), 0755);
+    CCStagedPipeline pipeline(makeProcessor, 2);
+    pipeline.setNumWorkers(CCPipelineStep::DECODE, 2);
+    pipeline.setNumWorkers(CCPipelineStep::FILTER, 3);
+    pipeline.setNumWorkers(CCPipelineStep::CLASSIFY, 2);
+    pipeline.setOutputDirectory(dir);
+    std::vector<CCPipelineResult> results = pipeline.Run(paths);
+    assert(results.size() == paths.size());
+    assert(!results.back().ok && !results.back().saved);
+
+    // same labels and pixels as running each image end to end
+    for (size_t i = 0; i + 1 < paths.size(); i++) {
+        bool ok;
+        CCImageReader rgb(paths[i].c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+        assert(rgb.Load());
+        CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+        CCImageProcessor proc = makeProcessor();
+        CCClassification expected;
+        proc.Run(gray);
+        proc.Classify(expected);
+        assert(results[i].ok && results[i].saved && (results[i].path == paths[i]));
+        assert(results[i].classification.labels == expected.labels);
+
+        std::string name = dir + paths[i].substr(paths[i].rfind('/'));
+        CCImageReader saved(name.c_str(), CCImageSourceType::PNG, CCColorChannels::GRAY);
+        assert(saved.Load() && (saved.getSize() == gray.getSize()));
+        assert(memcmp(saved.getDataBlob(), gray.getDataBlob(), gray.getSize()) == 0);
+        saved.Destroy();
+        gray.Destroy();
+        rgb.Destroy();
+        remove(name.c_str());
+    }
+    rmdir(dir.c_str());
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int frame_source_test(void) {
+    const int width = 64, height = 48, side = 8, numSlots = 4, numFrames = 40;
+
+    // BLOCK delivers every frame in order, in place in the ring slots
+    {
+        auto producer = std::make_shared<CCSyntheticProducer>(width, height, side, numFrames);
+        CCFrameSource source(producer, width, height, 1, numSlots, CCFramePolicy::BLOCK);
+        std::set<unsigned char *> slots;
+        uint64_t expected = 0;
+        source.Start();
+        size_t n = source.Consume([&](CCDataFrame &frame) {
+            int x, y;
+            assert(frame.getSequence() == expected++);
+            producer->getPosition(frame.getSequence(), x, y);
+            CCImageView view = frame.getView();
+            assert((view.getWidth() == width) && (view.getHeight() == height));
+            int numWhite = 0;
+            for (int i = 0; i < width * height; i++)
+                numWhite += (frame.getData()[i] == 255);
+            assert((numWhite == side * side) && (frame.getData()[y * width + x] == 255));
+            slots.insert(frame.getData());
+        });
+        assert((n == numFrames) && (source.getNumDropped() == 0));
+        assert(slots.size() <= numSlots);
+        assert(source.Acquire() == nullptr);
+    }
+
+    // DROP_OLDEST keeps the newest frames for a consumer that falls behind
+    {
+        auto producer = std::make_shared<CCSyntheticProducer>(width, height, side, numFrames);
+        CCFrameSource source(producer, width, height, 1, numSlots, CCFramePolicy::DROP_OLDEST);
+        source.Start();
+        CCDataFrame *held = source.Acquire();
+        assert(held);
+        uint64_t sequence = held->getSequence();
+        while (!source.isFinished())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // the borrowed frame is never overwritten
+        assert(held->getSequence() == sequence);
+        source.Release(held);
+        std::vector<uint64_t> sequences;
+        source.Consume([&sequences](CCDataFrame &frame) {
+            sequences.push_back(frame.getSequence());
+        });
+        assert(sequences.size() == numSlots - 1);
+        for (size_t i = 0; i < sequences.size(); i++)
+            assert(sequences[i] == numFrames - sequences.size() + i);
+        assert(source.getNumProduced() == numFrames);
+        assert(source.getNumDropped() == numFrames - numSlots);
+        assert(source.getNumConsumed() == numSlots);
+    }
+
+    // paced replay of image files, processed in place
+    {
+        std::vector<std::string> paths;
+        for (int i = 1; i <= 2; i++)
+            paths.push_back(std::string(TEST_IMAGE_DIR) + "drawing(" + std::to_string(i) + ").png");
+        auto producer = std::make_shared<CCReplayProducer>(paths, 2);
+        assert(producer->getNumFrames() == 2);
+
+        std::vector<CCImageReader> expected;
+        for (const std::string &path : paths) {
+            bool ok;
+            CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+            assert(rgb.Load());
+            CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+            CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(60).build();
+            proc.Run(gray);
+            expected.push_back(std::move(gray));
+        }
+
+        CCFrameSource source(producer, 64, 64, 1, 2, CCFramePolicy::BLOCK);
+        CCImageProcessor proc = CCImageProcessorBuilder().addThresholding(60).build();
+        auto start = std::chrono::steady_clock::now();
+        int64_t last = 0;
+        source.Start(200.0);
+        size_t n = source.Consume([&](CCDataFrame &frame) {
+            CCImageReader &img = expected[frame.getSequence() % 2];
+            assert(frame.getTimestamp() >= last);
+            last = frame.getTimestamp();
+            proc.Run(frame);
+            assert(frame.getView().getSize() == img.getSize());
+            assert(memcmp(frame.getData(), img.getDataBlob(), img.getSize()) == 0);
+        });
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        assert(n == 4);
+        assert(elapsed >= std::chrono::milliseconds(15));
+    }
+
+    // stopping an endless stream
+    {
+        auto producer = std::make_shared<CCSyntheticProducer>(width, height, side, -1);
+        CCFrameSource source(producer, width, height, 1, numSlots);
+        source.Start(1000.0);
+        CCDataFrame *frame = source.Acquire();
+        assert(frame);
+        source.Release(frame);
+        source.Stop();
+        assert(source.isFinished());
+        while ((frame = source.Acquire()) != nullptr)
+            source.Release(frame);
+
+        // a restart goes on with the stream where it stopped
+        uint64_t last = source.getNumProduced();
+        source.Start(1000.0);
+        assert(!source.isFinished());
+        frame = source.Acquire();
+        assert(frame && (frame->getSequence() >= last) && (last > 0));
+        source.Release(frame);
+        source.Stop();
+        assert(source.isFinished() && (source.getNumProduced() > last));
+    }
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int incremental_processing_test(void) {
+    const int width = 160, height = 96, side = 12;
+    auto makeProcessor = [](void) {
+        return CCImageProcessorBuilder().addGaussianFilter(5, 5, 2.0)
+                                        .addSoebelFilter(3, 3, 1)
+                                        .addThresholding(60)
+                                        .build();
+    };
+    // a static block and a square moving to the right
+    auto makeFrame = [&](int n) {
+        return MakeGrayImage(width, height, {CCRect{100, 60, 30, 20},
+                                             CCRect{10 + 4 * n, 20, side, side}});
+    };
+
+    CCIncrementalProcessor incremental(makeProcessor(), 16, 4);
+    assert(CCImageView().empty() && (incremental.Run(CCImageView()) == -1));
+    int movingId = 0, staticId = 0;
+    for (int n = 0; n < 8; n++) {
+        CCImageReader frame = makeFrame(n), expected = makeFrame(n);
+        int changed = incremental.Run(frame.getView());
+        CCImageProcessor full = makeProcessor();
+        full.Run(expected);
+        // same pixels as filtering the whole frame
+        assert(memcmp(frame.getDataBlob(), expected.getDataBlob(), width * height) == 0);
+
+        if (n == 0) {
+            assert(changed == incremental.getNumTiles());
+        } else {
+            // the tiles the square left and entered
+            assert((changed > 0) && (changed <= 6));
+        }
+
+        // both outlines are components of their own, with the ids they started with
+        const std::vector<CCTrack> &tracks = incremental.getTracks();
+        assert(tracks.size() == 2);
+        const CCTrack &moving = (tracks[0].cx < tracks[1].cx) ? tracks[0] : tracks[1];
+        const CCTrack &block = (tracks[0].cx < tracks[1].cx) ? tracks[1] : tracks[0];
+        if (n == 0) {
+            movingId = moving.id;
+            staticId = block.id;
+        }
+        assert((moving.id == movingId) && (block.id == staticId));
+        assert((moving.age == n + 1) && (block.age == n + 1));
+        assert(std::abs(moving.cx - (10 + 4 * n + (side - 1) / 2.0f)) < 1.0f);
+    }
+
+    // an unchanged frame touches nothing
+    CCImageReader frame = makeFrame(7);
+    assert(incremental.Run(frame.getView()) == 0);
+    assert(incremental.getChangedRegions().empty() && (incremental.getTracks().size() == 2));
+
+    // a jump farther than the match distance starts a new track
+    incremental.setMaxDistance(8.0f);
+    CCImageReader far = MakeGrayImage(width, height, {CCRect{100, 60, 30, 20}, CCRect{10, 70, side, side}});
+    incremental.Run(far.getView());
+    for (auto &t : incremental.getTracks())
+        assert((t.id == staticId) || ((t.id > staticId) && (t.id > movingId) && (t.age == 1)));
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int result_cache_test(void) {
+    // reference values of XXH64
+    assert(CCHash64("", 0) == 0xEF46DB3751D8E999ULL);
+    assert(CCHash64("abc", 3) == 0x44BC2CF5AD770999ULL);
+    assert(CCHash64(std::string("Nobody inspects the spammish repetition")) == 0xFBCEA83C8A378BF1ULL);
+
+    auto makeProcessor = [](void) {
+        return CCImageProcessorBuilder().addGaussianFilter(5, 5, 2.0)
+                                        .addSoebelFilter(3, 3, 1)
+                                        .addThresholding(60)
+                                        .addMoments()
+                                        .addFeatureExtractor(1)
+                                        .build();
+    };
+    // the order of the stages and the thread count do not matter
+    CCImageProcessor reordered = CCImageProcessorBuilder().addFeatureExtractor(1)
+                                                          .addMoments()
+                                                          .addThresholding(60)
+                                                          .addConcurrency(4)
+                                                          .addSoebelFilter(3, 3, 1)
+                                                          .addGaussianFilter(5, 5, 2.0)
+                                                          .build();
+    CCImageProcessor other = CCImageProcessorBuilder().addGaussianFilter(5, 5, 2.0)
+                                                      .addSoebelFilter(3, 3, 1)
+                                                      .addThresholding(61)
+                                                      .addMoments()
+                                                      .addFeatureExtractor(1)
+                                                      .build();
+    assert(makeProcessor().getConfigHash() == reordered.getConfigHash());
+    assert(makeProcessor().getConfigHash() != other.getConfigHash());
+
+    std::vector<std::string> paths;
+    for (int i = 1; i <= 3; i++)
+        paths.push_back(std::string(TEST_IMAGE_DIR) + "drawing(" + std::to_string(i) + ").png");
+
+    CCResultCache cache("result_cache_test");
+    for (auto &path : paths) {
+        uint64_t key;
+        assert(cache.getKey(path, makeProcessor().getConfigHash(), key));
+        unlink(cache.getEntryPath(key).c_str());
+    }
+
+    std::vector<CCCachedResult> first(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        bool hit;
+        assert(cache.Process(paths[i], makeProcessor, first[i], &hit) && !hit);
+        assert(!first[i].polygons.empty() && !first[i].features.empty());
+        assert(first[i].features.size() % CC_NUM_MOMENTS == 0);
+    }
+    assert((cache.getNumHits() == 0) && (cache.getNumMisses() == paths.size()));
+
+    // the second pass is served from disk with the same contents
+    for (size_t i = 0; i < paths.size(); i++) {
+        CCCachedResult again;
+        bool hit;
+        assert(cache.Process(paths[i], makeProcessor, again, &hit) && hit);
+        assert(again.classification.labels == first[i].classification.labels);
+        assert(again.classification.confidence == first[i].classification.confidence);
+        assert(again.classification.counts == first[i].classification.counts);
+        assert(again.features == first[i].features);
+        assert(again.polygons.size() == first[i].polygons.size());
+        for (size_t p = 0; p < again.polygons.size(); p++) {
+            assert(again.polygons[p].size() == first[i].polygons[p].size());
+            for (size_t v = 0; v < again.polygons[p].size(); v++)
+                assert(again.polygons[p][v] == first[i].polygons[p][v]);
+        }
+    }
+    assert(cache.getNumHits() == paths.size());
+
+    // a damaged entry is a miss and gets rewritten
+    uint64_t key;
+    CCCachedResult result;
+    assert(cache.getKey(paths[0], makeProcessor().getConfigHash(), key));
+    assert(truncate(cache.getEntryPath(key).c_str(), 20) == 0);
+    assert(!cache.Load(key, result));
+    bool hit;
+    assert(cache.Process(paths[0], makeProcessor, result, &hit) && !hit);
+    assert(cache.Load(key, result) && (result.features == first[0].features));
+
+    // the staged pipeline skips every step for cached images
+    CCStagedPipeline pipeline(makeProcessor, 2);
+    pipeline.setResultCache(std::make_shared<CCResultCache>("result_cache_test"));
+    paths.push_back(std::string(TEST_IMAGE_DIR) + "drawing(4).png");
+    assert(cache.getKey(paths.back(), makeProcessor().getConfigHash(), key));
+    unlink(cache.getEntryPath(key).c_str());
+    std::vector<CCPipelineResult> results = pipeline.Run(paths);
+    for (size_t i = 0; i < paths.size(); i++) {
+        assert(results[i].ok && (results[i].cached == (i < 3)));
+        if (i < 3)
+            assert(results[i].classification.labels == first[i].classification.labels);
+    }
+    results = pipeline.Run(paths);
+    assert(results.back().ok && results.back().cached);
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
+int service_test(void) {
+    const std::string spec = "gaussian(5,5,2);soebel(3,3,1);threshold(60);moments;contours(1)";
+    const std::string socketPath = "/tmp/ccservice_test_" + std::to_string(getpid()) + ".sock";
+    const std::string path = std::string(TEST_IMAGE_DIR) + "drawing(1).png";
+
+    // what processing the same spec in place gives, processors built from
+    // one builder share their stages so every one gets its own builder
+    auto makeProcessor = [&spec](void) {
+        CCImageProcessorBuilder builder;
+        assert(CCPipelineSpec::Parse(spec, builder));
+        return builder.build();
+    };
+    CCImageProcessorBuilder builder;
+    assert(!CCPipelineSpec::Parse("gaussian(5,5);", builder));
+    assert(!CCPipelineSpec::Parse("sharpen(3)", builder));
+    CCImageProcessor proc = makeProcessor();
+    CCImageReader rgb(path.c_str(), CCImageSourceType::PNG, CCColorChannels::RGB);
+    bool ok = false;
+    assert(rgb.Load());
+    CCImageReader gray = rgb.ConvertRGB2GRAY(ok);
+    assert(ok);
+    proc.Run(gray);
+    CCCachedResult expected;
+    CCResultCache::Collect(proc, expected);
+    assert(!expected.polygons.empty());
+
+    CCServiceRequest request;
+    request.spec = spec;
+    request.path = path;
+    request.format = CCServiceFormat::BINARY;
+    CCServiceRequest decoded;
+    assert(decoded.Decode(request.Encode()) && (decoded.Encode() == request.Encode()));
+
+    CCService service(socketPath, 2);
+    assert(service.Start());
+    CCServiceClient client;
+    assert(client.Connect(socketPath));
+
+    // the binary answer is a status byte and the cache entry layout
+    std::vector<unsigned char> response;
+    CCCachedResult result;
+    assert(client.Call(request, response) && !response.empty() && (response[0] == 0));
+    response.erase(response.begin());
+    assert(CCResultCache::Decode(response, 0, result));
+    assert(result.classification.labels == expected.classification.labels);
+    assert(result.features == expected.features);
+    assert(result.polygons.size() == expected.polygons.size());
+    for (size_t p = 0; p < result.polygons.size(); p++) {
+        assert(result.polygons[p].size() == expected.polygons[p].size());
+        for (size_t v = 0; v < result.polygons[p].size(); v++)
+            assert(result.polygons[p][v] == expected.polygons[p][v]);
+    }
+
+    // the same job again reuses the warm processor
+    request.format = CCServiceFormat::JSON;
+    assert(client.Call(request, response));
+    std::string json(response.begin(), response.end());
+    assert(json.find("{\"ok\":true,") == 0);
+    assert(json.find("\"polygons\":[[[") != std::string::npos);
+    assert(service.getNumProcessors() == 1);
+
+    // pixels handed over in shared memory
+    const std::string shm = "/ccservice_test_" + std::to_string(getpid());
+    CCImageReader img = MakeGrayImage(64, 48, {CCRect{10, 10, 20, 16}, CCRect{40, 20, 12, 12}});
+    int fd = shm_open(shm.c_str(), O_CREAT | O_RDWR, 0600);
+    assert(fd >= 0);
+    assert(write(fd, img.getDataBlob(), 64 * 48) == 64 * 48);
+    close(fd);
+    CCServiceRequest frame;
+    frame.spec = spec;
+    frame.shm = shm;
+    frame.width = 64;
+    frame.height = 48;
+    frame.numChannels = 1;
+    frame.format = CCServiceFormat::BINARY;
+    assert(client.Call(frame, response) && (response[0] == 0));
+    response.erase(response.begin());
+    assert(CCResultCache::Decode(response, 0, result));
+    CCImageProcessor direct = makeProcessor();
+    direct.Run(img.getView(), CC_STAGES_ALL);
+    CCResultCache::Collect(direct, expected);
+    assert(result.polygons.size() == expected.polygons.size());
+    assert(result.features == expected.features);
+    shm_unlink(shm.c_str());
+
+    // errors are answered, the connection stays usable
+    CCServiceRequest bad;
+    bad.spec = "sharpen(3)";
+    bad.path = path;
+    assert(client.Call(bad, response));
+    assert(std::string(response.begin(), response.end()).find("{\"ok\":false,") == 0);
+    frame.format = CCServiceFormat::JSON;
+    assert(client.Call(frame, response));
+    assert(std::string(response.begin(), response.end()).find("{\"ok\":false,") == 0);
+    request.format = CCServiceFormat::BINARY;
+    assert(client.Call(request, response) && (response[0] == 0));
+    assert(service.getNumJobs() == 6);
+    assert(service.getNumProcessors() == 1);
+
+    // sides whose product overflows an int are refused before mapping
+    frame.width = frame.height = 70000;
+    assert(client.Call(frame, response));
+    assert(std::string(response.begin(), response.end()).find("{\"ok\":false,") == 0);
+
+    // a second service leaves the live socket alone
+    CCService second(socketPath, 1);
+    assert(!second.Start());
+    assert(client.Call(request, response) && (response[0] == 0));
+
+    client.Close();
+    service.Stop();
+    assert(access(socketPath.c_str(), F_OK) != 0);
+
+    // a socket nobody listens on any more is replaced
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+        int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(!bind(stale, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)));
+        close(stale);
+    }
+    assert(second.Start() && client.Connect(socketPath));
+    assert(client.Call(request, response) && (response[0] == 0));
+    client.Close();
+    second.Stop();
+    std::cout << __func__ << ":" <<  "pass" << std::endl;
+    return 0;
+}
+
 int image_processor_test004(int matchValue) {
     int matchCount = 0, totalCount = 0;
+    CCImageWriter writer;
     CCDataSet dataSet(TEST_IMAGE_DIR, CCDataSourceType::IMG);
     assert(dataSet.LoadDirectory());
     assert(dataSet.getNumRecords());
@@ -227,11 +1926,12 @@ int image_processor_test004(int matchValue) {
         if (imProcessor.Classify(imGray, result))
             matchCount++;
         totalCount++;
-        assert(imGray.Save());
-        assert(imGray.Destroy());
+        assert(writer.Submit(std::move(imGray)));
         assert(im->Destroy());
         std::cout << matchCount << "/" << totalCount << std::endl;
     }
+    writer.Flush();
+    assert(writer.getNumFailed() == 0);
     dataSet.Destroy();
     std::cout << __func__ << ":" <<  "pass" << std::endl;
     return 0;
@@ -310,6 +2010,34 @@ int main(void) {
     image_processor_test002();
     image_processor_test003(RESULT_VERTICES);
 #endif
+    img_clone_move_test();
+    image_processor_roi_test();
+    img_async_writer_test();
+    dataset_dir_parallel_load_test();
+    image_pyramid_test();
+    image_processor_coarse_to_fine_test();
+    sobel_filter_test();
+    canny_filter_test();
+    recursive_gaussian_test();
+    fixed_point_gaussian_test();
+    convolution_engine_test();
+    median_filter_test();
+    specialized_kernels_test();
+    cpu_dispatch_test();
+    distance_transform_test();
+    watershed_split_test();
+    moments_test();
+    feature_classifier_test();
+    cnn_inference_test();
+    classification_batch_test();
+    pipeline_graph_test();
+    task_scheduler_test();
+    bounded_queue_test();
+    staged_pipeline_test();
+    frame_source_test();
+    incremental_processing_test();
+    result_cache_test();
+    service_test();
     image_processor_test004(RESULT_VERTICES);
     return 0;
 }